@@ -0,0 +1,591 @@
+/*
+ * bench.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <math.h>
+#include <string.h>
+#include "bench.h"
+#include "perf.h"
+#include "proc.h"
+#include "format.h"
+#include "conv.h"
+#include "ols.h"
+#include "cic.h"
+#include "chain.h"
+#include "dac.h"
+#include "mix.h"
+#include "fir_filter.h"
+#include "global.h"
+#include "driverlib/interrupt.h"
+#include "utils/uartstdio.h"
+
+//
+// A benchmark entry. prep() runs untimed before each timed call of run(),
+// which runs with interrupts disabled. The limit applies to the fastest call,
+// as it is the most repeatable figure. The limits here are budgets estimated
+// from the instruction counts, not measurements, and only catch a kernel that
+// got far slower. Regressions are checked against a recorded run instead:
+// tools/benchhost.c runs this table on the host with its limits set from a
+// baseline it recorded plus a margin, through benchLimit.
+//
+typedef struct {
+  const char * name;
+  void (*prep)(void);
+  void (*run)(void);
+  uint16_t samples; // Samples handled per call, 0 if not sample based
+  uint32_t limit;   // Maximum cycles per call for the fastest call
+} benchT;
+
+// Build choices of global.h and fir_filter.h, to tell the runs apart
+#ifdef RAM_CODE
+#define BENCH_RAM_CODE "true"
+#else
+#define BENCH_RAM_CODE "false"
+#endif
+#ifdef FIR_COEFFS_RAM
+#define BENCH_COEFFS "sram"
+#else
+#define BENCH_COEFFS "flash"
+#endif
+
+// Limit of a benchmark instead of the one in the table when set, 0 for none
+uint32_t (*benchLimit)(const char * name);
+
+static volatile bufT * benchBuf;
+static elementT * benchElem;
+
+static arm_fir_instance_f32 benchFir;
+static float32_t benchFirState[BLOCK_SIZE + TAPS - 1];
+
+// Fill the element with a repeatable pattern of raw 12-bit ADC samples
+static void benchPrepElement(void) {
+  uint16_t i;
+
+  for (i = 0; i < elementSize; i++) {
+    benchElem->data[i] = 1536 + ((i * 37) & 1023);
+  }
+  benchElem->status = READ;
+}
+
+// One producer/consumer round trip through the ring, as done by the ADC
+// interrupt and the recording loop
+static void benchCirbuf(void) {
+  elementT * elem;
+
+  elem = bufGetFree(benchBuf);
+  bufItemSetFree(benchBuf, elem->index);
+  elem = bufGet(benchBuf);
+  bufItemSetFree(benchBuf, elem->index);
+}
+
+// Offset removal and int16 to float conversion as first written in the
+// recording loop. Kept as baseline for the conv.c kernels.
+static void benchConvToFloat(void) {
+  uint16_t i;
+  float32_t * out = procScratch(0);
+
+  for (i = 0; i < elementSize; i++) {
+    benchElem->data[i] -= 2048;
+    out[i] = ((float32_t) (benchElem->data[i]) / INT16_MAX);
+  }
+}
+
+// Decimated float to int16 conversion as first written in the recording loop,
+// without saturation
+static void benchConvToInt(void) {
+  uint16_t i;
+  float32_t * in = procScratch(1);
+
+  for (i = 0; i < procOutSize; i++) {
+    benchElem->data[i] = in[i * procDecimation] * INT16_MAX;
+  }
+}
+
+static void benchConvAdcToInt(void) {
+  convAdcToInt(benchElem->data, elementSize);
+}
+
+static void benchConvAdcToFloat(void) {
+  convAdcToFloat(benchElem->data, procScratch(0), elementSize);
+}
+
+static void benchConvFloatToInt(void) {
+  convFloatToInt(procScratch(1), benchElem->data, procOutSize, procDecimation,
+                 INT16_MAX);
+}
+
+static void benchPrepFir(void) {
+  arm_fir_init_f32(&benchFir, TAPS, (float32_t *) &firCoeffsf32[0],
+                   &benchFirState[0], BLOCK_SIZE);
+}
+
+// The recording filter over testInput
+static void benchFirF32(void) {
+  uint16_t i;
+
+  for (i = 0; i < LENGTH / BLOCK_SIZE; i++) {
+    arm_fir_f32(&benchFir, (float32_t *) testInput + (i * BLOCK_SIZE),
+                procScratch(1) + (i * BLOCK_SIZE), BLOCK_SIZE);
+  }
+}
+
+// A sector of header, built in the filter scratch
+static void benchWavHeader(void) {
+  wavHeaderFill((uint8_t *) procScratch(0), 0x12345678);
+}
+
+static void benchProcBlock(void) {
+  procBlock(benchElem, benchElem->data, 0);
+}
+
+static void benchProcBlockStat(void) {
+  procStatT stat;
+
+  procBlock(benchElem, benchElem->data, &stat);
+}
+
+static cicT benchCic;
+
+static void benchPrepCic(void) {
+  benchPrepElement();
+  cicInit(&benchCic, cicOrder, 8);
+}
+
+// CIC stage of the chain at 8 times ADC_RATE
+static void benchCicRun(void) {
+  cicRun(&benchCic, benchElem->data, procScratch(0), elementSize);
+}
+
+static void benchPrepProcRate(void) {
+  benchPrepElement();
+  procInitRate(8, cicOrder);
+}
+
+// The whole oversampled chain at 8 times ADC_RATE
+static void benchProcBlockRate(void) {
+  procBlock(benchElem, benchElem->data, 0);
+}
+
+// Every stage of the fused chain, and the same stages as CMSIS block calls
+static chainT benchChain;
+static arm_biquad_cascade_df2T_instance_f32 benchDc;
+static arm_biquad_cascade_df2T_instance_f32 benchBq;
+static arm_fir_decimate_instance_f32 benchDecim;
+static const float32_t benchDcCoeffs[5] = { 1, -1, 0, CHAIN_DC_POLE, 0 };
+static float32_t benchDcState[2];
+static float32_t benchBqState[2 * CHAIN_BIQUADS];
+
+static void benchPrepChain(void) {
+  benchPrepElement();
+  chainInit(&benchChain);
+
+  arm_biquad_cascade_df2T_init_f32(&benchDc, 1, (float32_t *) benchDcCoeffs,
+                                   benchDcState);
+  arm_biquad_cascade_df2T_init_f32(&benchBq, CHAIN_BIQUADS, benchChain.bq[0],
+                                   benchBqState);
+
+  // The recording filter benchmark sets its own state up before each call
+  arm_fir_decimate_init_f32(&benchDecim, TAPS, procDecimation,
+                            (float32_t *) firCoeffsf32, benchFirState,
+                            BLOCK_SIZE);
+}
+
+static void benchChainFused(void) {
+  chainRunAll(&benchChain, benchElem->data, benchElem->data);
+}
+
+static void benchChainSeparate(void) {
+  float32_t * x = procScratch(0);
+  float32_t * y = procScratch(1);
+  float32_t peak;
+  uint32_t at;
+  uint16_t i;
+
+  convAdcToFloat(benchElem->data, x, elementSize);
+  arm_biquad_cascade_df2T_f32(&benchDc, x, y, elementSize);
+  arm_biquad_cascade_df2T_f32(&benchBq, y, x, elementSize);
+  arm_scale_f32(x, benchChain.gain, x, elementSize);
+
+  arm_abs_f32(x, y, elementSize);
+  arm_max_f32(y, elementSize, &peak, &at);
+  chainAgc(&benchChain, peak);
+
+  for (i = 0; i < elementSize; i += BLOCK_SIZE) {
+    arm_fir_decimate_f32(&benchDecim, x + i, y + i / procDecimation,
+                         BLOCK_SIZE);
+  }
+  convFloatToInt(y, benchElem->data, procOutSize, 1, INT16_MAX);
+}
+
+// One sample out to the PWM, as the Timer1 interrupt does in playback
+static void benchPrepDac(void) {
+  dacBuf = benchElem;
+  dacIndex = 0;
+}
+
+static void benchDacIsr(void) {
+  dacIntHandler();
+}
+
+// The background and both overlays of the mixer, all from the element
+static void benchMixKernel(void) {
+  const int16_t * in[mixMaxStreams];
+  int16_t gain[mixMaxStreams];
+  uint8_t s;
+
+  for (s = 0; s < mixMaxStreams; s++) {
+    in[s] = benchElem->data;
+    gain[s] = mixUnity / mixMaxStreams;
+  }
+
+  mixKernel(in, gain, mixMaxStreams, (int16_t *) procScratch(0), elementSize);
+}
+
+static const benchT benchTable[] = {
+  { "cirbuf_round_trip", 0,                benchCirbuf,        0,           600 },
+  { "conv_i16_f32",      benchPrepElement, benchConvToFloat,   elementSize, 8192 },
+  { "conv_f32_i16",      0,                benchConvToInt,     procOutSize, 2048 },
+  { "conv_adc_i16",      benchPrepElement, benchConvAdcToInt,  elementSize, 1536 },
+  { "conv_adc_f32",      benchPrepElement, benchConvAdcToFloat, elementSize, 4096 },
+  { "conv_f32_i16_sat",  0,                benchConvFloatToInt, procOutSize, 1536 },
+  { "fir_f32",           benchPrepFir,     benchFirF32,        LENGTH,      120000 },
+  { "wav_header",        0,                benchWavHeader,     0,           800 },
+  { "proc_block",        benchPrepElement, benchProcBlock,     elementSize, 140000 },
+  { "proc_block_vad",    benchPrepElement, benchProcBlockStat, elementSize, 150000 },
+  { "cic_r8",            benchPrepCic,     benchCicRun,        elementSize, 12000 },
+  { "proc_block_r8",     benchPrepProcRate, benchProcBlockRate, elementSize, 40000 },
+  { "chain_fused",       benchPrepChain,   benchChainFused,    elementSize, 60000 },
+  { "chain_separate",    benchPrepChain,   benchChainSeparate, elementSize, 60000 },
+  { "mix_kernel",        benchPrepElement, benchMixKernel,     elementSize, 8000 },
+  { "dac_isr",           benchPrepDac,     benchDacIsr,        1,           400 },
+};
+
+#define NUM_BENCH (sizeof(benchTable) / sizeof(benchT))
+
+//
+// Run the benchmarks whose name starts with filter (all if filter is null) and
+// print the results as JSON, one result per line. buf is used as work area and
+// is left initialized. Returns true if all limits are met.
+//
+bool benchRun(volatile bufT * buf, const char * filter) {
+  uint8_t i;
+  uint16_t run;
+  uint32_t start, cycles, limit;
+  perfStatT stat;
+  bool pass;
+  bool allPass = true;
+  bool first = true;
+  const benchT * b;
+
+  benchBuf = buf;
+  bufInit(buf);
+  benchElem = (elementT *) &buf->item[0];
+  procInit();
+
+  UARTprintf("{\"clock\":%u,\"runs\":%u,\"ram_code\":%s,\"fir_coeffs\":\"%s\","
+             "\"results\":[", SYS_CLK, benchRuns, BENCH_RAM_CODE, BENCH_COEFFS);
+
+  for (i = 0; i < NUM_BENCH; i++) {
+    b = &benchTable[i];
+
+    if (filter && strncmp(b->name, filter, strlen(filter))) {
+      continue;
+    }
+
+    perfStatReset(&stat);
+
+    for (run = 0; run < benchRuns; run++) {
+      if (b->prep) {
+        b->prep();
+      }
+
+      IntMasterDisable();
+      start = perfNow();
+      b->run();
+      cycles = perfNow() - start;
+      IntMasterEnable();
+
+      perfStatAdd(&stat, cycles);
+    }
+
+    // Back to the plain chain after the oversampled ones
+    procInit();
+
+    limit = benchLimit ? benchLimit(b->name) : b->limit;
+    pass = !limit || (stat.min <= limit);
+    allPass = allPass && pass;
+
+    UARTprintf("%s\n{\"name\":\"%s\",\"samples\":%u,\"min\":%u,\"avg\":%u,"
+               "\"max\":%u,\"limit\":%u,\"pass\":%s}",
+               first ? "" : ",", b->name, b->samples, stat.min,
+               perfStatAvg(&stat), stat.max, limit,
+               pass ? "true" : "false");
+    first = false;
+  }
+
+  UARTprintf("\n],\"pass\":%s}\n", allPass ? "true" : "false");
+
+  dacBuf = 0;
+  bufInit(buf);
+
+  return allPass;
+}
+
+// Filter lengths timed by benchCrossover()
+static const uint16_t benchCrossTaps[] = {
+  8, 16, 24, 32, 48, 64, 101, 128, 192, olsMaxTaps
+};
+
+#define NUM_CROSS (sizeof(benchCrossTaps) / sizeof(uint16_t))
+
+// Hann windowed sinc low pass at the recording filter cutoff, unity DC gain
+static void benchDesign(float32_t * c, uint16_t taps) {
+  float32_t fc = 3400.0f / ADC_RATE;
+  float32_t sum = 0;
+  float32_t t;
+  uint16_t i;
+
+  for (i = 0; i < taps; i++) {
+    t = i - (taps - 1) / 2.0f;
+    c[i] = (t == 0) ? 2 * fc : sinf(2 * PI * fc * t) / (PI * t);
+    c[i] *= 0.5f - 0.5f * cosf(2 * PI * (i + 1) / (taps + 1));
+    sum += c[i];
+  }
+
+  for (i = 0; i < taps; i++) {
+    c[i] /= sum;
+  }
+}
+
+//
+// Time one element through the direct form FIR and the overlap-save engine for
+// a range of filter lengths, next to the cost model procFilterInit() uses, and
+// print the results as JSON. The ring is idle, so its RAM holds the filters;
+// buf is left initialized.
+//
+void benchCrossover(volatile bufT * buf) {
+  // Word aligned work area in the ring
+  float32_t * arena = (float32_t *) (((uintptr_t) buf->item + 3) & ~(uintptr_t) 3);
+  float32_t * coeffs = arena;
+  float32_t * state = coeffs + olsMaxTaps;
+  float32_t * h = state + BLOCK_SIZE + olsMaxTaps - 1;
+  float32_t * frame = h + olsMaxFft;
+  int16_t * out = (int16_t *) (frame + olsMaxFft);
+  float32_t * in = procScratch(0);
+  float32_t * tmp = procScratch(1);
+  arm_fir_instance_f32 fir;
+  olsT ols;
+  perfStatT firStat, olsStat;
+  uint32_t start;
+  uint16_t taps, i, b, run;
+  uint16_t measured = 0;
+  uint16_t model = 0;
+
+  memcpy(in, testInput, elementSize * sizeof(float32_t));
+
+  UARTprintf("{\"clock\":%u,\"runs\":%u,\"crossover\":[", SYS_CLK,
+             benchRuns);
+
+  for (i = 0; i < NUM_CROSS; i++) {
+    taps = benchCrossTaps[i];
+    benchDesign(coeffs, taps);
+    arm_fir_init_f32(&fir, taps, coeffs, state, BLOCK_SIZE);
+    olsInit(&ols, coeffs, taps, h, frame);
+    perfStatReset(&firStat);
+    perfStatReset(&olsStat);
+
+    for (run = 0; run < benchRuns; run++) {
+      IntMasterDisable();
+
+      // Same steps as procFilterRun()
+      start = perfNow();
+      for (b = 0; b < LENGTH / BLOCK_SIZE; b++) {
+        arm_fir_f32(&fir, in + b * BLOCK_SIZE, tmp + b * BLOCK_SIZE,
+                    BLOCK_SIZE);
+      }
+      convFloatToInt(tmp, out, procOutSize, procDecimation, INT16_MAX);
+      perfStatAdd(&firStat, perfNow() - start);
+
+      start = perfNow();
+      olsRun(&ols, in, tmp, out);
+      perfStatAdd(&olsStat, perfNow() - start);
+
+      IntMasterEnable();
+    }
+
+    // First length from which the engine stays faster
+    if (olsStat.min >= firStat.min) {
+      measured = 0;
+    }
+    else if (!measured) {
+      measured = taps;
+    }
+    if (olsCost(taps) >= olsFirCost(taps)) {
+      model = 0;
+    }
+    else if (!model) {
+      model = taps;
+    }
+
+    UARTprintf("%s\n{\"taps\":%u,\"fft\":%u,\"fir\":%u,\"ols\":%u,"
+               "\"fir_model\":%u,\"ols_model\":%u}",
+               i ? "," : "", taps, ols.size, firStat.min, olsStat.min,
+               olsFirCost(taps), olsCost(taps));
+  }
+
+  UARTprintf("\n],\"measured\":%u,\"model\":%u}\n", measured, model);
+
+  bufInit(buf);
+}
+
+// Oversampling ratios and CIC orders timed by benchRate()
+static const uint8_t benchRateRatios[] = { 2, 4, 8, 16 };
+
+#define NUM_RATE (sizeof(benchRateRatios) / sizeof(uint8_t))
+
+//
+// Time one element through each stage of the oversampled chain for every
+// ratio and CIC order, next to the time an element lasts at that ADC rate, and
+// print the results as JSON. load is the share of the element time in percent
+// the three stages take. The ring is idle, so its RAM holds the filters; buf
+// is left initialized.
+//
+void benchRate(volatile bufT * buf) {
+  // Word aligned work area in the ring
+  float32_t * arena = (float32_t *) (((uintptr_t) buf->item + 3) & ~(uintptr_t) 3);
+  float32_t * coeffs = arena;
+  float32_t * compState = coeffs + cicCompTaps;
+  float32_t * finalState = compState + BLOCK_SIZE + cicCompTaps - 1;
+  int16_t * adc = (int16_t *) (finalState + BLOCK_SIZE + TAPS - 1);
+  int16_t * out = adc + elementSize;
+  float32_t * x = procScratch(0);
+  float32_t * y = procScratch(1);
+  arm_fir_instance_f32 comp;
+  arm_fir_decimate_instance_f32 fin;
+  cicT cic;
+  perfStatT cicStat, compStat, finStat;
+  uint32_t start, budget, total;
+  uint16_t n, i, run;
+  uint8_t r, order;
+  bool first = true;
+
+  for (i = 0; i < elementSize; i++) {
+    adc[i] = 1536 + ((i * 37) & 1023);
+  }
+
+  UARTprintf("{\"clock\":%u,\"runs\":%u,\"rates\":[", SYS_CLK, benchRuns);
+
+  for (r = 0; r < NUM_RATE; r++) {
+    for (order = 1; order <= cicMaxOrder; order++) {
+      if (!cicInit(&cic, order, benchRateRatios[r])) {
+        continue;
+      }
+
+      n = elementSize / cic.ratio;
+      cicCompDesign(coeffs, order, cic.ratio);
+      arm_fir_init_f32(&comp, cicCompTaps, coeffs, compState, BLOCK_SIZE);
+      arm_fir_decimate_init_f32(&fin, TAPS, procDecimation,
+                                (float32_t *) firCoeffsf32, finalState,
+                                BLOCK_SIZE);
+      perfStatReset(&cicStat);
+      perfStatReset(&compStat);
+      perfStatReset(&finStat);
+
+      for (run = 0; run < benchRuns; run++) {
+        IntMasterDisable();
+
+        // Same steps as procBlock() after procInitRate()
+        start = perfNow();
+        cicRun(&cic, adc, x, elementSize);
+        perfStatAdd(&cicStat, perfNow() - start);
+
+        start = perfNow();
+        for (i = 0; i < n; i += BLOCK_SIZE) {
+          arm_fir_f32(&comp, x + i, y + i, BLOCK_SIZE);
+        }
+        perfStatAdd(&compStat, perfNow() - start);
+
+        start = perfNow();
+        for (i = 0; i < n; i += BLOCK_SIZE) {
+          arm_fir_decimate_f32(&fin, y + i, x + i / procDecimation,
+                               BLOCK_SIZE);
+        }
+        convFloatToInt(x, out, n / procDecimation, 1,
+                       INT16_MAX * (1 << cicGainBits));
+        perfStatAdd(&finStat, perfNow() - start);
+
+        IntMasterEnable();
+      }
+
+      budget = (uint32_t) ((uint64_t) SYS_CLK * elementSize /
+                           (ADC_RATE * cic.ratio));
+      total = cicStat.min + compStat.min + finStat.min;
+
+      UARTprintf("%s\n{\"rate\":%u,\"ratio\":%u,\"order\":%u,\"cic\":%u,"
+                 "\"comp\":%u,\"final\":%u,\"total\":%u,\"budget\":%u,"
+                 "\"load\":%u}",
+                 first ? "" : ",", ADC_RATE * cic.ratio, cic.ratio, order,
+                 cicStat.min, compStat.min, finStat.min, total, budget,
+                 total * 100 / budget);
+      first = false;
+    }
+  }
+
+  UARTprintf("\n]}\n");
+
+  bufInit(buf);
+}
+
+//
+// Time the mixer over an element of output for 1 to mixKernelMax streams and
+// print the results as JSON: the cycles per output sample, and the cycles
+// each stream added over one less, in hundredths. The ring is idle, so its
+// RAM holds the streams; buf is left initialized.
+//
+void benchMix(volatile bufT * buf) {
+  int16_t * arena = (int16_t *) (((uintptr_t) buf->item + 3) & ~(uintptr_t) 3);
+  int16_t * out = arena + mixKernelMax * elementSize;
+  const int16_t * in[mixKernelMax];
+  int16_t gain[mixKernelMax];
+  perfStatT stat;
+  uint32_t start;
+  uint32_t prev = 0;
+  uint16_t i, run;
+  uint8_t k;
+
+  for (k = 0; k < mixKernelMax; k++) {
+    in[k] = arena + k * elementSize;
+    gain[k] = mixUnity / mixKernelMax;
+
+    for (i = 0; i < elementSize; i++) {
+      arena[k * elementSize + i] = (int16_t) ((i * 37 + k * 1000) & 0x3fff) -
+                                   0x2000;
+    }
+  }
+
+  UARTprintf("{\"clock\":%u,\"runs\":%u,\"samples\":%u,\"mix\":[", SYS_CLK,
+             benchRuns, elementSize);
+
+  for (k = 1; k <= mixKernelMax; k++) {
+    perfStatReset(&stat);
+
+    for (run = 0; run < benchRuns; run++) {
+      IntMasterDisable();
+      start = perfNow();
+      mixKernel(in, gain, k, out, elementSize);
+      perfStatAdd(&stat, perfNow() - start);
+      IntMasterEnable();
+    }
+
+    UARTprintf("%s\n{\"streams\":%u,\"cycles\":%u,\"per_sample_x100\":%u,"
+               "\"added_x100\":%d}",
+               (k > 1) ? "," : "", k, stat.min, stat.min * 100 / elementSize,
+               ((int32_t) stat.min - (int32_t) prev) * 100 / elementSize);
+    prev = stat.min;
+  }
+
+  UARTprintf("\n]}\n");
+
+  bufInit(buf);
+}
@@ -0,0 +1,26 @@
+/*
+ * bench.h
+ * Cycle benchmarks for the buffer and DSP kernels
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cirbuf.h"
+
+enum {
+  benchRuns = 32 // Calls timed for each kernel
+};
+
+extern uint32_t (*benchLimit)(const char * name);
+
+bool benchRun(volatile bufT * buf, const char * filter);
+void benchCrossover(volatile bufT * buf);
+void benchRate(volatile bufT * buf);
+void benchMix(volatile bufT * buf);
+
+#endif /* BENCH_H_ */
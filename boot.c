@@ -0,0 +1,123 @@
+/*
+ * boot.c
+ *
+ * With SW1 held down at reset, or BOOT_RECORD set, main starts the capture
+ * right after the clock setup and the recorder takes it over. The card comes
+ * up and the file is opened while the first blocks wait in memory.
+ *
+ * The cycle counter starts in ResetISR, before the C runtime initializes RAM,
+ * so the boot times count from the first instruction. The time the part
+ * spends in reset before it is not counted.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "boot.h"
+#include "dirlist.h"
+#include "global.h"
+#include "perf.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/gpio.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "utils/uartstdio.h"
+
+bootTimeT bootTime;
+
+//
+// Recording on boot asked for, SW1 (PF4, low when pressed) is read once
+//
+bool bootWanted(void) {
+  if (BOOT_RECORD) {
+    return true;
+  }
+
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
+  while (!SysCtlPeripheralReady(SYSCTL_PERIPH_GPIOF)) {
+  }
+
+  GPIOPinTypeGPIOInput(GPIO_PORTF_BASE, GPIO_PIN_4);
+  GPIOPadConfigSet(GPIO_PORTF_BASE, GPIO_PIN_4, GPIO_STRENGTH_2MA,
+                   GPIO_PIN_TYPE_STD_WPU);
+
+  // Let the pull-up charge the pin
+  SysCtlDelay(100);
+
+  return !GPIOPinRead(GPIO_PORTF_BASE, GPIO_PIN_4);
+}
+
+// Stamp the switch to the PLL, right after SysCtlClockSet()
+void bootClock(void) {
+  bootTime.clock = perfNow();
+}
+
+//
+// Wait for the first trigger of the ADC timer after capTimerEnable() and stamp
+// it. The conversion is done 1us later. The timer status is clear out of
+// reset, and nothing takes the timer interrupt.
+//
+void bootFirstSample(void) {
+  while (!(TimerIntStatus(TIMER0_BASE, false) & TIMER_TIMA_TIMEOUT)) {
+  }
+
+  bootTime.sample = perfNow();
+}
+
+//
+// us since reset of a cycle counter stamp, within the first minute
+//
+uint32_t bootUs(uint32_t stamp) {
+  if (stamp < bootTime.clock) {
+    return stamp / bootPioscMHz;
+  }
+
+  return bootTime.clock / bootPioscMHz +
+         (stamp - bootTime.clock) / (SYS_CLK / 1000000);
+}
+
+//
+// Create a new recording in the root directory named prefix and a number,
+// starting at the number of recordings in its index. The path goes to path.
+//
+FRESULT bootCreate(FIL * file, FIL * idx, char * path, const char * prefix) {
+  uint32_t n = dirIndexCount(idx, "/");
+  uint32_t len = strlen(prefix);
+  FRESULT res = FR_DENIED;
+
+  if (len > 4) {
+    return FR_INVALID_NAME;
+  }
+
+  path[0] = '/';
+  strcpy(path + 1, prefix);
+  strcpy(path + 1 + len, "0000.WAV");
+
+  for (; n < bootMaxFiles; n++) {
+    path[1 + len] = '0' + n / 1000;
+    path[2 + len] = '0' + n / 100 % 10;
+    path[3 + len] = '0' + n / 10 % 10;
+    path[4 + len] = '0' + n % 10;
+
+    res = f_open(file, path, FA_WRITE | FA_CREATE_NEW);
+    if (res != FR_EXIST) {
+      break;
+    }
+  }
+
+  if (res == FR_OK) {
+    bootTime.open = perfNow();
+  }
+
+  return res;
+}
+
+//
+// How the boot went: blocks filtered into memory before the file was open,
+// and ADC elements dropped with that memory full
+//
+void bootPrint(uint32_t buffered, uint32_t dropped) {
+  UARTprintf("boot: first sample %u us, file open %u ms after reset\n",
+             bootUs(bootTime.sample), bootUs(bootTime.open) / 1000);
+  UARTprintf("boot: %u blocks buffered, %u elements dropped\n", buffered,
+             dropped);
+}
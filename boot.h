@@ -0,0 +1,44 @@
+/*
+ * boot.h
+ * Record on boot: capture from reset while the card and file system come up
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/src/ff.h"
+
+// Set to 1 to record on every reset, not only with SW1 held down
+#ifndef BOOT_RECORD
+#define BOOT_RECORD 0
+#endif
+
+// Prefix of the recordings made on boot, followed by a 4 digit number
+#define BOOT_PREFIX "BOOT"
+
+enum {
+  bootPioscMHz = 16,   // Clock from reset until the PLL is up
+  bootMaxFiles = 10000 // Numbers of the 8.3 names
+};
+
+// Cycle counter stamps, which count from ResetISR
+typedef struct {
+  uint32_t clock;  // Switch to the PLL, the cycles before it are at 16MHz
+  uint32_t sample; // First ADC trigger, 0 when not capturing since reset
+  uint32_t open;   // Recording file open
+} bootTimeT;
+
+extern bootTimeT bootTime;
+
+bool bootWanted(void);
+void bootClock(void);
+void bootFirstSample(void);
+uint32_t bootUs(uint32_t stamp);
+FRESULT bootCreate(FIL * file, FIL * idx, char * path, const char * prefix);
+void bootPrint(uint32_t buffered, uint32_t dropped);
+
+#endif /* BOOT_H_ */
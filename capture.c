@@ -0,0 +1,237 @@
+/*
+ * capture.c
+ *
+ * Ping-pong capture takes an interrupt for every element, and the ISR claims
+ * the next one. Here two task lists of capBlocks element transfers each are
+ * run back to back in peripheral scatter-gather mode:
+ *
+ *   list 0: ADC -> elem, ..., ADC -> elem, start Timer2, primary = list 1
+ *   list 1: ADC -> elem, ..., ADC -> elem, start Timer2, primary = list 0
+ *
+ * The last task of a list rewrites the primary control structure of the
+ * channel, so the other list starts without the channel ever stopping. The
+ * uDMA can not reach the NVIC, so the task before it starts a one-shot timer
+ * whose timeout interrupt hands the finished elements to the consumer and
+ * fills the list with new ones while the other list runs.
+ *
+ * Burst mode keeps ping-pong but cuts the uDMA requests. The ADC requests a
+ * transfer when a step with IE set completes, so a sequence of several steps
+ * would sample them back to back at the conversion rate. Instead Timer0 still
+ * starts every conversion of a one step SS0 sequence without IE, the samples
+ * queue up in the FIFO, and Timer3 asks for capBurstSize of them at a time:
+ *
+ *   Timer0  |   |   |   |   |   |   |   |   |    one conversion each
+ *   Timer3                |               |      CAP_BURST_ARB samples each
+ *
+ * Both count the same clock, so Timer3 stays half a sample behind every
+ * capBurstSize-th conversion, which is done by then.
+ *
+ *  Created on: 19-10-2026
+ */
+#include "capture.h"
+#include "global.h"
+#include "irq.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_adc.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_timer.h"
+#include "driverlib/adc.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/udma.h"
+
+// Set in sd_card.c, the ISR stops there when the ring is full
+extern volatile bool bufferOverflow;
+extern volatile uint32_t sysTickCount;
+
+#ifdef RAM_CODE
+#pragma CODE_SECTION(capFill, ".ramfunc")
+#pragma CODE_SECTION(capRefill, ".ramfunc")
+#pragma CODE_SECTION(capIntHandler, ".ramfunc")
+#endif
+
+bool capScatter = false;
+bool capBurst = false;
+uint32_t capRate = ADC_RATE;
+uint16_t capSize = elementSize;
+perfStatT capIsrPerf;
+
+static tDMAControlTable capList[capLists][capTasks];
+static tDMAControlTable capPrimary[capLists]; // Primary structure per list
+static elementT * capElem[capLists][capBlocks];
+static tDMAControlTable * capTable;
+static volatile bufT * capBuf;
+static uint8_t capNext; // List that completes next
+
+// Written to the Timer2 control register by the interrupt task. Kept in SRAM
+// like everything else the uDMA reads.
+static uint32_t capTrigger = TIMER_CTL_TAEN;
+
+//
+// Claim capBlocks new elements for list l and point its ADC tasks at them
+//
+static void capFill(uint8_t l) {
+  uint8_t b;
+
+  for (b = 0; b < capBlocks; b++) {
+    capElem[l][b] = bufGetFree(capBuf);
+
+    if (!capElem[l][b]) {
+      bufferOverflow = true;
+      while(1);
+    }
+
+    capList[l][b] = (tDMAControlTable) uDMATaskStructEntry(
+        elementSize, UDMA_SIZE_16,
+        UDMA_SRC_INC_NONE, (void *) (ADC0_BASE + ADC_O_SSFIFO3),
+        UDMA_DST_INC_16, capElem[l][b]->data,
+        UDMA_ARB_1, UDMA_MODE_PER_SCATTER_GATHER);
+  }
+}
+
+//
+// Claim the first elements, build both task lists and set the channel up to
+// run list 0. table is the uDMA control table. The ADC and its trigger timer
+// are set up, and the channel enabled, by the caller.
+//
+void capStart(volatile bufT * buf, void * table) {
+  int8_t l;
+
+  capBuf = buf;
+  capTable = (tDMAControlTable *) table;
+  capNext = 0;
+
+  for (l = 0; l < capLists; l++) {
+    capFill(l);
+
+    // Memory tasks run as soon as the previous task is done
+    capList[l][capBlocks] = (tDMAControlTable) uDMATaskStructEntry(
+        1, UDMA_SIZE_32,
+        UDMA_SRC_INC_NONE, &capTrigger,
+        UDMA_DST_INC_NONE, (void *) (TIMER2_BASE + TIMER_O_CTL),
+        UDMA_ARB_1, UDMA_MODE_MEM_SCATTER_GATHER);
+    capList[l][capBlocks + 1] = (tDMAControlTable) uDMATaskStructEntry(
+        4, UDMA_SIZE_32,
+        UDMA_SRC_INC_32, &capPrimary[(l + 1) % capLists],
+        UDMA_DST_INC_32, &capTable[UDMA_CHANNEL_ADC3],
+        UDMA_ARB_4, UDMA_MODE_MEM_SCATTER_GATHER);
+  }
+
+  // Let the driver work out the primary structure for each list, and keep a
+  // copy for the reload tasks. List 0 is set up last and runs first.
+  for (l = capLists - 1; l >= 0; l--) {
+    uDMAChannelScatterGatherSet(UDMA_CHANNEL_ADC3, capTasks, capList[l], 1);
+    capPrimary[l] = capTable[UDMA_CHANNEL_ADC3];
+  }
+
+  // One-shot timer, started by the uDMA to raise the list interrupt
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER2);
+  TimerConfigure(TIMER2_BASE, TIMER_CFG_ONE_SHOT);
+  TimerLoadSet(TIMER2_BASE, TIMER_A, 2);
+  TimerIntEnable(TIMER2_BASE, TIMER_TIMA_TIMEOUT);
+  IntEnable(INT_TIMER2A);
+}
+
+void capStop(void) {
+  uDMAChannelDisable(UDMA_CHANNEL_ADC3);
+  IntDisable(INT_TIMER2A);
+}
+
+//
+// The ADC tasks of list capNext are done: stamp its elements, pass them on in
+// ring order and fill the list again. The other list is running meanwhile and must not
+// finish before this returns, which leaves capBlocks elements of time.
+//
+void capRefill(uint32_t stamp) {
+  uint32_t span = elementSize * (SYS_CLK / capRate + 1);
+  uint8_t b;
+
+  // The last sample of each element, as the ping-pong interrupt stamps them
+  for (b = 0; b < capBlocks; b++) {
+    capElem[capNext][b]->stamp = stamp - (capBlocks - 1 - b) * span;
+    capElem[capNext][b]->tick = sysTickCount;
+    bufItemSetFree(capBuf, capElem[capNext][b]->index);
+  }
+
+  capFill(capNext);
+  capNext = (capNext + 1) % capLists;
+}
+
+void capIntHandler(void) {
+  uint32_t start = perfNow();
+
+  TimerIntClear(TIMER2_BASE, TIMER_TIMA_TIMEOUT);
+
+  // Latency from the conversion trigger of the last sample of the list
+  if (irqMeasure) {
+    irqStamp(&irqCapture, start,
+             SYS_CLK / capRate - TimerValueGet(TIMER0_BASE, TIMER_A),
+             capBlocks * elementSize * (SYS_CLK / capRate + 1));
+  }
+
+  capRefill(start);
+
+  perfStatAdd(&capIsrPerf, perfNow() - start);
+}
+
+//
+// Set SS0 and Timer3 up for burst mode. The caller sets up Timer0 and the
+// ping-pong transfers on CAP_BURST_DMA, and starts with capTimerEnable().
+//
+void capBurstConfig(void) {
+  ADCSequenceDisable(ADC0_BASE, 0);
+  ADCSequenceConfigure(ADC0_BASE, 0, ADC_TRIGGER_TIMER, 0);
+  ADCSequenceStepConfigure(ADC0_BASE, 0, 0, ADC_CTL_CH0 | ADC_CTL_END);
+  ADCSequenceOverflowClear(ADC0_BASE, 0);
+
+  // TimerLoadSet(n) counts n + 1 cycles, the period has to match Timer0's
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER3);
+  TimerConfigure(TIMER3_BASE, TIMER_CFG_PERIODIC);
+  TimerLoadSet(TIMER3_BASE, TIMER_A,
+               capBurstSize * (SYS_CLK / capRate + 1) - 1);
+
+  // Timers only make burst requests
+  uDMAChannelAssign(CAP_BURST_DMA);
+  uDMAChannelAttributeDisable(CAP_BURST_DMA, UDMA_ATTR_ALTSELECT |
+                              UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+  uDMAChannelAttributeEnable(CAP_BURST_DMA, UDMA_ATTR_USEBURST);
+  uDMAChannelControlSet(CAP_BURST_DMA | UDMA_PRI_SELECT,
+                        UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16 |
+                        CAP_BURST_ARB);
+  uDMAChannelControlSet(CAP_BURST_DMA | UDMA_ALT_SELECT,
+                        UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16 |
+                        CAP_BURST_ARB);
+
+  // The transfer done interrupt of the channel comes on the Timer3A vector
+  IntEnable(INT_TIMER3A);
+}
+
+//
+// Start sampling. In burst mode Timer3 starts half a sample after Timer0, so
+// its timeouts fall between conversions, 3 cycles per SysCtlDelay() loop.
+//
+void capTimerEnable(void) {
+  if (!capBurst) {
+    TimerEnable(TIMER0_BASE, TIMER_A);
+    return;
+  }
+
+  IntMasterDisable();
+  TimerEnable(TIMER0_BASE, TIMER_A);
+  SysCtlDelay(SYS_CLK / capRate / 6);
+  TimerEnable(TIMER3_BASE, TIMER_A);
+  IntMasterEnable();
+}
+
+void capTimerDisable(void) {
+  TimerDisable(TIMER0_BASE, TIMER_A);
+
+  if (capBurst) {
+    TimerDisable(TIMER3_BASE, TIMER_A);
+    ADCSequenceDisable(ADC0_BASE, 0);
+    uDMAChannelDisable(CAP_BURST_DMA);
+    IntDisable(INT_TIMER3A);
+  }
+}
@@ -0,0 +1,58 @@
+/*
+ * capture.h
+ * ADC capture with uDMA scatter-gather task lists or FIFO bursts
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cirbuf.h"
+#include "perf.h"
+
+// The uDMA holds capLists * capBlocks elements instead of two with ping-pong,
+// which comes out of the slack the ring leaves the recording loop.
+enum {
+  capBlocks = 2,           // Elements per task list, one interrupt per list
+  capLists = 2,            // One list runs while the other one is refilled
+  capTasks = capBlocks + 2 // ADC transfers, interrupt trigger and reload
+};
+
+// Burst mode: samples moved per uDMA request out of the 8 deep SS0 FIFO. The
+// other half of the FIFO covers the bus latency of the request. Requests come
+// half a sample after a conversion starts, which has to be done by then.
+enum {
+  capBurstSize = 4,
+  capBurstMaxRate = 400000 // Half a sample is 1.25us, a conversion takes 1us
+};
+#define CAP_BURST_ARB UDMA_ARB_4
+#define CAP_BURST_DMA UDMA_CH2_TIMER3A // Timer3A paces the requests
+
+// Set to capture with task lists instead of ping-pong on the next acqConfig()
+extern bool capScatter;
+
+// Set to capture through SS0 with burst requests on the next acqConfig()
+extern bool capBurst;
+
+// Sample rate of the next acqConfig(), up to capBurstMaxRate in burst mode
+extern uint32_t capRate;
+
+// Samples per ping-pong transfer of the next acqConfig(), elementSize but for
+// the monitor's short blocks. The task lists always move whole elements.
+extern uint16_t capSize;
+
+// Cycles spent in the capture interrupt, ping-pong or scatter-gather
+extern perfStatT capIsrPerf;
+
+void capStart(volatile bufT * buf, void * table);
+void capStop(void);
+void capRefill(uint32_t stamp);
+void capIntHandler(void);
+void capBurstConfig(void);
+void capTimerEnable(void);
+void capTimerDisable(void);
+
+#endif /* CAPTURE_H_ */
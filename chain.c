@@ -0,0 +1,108 @@
+/*
+ * chain.c
+ *
+ * The stages of a chain are picked with CHAIN_* flags at compile time, and
+ * chain_run.h is compiled once per set of flags, so each chain is one loop
+ * over the element with only its own stages in it. The chain_separate
+ * benchmark runs the same stages as CMSIS block calls, a pass over the element
+ * through memory each, next to chain_fused.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include <math.h>
+#include "chain.h"
+#include "proc.h"
+#include "conv.h"
+#include "global.h"
+
+#ifdef RAM_CODE
+#pragma CODE_SECTION(chainRun, ".ramfunc")
+#endif
+
+// Q of the two sections of a 4th order Butterworth, or of a 2nd order one
+#if CHAIN_BIQUADS > 1
+static const float32_t chainQ[CHAIN_BIQUADS] = { 0.5412f, 1.3066f };
+#else
+static const float32_t chainQ[CHAIN_BIQUADS] = { 0.7071f };
+#endif
+
+//
+// Clear the state of a chain and set it up with the default coefficients: the
+// high pass biquads at CHAIN_HP_CORNER, unity gain and the recording filter.
+//
+void chainInit(chainT * c) {
+  uint8_t s;
+
+  memset(c, 0, sizeof(*c));
+
+  for (s = 0; s < CHAIN_BIQUADS; s++) {
+    chainHighpass(c->bq[s], CHAIN_HP_CORNER, chainQ[s]);
+  }
+
+  c->gain = 1;
+  c->coeffs = firCoeffsf32;
+}
+
+//
+// High pass biquad with the given corner in Hz and Q at ADC_RATE, from the
+// Audio EQ Cookbook, normalized and in the df2T layout of chainT
+//
+void chainHighpass(float32_t * bq, float32_t corner, float32_t q) {
+  float32_t w = 2 * PI * corner / ADC_RATE;
+  float32_t cw = cosf(w);
+  float32_t alpha = sinf(w) / (2 * q);
+  float32_t a0 = 1 + alpha;
+
+  bq[0] = (1 + cw) / 2 / a0;
+  bq[1] = -(1 + cw) / a0;
+  bq[2] = bq[0];
+  bq[3] = 2 * cw / a0;
+  bq[4] = -(1 - alpha) / a0;
+}
+
+//
+// Move the gain a CHAIN_AGC_STEP share of the way to the one that puts the
+// peak of the last element at CHAIN_AGC_TARGET, within the AGC range
+//
+void chainAgc(chainT * c, float32_t peak) {
+  float32_t want = (peak > 0) ? c->gain * CHAIN_AGC_TARGET / peak :
+                                CHAIN_AGC_MAX;
+
+  c->gain += (want - c->gain) * CHAIN_AGC_STEP;
+
+  if (c->gain < CHAIN_AGC_MIN) {
+    c->gain = CHAIN_AGC_MIN;
+  }
+  else if (c->gain > CHAIN_AGC_MAX) {
+    c->gain = CHAIN_AGC_MAX;
+  }
+}
+
+// Float of the recording scale to int16 ADC counts, saturating
+static int16_t chainSat(float32_t y) {
+  y *= INT16_MAX;
+
+  if (y >= INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (y <= INT16_MIN) {
+    return INT16_MIN;
+  }
+
+  return (int16_t) y;
+}
+
+// The chain of the recording, CHAIN_STAGES
+#define CHAIN_NAME chainRun
+#define CHAIN_USE  CHAIN_STAGES
+#include "chain_run.h"
+#undef CHAIN_NAME
+#undef CHAIN_USE
+
+// Every stage, for the benchmarks
+#define CHAIN_NAME chainRunAll
+#define CHAIN_USE  CHAIN_ALL
+#include "chain_run.h"
+#undef CHAIN_NAME
+#undef CHAIN_USE
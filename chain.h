@@ -0,0 +1,69 @@
+/*
+ * chain.h
+ * Fused processing chain: DC blocker, biquads, gain or AGC and decimation in
+ * one pass per element, with the stages picked at compile time
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef CHAIN_H_
+#define CHAIN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cirbuf.h"
+
+// CMSIS
+#include "arm_math.h"
+#include "fir_filter.h"
+
+// Stages of a chain, they run in this order
+#define CHAIN_DC     0x01 // First order DC blocker
+#define CHAIN_BIQUAD 0x02 // CHAIN_BIQUADS sections
+#define CHAIN_GAIN   0x04 // Fixed gain
+#define CHAIN_AGC    0x08 // Gain set after each element from its peak
+#define CHAIN_DECIM  0x10 // Recording filter, every procDecimation-th output
+#define CHAIN_ALL    0x1f
+
+// Stages of chainRun(), which procBlock() uses with PROC_CHAIN defined
+#ifndef CHAIN_STAGES
+#define CHAIN_STAGES (CHAIN_DC | CHAIN_DECIM)
+#endif
+
+// Sections of the biquad stage, 1 or 2
+#define CHAIN_BIQUADS 2
+
+// DC blocker pole, a 25Hz corner at ADC_RATE
+#define CHAIN_DC_POLE   0.995f
+
+// Corner of the high pass biquads, a 4th order Butterworth
+#define CHAIN_HP_CORNER 100.0f
+
+// AGC: peak it aims for, share of the way it goes per element, gain range
+#define CHAIN_AGC_TARGET 0.25f
+#define CHAIN_AGC_STEP   0.1f
+#define CHAIN_AGC_MIN    0.25f
+#define CHAIN_AGC_MAX    16.0f
+
+//
+// State and coefficients of a chain. The biquads take the CMSIS df2T layout,
+// {b0, b1, b2, a1, a2} with the feedback terms negated.
+//
+typedef struct {
+  float32_t dcX;                       // Last input of the DC blocker
+  float32_t dcY;                       // Last output
+  float32_t bq[CHAIN_BIQUADS][5];
+  float32_t bqState[CHAIN_BIQUADS][2];
+  float32_t gain;
+  const float32_t * coeffs;            // Decimation filter, TAPS long
+  uint16_t pos;                        // Next history slot
+  float32_t hist[2 * TAPS];            // Each sample twice, TAPS apart
+} chainT;
+
+void chainInit(chainT * c);
+void chainHighpass(float32_t * bq, float32_t corner, float32_t q);
+void chainAgc(chainT * c, float32_t peak);
+void chainRun(chainT * c, const int16_t * adc, int16_t * out);
+void chainRunAll(chainT * c, const int16_t * adc, int16_t * out);
+
+#endif /* CHAIN_H_ */
@@ -0,0 +1,117 @@
+/*
+ * chain_run.h
+ * Body of a fused chain. chain.c includes it once per chain, with CHAIN_NAME
+ * naming the function and CHAIN_USE holding its CHAIN_* stages; the stages
+ * left out are not compiled in. No include guard on purpose.
+ *
+ *  Created on: 19-10-2026
+ */
+
+//
+// Run elementSize raw ADC samples through the stages in one pass and write
+// procOutSize samples to out, or elementSize without CHAIN_DECIM, in ADC
+// counts as procBlock() does. State and coefficients stay in registers for
+// the whole element, only the decimation history goes through memory.
+//
+void CHAIN_NAME(chainT * c, const int16_t * adc, int16_t * out) {
+  float32_t x, y;
+#if CHAIN_USE & CHAIN_DC
+  float32_t dcX = c->dcX;
+  float32_t dcY = c->dcY;
+#endif
+#if CHAIN_USE & CHAIN_BIQUAD
+  float32_t b10 = c->bq[0][0], b11 = c->bq[0][1], b12 = c->bq[0][2];
+  float32_t a11 = c->bq[0][3], a12 = c->bq[0][4];
+  float32_t d10 = c->bqState[0][0], d11 = c->bqState[0][1];
+#if CHAIN_BIQUADS > 1
+  float32_t b20 = c->bq[1][0], b21 = c->bq[1][1], b22 = c->bq[1][2];
+  float32_t a21 = c->bq[1][3], a22 = c->bq[1][4];
+  float32_t d20 = c->bqState[1][0], d21 = c->bqState[1][1];
+#endif
+#endif
+#if CHAIN_USE & (CHAIN_GAIN | CHAIN_AGC)
+  float32_t gain = c->gain;
+#endif
+#if CHAIN_USE & CHAIN_AGC
+  float32_t peak = 0;
+#endif
+#if CHAIN_USE & CHAIN_DECIM
+  const float32_t * b = c->coeffs;
+  const float32_t * h;
+  uint16_t pos = c->pos;
+  uint16_t k;
+#endif
+  uint16_t i;
+
+  for (i = 0; i < elementSize; i++) {
+    x = (float32_t) (adc[i] - CONV_ADC_OFFSET) * CONV_SCALE;
+
+#if CHAIN_USE & CHAIN_DC
+    y = x - dcX + CHAIN_DC_POLE * dcY;
+    dcX = x;
+    dcY = y;
+    x = y;
+#endif
+
+#if CHAIN_USE & CHAIN_BIQUAD
+    y = b10 * x + d10;
+    d10 = b11 * x + a11 * y + d11;
+    d11 = b12 * x + a12 * y;
+    x = y;
+#if CHAIN_BIQUADS > 1
+    y = b20 * x + d20;
+    d20 = b21 * x + a21 * y + d21;
+    d21 = b22 * x + a22 * y;
+    x = y;
+#endif
+#endif
+
+#if CHAIN_USE & (CHAIN_GAIN | CHAIN_AGC)
+    x *= gain;
+#endif
+
+#if CHAIN_USE & CHAIN_AGC
+    y = fabsf(x);
+    peak = (y > peak) ? y : peak;
+#endif
+
+#if CHAIN_USE & CHAIN_DECIM
+    // The newest TAPS samples are in a row, ending at pos + TAPS
+    c->hist[pos] = x;
+    c->hist[pos + TAPS] = x;
+
+    // Output n lines up with input n * procDecimation
+    if (!(i % procDecimation)) {
+      h = &c->hist[pos + TAPS];
+      y = 0;
+      for (k = 0; k < TAPS; k++) {
+        y += b[k] * h[-k];
+      }
+      *out++ = chainSat(y);
+    }
+
+    pos = (pos + 1 == TAPS) ? 0 : pos + 1;
+#else
+    *out++ = chainSat(x);
+#endif
+  }
+
+#if CHAIN_USE & CHAIN_DC
+  c->dcX = dcX;
+  c->dcY = dcY;
+#endif
+#if CHAIN_USE & CHAIN_BIQUAD
+  c->bqState[0][0] = d10;
+  c->bqState[0][1] = d11;
+#if CHAIN_BIQUADS > 1
+  c->bqState[1][0] = d20;
+  c->bqState[1][1] = d21;
+#endif
+#endif
+#if CHAIN_USE & CHAIN_AGC
+  chainAgc(c, peak);
+#endif
+#if CHAIN_USE & CHAIN_DECIM
+  c->pos = pos;
+#endif
+}
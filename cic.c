@@ -0,0 +1,191 @@
+/*
+ * cic.c
+ *
+ * With the ADC running ratio times faster than ADC_RATE, a cascaded
+ * integrator-comb filter brings the samples back to ADC_RATE with nothing but
+ * integer adds: order integrators at the ADC rate, then order combs on every
+ * ratio-th sum. Its response droops as sinc^order across the pass band, which
+ * the short filter of cicCompDesign() flattens out before the recording filter
+ * takes the samples the rest of the way down.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include <math.h>
+#include "cic.h"
+#include "conv.h"
+#include "global.h"
+
+// Compensated band, a bit past the recording filter cutoff, at ADC_RATE
+#define CIC_PASS (3500.0f / ADC_RATE)
+
+// Weight of the band above it, only kept from blowing up
+#define CIC_STOP_WEIGHT 0.001f
+
+enum {
+  cicGrid = 64,                       // Frequencies fitted up to half the rate
+  cicCompHalf = (cicCompTaps + 1) / 2 // Distinct coefficients of the fit
+};
+
+//
+// Set up a decimator and clear its registers. Returns false if the order or
+// the ratio is out of range, the ratio is a power of two.
+//
+bool cicInit(cicT * c, uint8_t order, uint8_t ratio) {
+  uint8_t bits = 0;
+  uint8_t i;
+
+  while ((1u << bits) < ratio) {
+    bits++;
+  }
+
+  if (!order || (order > cicMaxOrder) || (ratio < 2) ||
+      (ratio > cicMaxRatio) || ((1u << bits) != ratio) ||
+      (order * bits > cicMaxGrowth)) {
+    return false;
+  }
+
+  c->order = order;
+  c->ratio = ratio;
+  c->scale = CONV_SCALE;
+  for (i = 0; i < order * bits; i++) {
+    c->scale *= 0.5f;
+  }
+
+  memset(c->integ, 0, sizeof(c->integ));
+  memset(c->comb, 0, sizeof(c->comb));
+
+  return true;
+}
+
+//
+// Decimate n raw ADC samples, a multiple of the ratio, into n / ratio centered
+// samples scaled by CONV_SCALE, as convAdcToFloat() leaves them. The
+// integrators all run in registers whatever the order, an add each is cheaper
+// than picking them per sample.
+//
+void cicRun(cicT * c, const int16_t * adc, float32_t * out, uint16_t n) {
+  uint32_t s0 = c->integ[0];
+  uint32_t s1 = c->integ[1];
+  uint32_t s2 = c->integ[2];
+  uint32_t s3 = c->integ[3];
+  uint32_t s4 = c->integ[4];
+  uint32_t x, y;
+  uint16_t i, j;
+  uint8_t k;
+
+  for (i = 0; i < n; i += c->ratio) {
+    for (j = 0; j < c->ratio; j++) {
+      s0 += (uint32_t) (adc[i + j] - CONV_ADC_OFFSET);
+      s1 += s0;
+      s2 += s1;
+      s3 += s2;
+      s4 += s3;
+    }
+
+    switch (c->order) {
+    case 1:
+      x = s0;
+      break;
+    case 2:
+      x = s1;
+      break;
+    case 3:
+      x = s2;
+      break;
+    case 4:
+      x = s3;
+      break;
+    default:
+      x = s4;
+      break;
+    }
+
+    for (k = 0; k < c->order; k++) {
+      y = x - c->comb[k];
+      c->comb[k] = x;
+      x = y;
+    }
+
+    *out++ = (float32_t) (int32_t) x * c->scale;
+  }
+
+  c->integ[0] = s0;
+  c->integ[1] = s1;
+  c->integ[2] = s2;
+  c->integ[3] = s3;
+  c->integ[4] = s4;
+}
+
+//
+// Gain of the decimator at f, a fraction of ADC_RATE
+//
+float32_t cicDroop(uint8_t order, uint8_t ratio, float32_t f) {
+  float32_t d;
+  uint8_t i;
+  float32_t g = 1;
+
+  if (f == 0) {
+    return 1;
+  }
+
+  d = fabsf(sinf(PI * f) / (ratio * sinf(PI * f / ratio)));
+  for (i = 0; i < order; i++) {
+    g *= d;
+  }
+
+  return g;
+}
+
+//
+// Linear phase filter of cicCompTaps at ADC_RATE with the inverse of the droop
+// up to CIC_PASS, fitted by least squares. The symmetric half of the
+// coefficients solves the normal equations, a cicCompHalf square system.
+//
+void cicCompDesign(float32_t * coeffs, uint8_t order, uint8_t ratio) {
+  float32_t a[cicCompHalf][cicCompHalf + 1];
+  float32_t b[cicCompHalf];
+  float32_t f, w, d, q;
+  uint8_t i, j, k;
+
+  memset(a, 0, sizeof(a));
+
+  for (k = 0; k <= cicGrid; k++) {
+    f = 0.5f * k / cicGrid;
+    w = (f <= CIC_PASS) ? 1 : CIC_STOP_WEIGHT;
+    d = 1 / cicDroop(order, ratio, (f <= CIC_PASS) ? f : CIC_PASS);
+
+    // Amplitude of the filter is b . half
+    for (i = 0; i < cicCompHalf; i++) {
+      b[i] = i ? 2 * cosf(2 * PI * f * i) : 1;
+    }
+
+    for (i = 0; i < cicCompHalf; i++) {
+      for (j = 0; j < cicCompHalf; j++) {
+        a[i][j] += w * b[i] * b[j];
+      }
+      a[i][cicCompHalf] += w * b[i] * d;
+    }
+  }
+
+  // Gaussian elimination, the system is positive definite
+  for (i = 0; i < cicCompHalf; i++) {
+    for (j = i + 1; j < cicCompHalf; j++) {
+      q = a[j][i] / a[i][i];
+      for (k = i; k <= cicCompHalf; k++) {
+        a[j][k] -= q * a[i][k];
+      }
+    }
+  }
+
+  for (i = cicCompHalf; i-- > 0;) {
+    q = a[i][cicCompHalf];
+    for (j = i + 1; j < cicCompHalf; j++) {
+      q -= a[i][j] * a[j][cicCompHalf];
+    }
+    a[i][cicCompHalf] = q / a[i][i];
+
+    coeffs[cicCompHalf - 1 - i] = a[i][cicCompHalf];
+    coeffs[cicCompHalf - 1 + i] = a[i][cicCompHalf];
+  }
+}
@@ -0,0 +1,42 @@
+/*
+ * cic.h
+ * Integer CIC decimator and its droop compensation filter for oversampling
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef CIC_H_
+#define CIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// CMSIS
+#include "arm_math.h"
+
+// The registers hold the 12-bit samples times ratio^order, which has to fit
+// in 32 bits: order * log2(ratio) <= cicMaxGrowth.
+enum {
+  cicMaxOrder = 5,
+  cicMaxRatio = 16,  // 512ksps, the ADC does 1Msps
+  cicMaxGrowth = 20, // Bits of gain
+  cicOrder = 4,      // Default order, aliases come in 70dB down or more
+  cicCompTaps = 7,   // Least squares fit, flat to 0.05dB up to 3.4kHz
+  cicGainBits = 4    // Output bits above the ADC's, to keep what the
+                     // oversampling adds
+};
+
+typedef struct {
+  uint8_t order;
+  uint8_t ratio;
+  float32_t scale;             // Output scale, CONV_SCALE / ratio^order
+  uint32_t integ[cicMaxOrder]; // Wrap around, only the comb outputs count
+  uint32_t comb[cicMaxOrder];  // Last input of each comb
+} cicT;
+
+bool cicInit(cicT * c, uint8_t order, uint8_t ratio);
+void cicRun(cicT * c, const int16_t * adc, float32_t * out, uint16_t n);
+float32_t cicDroop(uint8_t order, uint8_t ratio, float32_t f);
+void cicCompDesign(float32_t * coeffs, uint8_t order, uint8_t ratio);
+
+#endif /* CIC_H_ */
@@ -6,6 +6,34 @@
  */
 #include "cirbuf.h"
 #include "stdbool.h"
+#include "driverlib/interrupt.h"
+
+// Both ends of the ring run in SRAM with RAM_CODE, see global.h
+#ifdef RAM_CODE
+#pragma CODE_SECTION(bufCountAdd, ".ramfunc")
+#pragma CODE_SECTION(bufIsFull, ".ramfunc")
+#pragma CODE_SECTION(bufIsEmpty, ".ramfunc")
+#pragma CODE_SECTION(bufIS, ".ramfunc")
+#pragma CODE_SECTION(bufItemSetFree, ".ramfunc")
+#pragma CODE_SECTION(bufItemIsBusy, ".ramfunc")
+#pragma CODE_SECTION(bufGetFree, ".ramfunc")
+#pragma CODE_SECTION(bufGet, ".ramfunc")
+#endif
+
+//
+// The count is changed by both ends of the ring, and one of them runs in an
+// interrupt that may preempt the other at any priority. The add is masked,
+// the rest of the ring is only written by one end.
+//
+static void bufCountAdd(volatile bufT * buf, int8_t n) {
+  bool masked = IntMasterDisable();
+
+  buf->count += n;
+
+  if (!masked) {
+    IntMasterEnable();
+  }
+}
 
 // Init the data buffer
 void bufInit(volatile bufT * buf) {
@@ -91,7 +119,7 @@ elementT * bufGetFree(volatile bufT * buf) {
   }
   else {
     // Increase element counter
-    buf->count++;
+    bufCountAdd(buf, 1);
 
     // Element index for return
     buf->front = bufIS(++buf->front);
@@ -130,7 +158,7 @@ elementT * bufGet(volatile bufT * buf) {
     }
     else {
       // Decrease element counter
-      buf->count--;
+      bufCountAdd(buf, -1);
 
       // Set element status in READING
       buf->item[i].status = READ;
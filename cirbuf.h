@@ -31,6 +31,9 @@ typedef struct bufElement {
 
   elementIndexT index;
   elementStatusT status; // Status of the element
+
+  uint32_t stamp; // Cycle counter at the capture ISR after its last sample
+  uint32_t tick;  // SysTick count at the same time
 } elementT;
 
 typedef struct {
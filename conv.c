@@ -0,0 +1,197 @@
+/*
+ * conv.c
+ *
+ * Every function has a Cortex-M4 SIMD, a host SSE2/AVX2 and a plain C
+ * version. The vector code handles the bulk of the block and the plain C loop
+ * the rest, so all versions give bit-identical results.
+ *
+ *  Created on: 19-10-2026
+ */
+#include "conv.h"
+
+#if defined(ARM_MATH_CM4)
+#include "arm_math.h"
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Both 16-bit halves of a word hold the ADC offset
+#define CONV_ADC_OFFSET2 ((CONV_ADC_OFFSET << 16) | CONV_ADC_OFFSET)
+
+// The conversions around the filter, in SRAM with RAM_CODE
+#ifdef RAM_CODE
+#pragma CODE_SECTION(convAdcToFloat, ".ramfunc")
+#pragma CODE_SECTION(convFloatToInt, ".ramfunc")
+#endif
+
+//
+// Remove the ADC offset in place, giving centered int16 samples.
+//
+void convAdcToInt(int16_t * data, uint16_t n) {
+  uint16_t i = 0;
+
+#if defined(ARM_MATH_CM4)
+  uint32_t * p = (uint32_t *) data;
+
+  for (; i + 2 <= n; i += 2) {
+    *p = __SSUB16(*p, CONV_ADC_OFFSET2);
+    p++;
+  }
+#elif defined(__SSE2__)
+  __m128i offset = _mm_set1_epi16(CONV_ADC_OFFSET);
+
+  for (; i + 8 <= n; i += 8) {
+    _mm_storeu_si128((__m128i *) &data[i],
+                     _mm_sub_epi16(_mm_loadu_si128((__m128i *) &data[i]),
+                                   offset));
+  }
+#endif
+
+  for (; i < n; i++) {
+    data[i] -= CONV_ADC_OFFSET;
+  }
+}
+
+//
+// Remove the ADC offset and convert to float with the CONV_SCALE of the
+// recording chain in one pass. The ADC samples are left untouched.
+//
+void convAdcToFloat(const int16_t * adc, float * out, uint16_t n) {
+  uint16_t i = 0;
+
+#if defined(ARM_MATH_CM4)
+  const uint32_t * p = (const uint32_t *) adc;
+  uint32_t a, b;
+
+  for (; i + 4 <= n; i += 4) {
+    a = __SSUB16(*p++, CONV_ADC_OFFSET2);
+    b = __SSUB16(*p++, CONV_ADC_OFFSET2);
+
+    out[i] = (float) (int16_t) a * CONV_SCALE;
+    out[i + 1] = (float) ((int32_t) a >> 16) * CONV_SCALE;
+    out[i + 2] = (float) (int16_t) b * CONV_SCALE;
+    out[i + 3] = (float) ((int32_t) b >> 16) * CONV_SCALE;
+  }
+#elif defined(__AVX2__)
+  __m256i offset = _mm256_set1_epi32(CONV_ADC_OFFSET);
+  __m256 scale = _mm256_set1_ps(CONV_SCALE);
+  __m256i x;
+
+  for (; i + 8 <= n; i += 8) {
+    x = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) &adc[i]));
+    x = _mm256_sub_epi32(x, offset);
+    _mm256_storeu_ps(&out[i], _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+  }
+#elif defined(__SSE2__)
+  __m128i offset = _mm_set1_epi16(CONV_ADC_OFFSET);
+  __m128 scale = _mm_set1_ps(CONV_SCALE);
+  __m128i x;
+
+  for (; i + 8 <= n; i += 8) {
+    x = _mm_sub_epi16(_mm_loadu_si128((__m128i *) &adc[i]), offset);
+
+    // Sign extend to 32 bits by unpacking into the high halves
+    _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(
+                  _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), scale));
+    _mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(
+                  _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), scale));
+  }
+#endif
+
+  for (; i < n; i++) {
+    out[i] = (float) (adc[i] - CONV_ADC_OFFSET) * CONV_SCALE;
+  }
+}
+
+//
+// Convert int16 samples to float, multiplying by scale.
+//
+void convIntToFloat(const int16_t * in, float * out, uint16_t n, float scale) {
+  uint16_t i = 0;
+
+#if defined(ARM_MATH_CM4)
+  const uint32_t * p = (const uint32_t *) in;
+  uint32_t a;
+
+  for (; i + 2 <= n; i += 2) {
+    a = *p++;
+
+    out[i] = (float) (int16_t) a * scale;
+    out[i + 1] = (float) ((int32_t) a >> 16) * scale;
+  }
+#elif defined(__AVX2__)
+  __m256 s = _mm256_set1_ps(scale);
+  __m256i x;
+
+  for (; i + 8 <= n; i += 8) {
+    x = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) &in[i]));
+    _mm256_storeu_ps(&out[i], _mm256_mul_ps(_mm256_cvtepi32_ps(x), s));
+  }
+#elif defined(__SSE2__)
+  __m128 s = _mm_set1_ps(scale);
+  __m128i x;
+
+  for (; i + 8 <= n; i += 8) {
+    x = _mm_loadu_si128((__m128i *) &in[i]);
+
+    _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(
+                  _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), s));
+    _mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(
+                  _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), s));
+  }
+#endif
+
+  for (; i < n; i++) {
+    out[i] = (float) in[i] * scale;
+  }
+}
+
+//
+// Convert in[0], in[stride], ... in[(n - 1) * stride] multiplied by scale to
+// int16, saturating instead of wrapping around on overload. Rounds toward zero
+// like a C cast.
+//
+void convFloatToInt(const float * in, int16_t * out, uint16_t n,
+                    uint16_t stride, float scale) {
+  uint16_t i = 0;
+  float x;
+
+#if defined(ARM_MATH_CM4)
+  // VCVT saturates to the int32 range, SSAT then to int16
+  for (; i < n; i++) {
+    out[i] = (int16_t) __SSAT((int32_t) (in[i * stride] * scale), 16);
+  }
+#elif defined(__SSE2__)
+  __m128 s = _mm_set1_ps(scale);
+  __m128 hi = _mm_set1_ps(INT16_MAX);
+  __m128 lo = _mm_set1_ps(INT16_MIN);
+  __m128i a, b;
+
+  if (stride == 1) {
+    for (; i + 8 <= n; i += 8) {
+      // Clamp first, out of range values would convert to INT32_MIN
+      a = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(
+          _mm_mul_ps(_mm_loadu_ps(&in[i]), s), hi), lo));
+      b = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(
+          _mm_mul_ps(_mm_loadu_ps(&in[i + 4]), s), hi), lo));
+      _mm_storeu_si128((__m128i *) &out[i], _mm_packs_epi32(a, b));
+    }
+  }
+#endif
+
+  for (; i < n; i++) {
+    x = in[i * stride] * scale;
+
+    if (x >= INT16_MAX) {
+      out[i] = INT16_MAX;
+    }
+    else if (x <= INT16_MIN) {
+      out[i] = INT16_MIN;
+    }
+    else {
+      out[i] = (int16_t) x;
+    }
+  }
+}
@@ -0,0 +1,25 @@
+/*
+ * conv.h
+ * Block conversion kernels between ADC samples, int16 and float
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef CONV_H_
+#define CONV_H_
+
+#include <stdint.h>
+
+// Offset of the 12-bit offset binary ADC samples
+#define CONV_ADC_OFFSET 2048
+
+// int16 to float scale of the recording chain (samples / INT16_MAX)
+#define CONV_SCALE      (1.0f / INT16_MAX)
+
+void convAdcToInt(int16_t * data, uint16_t n);
+void convAdcToFloat(const int16_t * adc, float * out, uint16_t n);
+void convIntToFloat(const int16_t * in, float * out, uint16_t n, float scale);
+void convFloatToInt(const float * in, int16_t * out, uint16_t n,
+                    uint16_t stride, float scale);
+
+#endif /* CONV_H_ */
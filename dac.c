@@ -5,6 +5,16 @@
  *      Author: boyhuesd
  */
 #include "dac.h"
+#include "irq.h"
+#include "perf.h"
+
+#ifdef RAM_CODE
+#pragma CODE_SECTION(dacFetch, ".ramfunc")
+#pragma CODE_SECTION(dacIntHandler, ".ramfunc")
+#endif
+
+volatile uint16_t dacLength = elementSize;
+elementT * (* volatile dacNext)(void);
 
 void dacSetup(void) {
   // Enable Peripheral Clocks
@@ -24,13 +34,21 @@ void dacSetup(void) {
   TimerConfigure(TIMER1_BASE, TIMER_CFG_PERIODIC);
 
   // Set timer to trigger ADC at rate 8000Hz
-  TimerLoadSet(TIMER1_BASE, TIMER_A, SYS_CLK/8000); // DAC output rate
+  dacPeriodSet(SYS_CLK/DAC_RATE + 1); // DAC output rate
 
   // Interrupt for timer1
   IntEnable(INT_TIMER1A);
   TimerIntEnable(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
 }
 
+//
+// Set the time between two DAC samples in cycles. TimerLoadSet(n) counts
+// n + 1 of them.
+//
+void dacPeriodSet(uint32_t cycles) {
+  TimerLoadSet(TIMER1_BASE, TIMER_A, cycles - 1);
+}
+
 void dacEnable(void) {
   // Enable timer
   TimerEnable(TIMER1_BASE, TIMER_A);
@@ -49,10 +67,23 @@ void dacDisable(void) {
   PWMGenDisable(PWM0_BASE, PWM_GEN_2);
 }
 
+static elementT * dacFetch(void) {
+  return dacNext ? dacNext() : bufGet(gpBuf);
+}
+
 void dacIntHandler(void) {
+  uint32_t now = perfNow();
+
   // Clear timer
   TimerIntClear(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
 
+  // The timer counts down from its load since the timeout
+  if (irqMeasure) {
+    irqStamp(&irqDac, now,
+             SYS_CLK/DAC_RATE - TimerValueGet(TIMER1_BASE, TIMER_A),
+             SYS_CLK/DAC_RATE + 1);
+  }
+
   // Output the DAC value
   if (dacBuf) {
     // Data now in int16 format, must add 2048 before output
@@ -63,17 +94,19 @@ void dacIntHandler(void) {
       dacDisable(); // Stop DAC output
     }
 
+    // Its first sample goes out at the next tick
     dacIndex = 0;
-    dacBuf = bufGet(gpBuf); // Try to get the data again
+    dacBuf = dacFetch(); // Try to get the data again
+    return;
   }
 
   dacIndex++;
-  if (dacIndex == 512) {
+  if (dacIndex == dacLength) {
     // Remember to set buffer item FREE after using it
     bufItemSetFree(gpBuf, dacBuf->index);
 
     dacIndex = 0; // Reset output index
-    dacBuf = bufGet(gpBuf); // Get new data
+    dacBuf = dacFetch(); // Get new data
   }
 }
 
@@ -30,12 +30,23 @@
 #include "cirbuf.h"
 #include "global.h"
 
+// Output sample rate of the PWM DAC
+#define DAC_RATE 8000
+
 extern volatile uint16_t dacIndex;
 extern volatile elementT * dacBuf;
 extern volatile bufT * gpBuf;
 extern volatile bool stop;
 
+// Samples played of each element, elementSize but for the monitor's blocks
+extern volatile uint16_t dacLength;
+
+// Where the DAC takes its next element from when set, in place of the ring
+// gpBuf. It runs in the DAC interrupt and returns 0 when it has none.
+extern elementT * (* volatile dacNext)(void);
+
 void dacSetup(void);
+void dacPeriodSet(uint32_t cycles);
 void dacEnable(void);
 void dacDisable(void);
 void dacIntHandler(void);
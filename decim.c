@@ -0,0 +1,183 @@
+/*
+ * decim.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "decim.h"
+#include "conv.h"
+
+// CMSIS
+#include "arm_math.h"
+#include "fir_filter.h"
+
+// Filter state, shared as only one kernel is in use at a time
+static float32_t decimState[TAPS - 1 + decimSub];
+
+// Fixed point copies of firCoeffsf32
+static q15_t coeffsQ15[TAPS];
+static q31_t coeffsQ31[TAPS];
+
+static arm_fir_instance_f32 firF32;
+static arm_fir_decimate_instance_f32 decF32;
+static arm_fir_decimate_instance_q15 decQ15;
+static arm_fir_decimate_instance_q31 decQ31;
+
+//
+// The recording chain: arm_fir_f32 at the full rate, then every
+// procDecimation-th output kept.
+//
+static void decimF32Init(void) {
+  arm_fir_init_f32(&firF32, TAPS, (float32_t *) firCoeffsf32, decimState,
+                   BLOCK_SIZE);
+}
+
+static void decimF32Run(const int16_t * in, float * out, void * scratch) {
+  float32_t * x = scratch;
+  float32_t * y = x + BLOCK_SIZE;
+  uint16_t b, i;
+
+  for (b = 0; b < elementSize / BLOCK_SIZE; b++) {
+    convIntToFloat(in + b * BLOCK_SIZE, x, BLOCK_SIZE, CONV_SCALE);
+
+    arm_fir_f32(&firF32, x, y, BLOCK_SIZE);
+
+    for (i = 0; i < BLOCK_SIZE; i += procDecimation) {
+      *out++ = y[i] * INT16_MAX;
+    }
+  }
+}
+
+//
+// CMSIS polyphase decimator, only the kept outputs are computed.
+//
+static void decimPolyInit(void) {
+  arm_fir_decimate_init_f32(&decF32, TAPS, procDecimation,
+                            (float32_t *) firCoeffsf32, decimState, decimSub);
+}
+
+static void decimPolyRun(const int16_t * in, float * out, void * scratch) {
+  float32_t * x = scratch;
+  float32_t * y = x + decimSub;
+  uint16_t b, i;
+
+  for (b = 0; b < elementSize / decimSub; b++) {
+    convIntToFloat(in + b * decimSub, x, decimSub, CONV_SCALE);
+
+    arm_fir_decimate_f32(&decF32, x, y, decimSub);
+
+    for (i = 0; i < decimSub / procDecimation; i++) {
+      *out++ = y[i] * INT16_MAX;
+    }
+  }
+}
+
+//
+// Q15 decimator. The 12-bit samples are shifted up to use the full Q15 range.
+//
+static void decimQ15Init(void) {
+  arm_fir_decimate_init_q15(&decQ15, TAPS, procDecimation, coeffsQ15,
+                            (q15_t *) decimState, decimSub);
+}
+
+static void decimQ15Run(const int16_t * in, float * out, void * scratch) {
+  q15_t * x = scratch;
+  q15_t * y = x + decimSub;
+  uint16_t b, i;
+
+  for (b = 0; b < elementSize / decimSub; b++) {
+    for (i = 0; i < decimSub; i++) {
+      x[i] = in[b * decimSub + i] * 16;
+    }
+
+    arm_fir_decimate_q15(&decQ15, x, y, decimSub);
+
+    for (i = 0; i < decimSub / procDecimation; i++) {
+      *out++ = (float32_t) y[i] / 16;
+    }
+  }
+}
+
+//
+// Q31 decimator.
+//
+static void decimQ31Init(void) {
+  arm_fir_decimate_init_q31(&decQ31, TAPS, procDecimation, coeffsQ31,
+                            (q31_t *) decimState, decimSub);
+}
+
+static void decimQ31Run(const int16_t * in, float * out, void * scratch) {
+  q31_t * x = scratch;
+  q31_t * y = x + decimSub;
+  uint16_t b, i;
+
+  for (b = 0; b < elementSize / decimSub; b++) {
+    for (i = 0; i < decimSub; i++) {
+      x[i] = (q31_t) in[b * decimSub + i] * (1 << 20);
+    }
+
+    arm_fir_decimate_q31(&decQ31, x, y, decimSub);
+
+    for (i = 0; i < decimSub / procDecimation; i++) {
+      *out++ = (float32_t) y[i] / (1 << 20);
+    }
+  }
+}
+
+//
+// Float decimator exploiting the symmetric (linear phase) coefficients: the two
+// samples sharing a coefficient are added first, which halves the multiplies.
+// TAPS must be odd. Works in ADC counts, so no scaling is needed. The window
+// is built in the scratch, decimState keeps the history between elements.
+//
+static void decimFoldedInit(void) {
+  memset(decimState, 0, sizeof(decimState));
+}
+
+static void decimFoldedRun(const int16_t * in, float * out, void * scratch) {
+  float32_t * x = scratch; // TAPS - 1 history samples, then new samples
+  const float32_t * h = firCoeffsf32;
+  const float32_t * p;
+  float32_t acc;
+  uint16_t b, i, k;
+
+  memcpy(x, decimState, (TAPS - 1) * sizeof(float32_t));
+
+  for (b = 0; b < elementSize / decimSub; b++) {
+    for (i = 0; i < decimSub; i++) {
+      x[TAPS - 1 + i] = in[b * decimSub + i];
+    }
+
+    for (i = 0; i < decimSub / procDecimation; i++) {
+      // p[TAPS - 1] is the newest sample of this output
+      p = x + i * procDecimation;
+
+      acc = h[TAPS / 2] * p[TAPS / 2];
+      for (k = 0; k < TAPS / 2; k++) {
+        acc += h[k] * (p[TAPS - 1 - k] + p[k]);
+      }
+
+      *out++ = acc;
+    }
+
+    memmove(x, x + decimSub, (TAPS - 1) * sizeof(float32_t));
+  }
+
+  memcpy(decimState, x, (TAPS - 1) * sizeof(float32_t));
+}
+
+const decimT decimKernels[] = {
+  { "f32",       decimF32Init,    decimF32Run,    0 },
+  { "polyphase", decimPolyInit,   decimPolyRun,   procDecimation - 1 },
+  { "q15",       decimQ15Init,    decimQ15Run,    procDecimation - 1 },
+  { "q31",       decimQ31Init,    decimQ31Run,    procDecimation - 1 },
+  { "folded",    decimFoldedInit, decimFoldedRun, 0 },
+};
+
+const uint8_t decimNumKernels = sizeof(decimKernels) / sizeof(decimT);
+
+// Prepare the fixed point coefficients. Call once before using the kernels.
+void decimInit(void) {
+  arm_float_to_q15((float32_t *) firCoeffsf32, coeffsQ15, TAPS);
+  arm_float_to_q31((float32_t *) firCoeffsf32, coeffsQ31, TAPS);
+}
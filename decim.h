@@ -0,0 +1,40 @@
+/*
+ * decim.h
+ * Decimating FIR kernel variants for the recording filter
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef DECIM_H_
+#define DECIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "proc.h"
+
+enum {
+  decimSub = elementSize / procDecimation, // Input samples per kernel pass
+  decimScratchSize = 1024                  // Bytes of scratch used by run()
+};
+
+//
+// A decimate-by-procDecimation kernel using the coefficients in fir_filter.h.
+// run() takes elementSize centered ADC counts and writes procOutSize outputs,
+// also in ADC counts but not rounded. Output n lines up with input
+// n * procDecimation + phase: 0 when it keeps every procDecimation-th output
+// of the full rate filter, as procBlock() does, and procDecimation - 1 for
+// arm_fir_decimate_*(), which takes the newest of each procDecimation inputs.
+//
+typedef struct {
+  const char * name;
+  void (*init)(void);
+  void (*run)(const int16_t * in, float * out, void * scratch);
+  uint8_t phase;
+} decimT;
+
+extern const decimT decimKernels[];
+extern const uint8_t decimNumKernels;
+
+void decimInit(void);
+
+#endif /* DECIM_H_ */
@@ -0,0 +1,404 @@
+/*
+ * dirlist.c
+ *
+ * Listings that stay quick in a directory of thousands of recordings. A page
+ * in directory order stops reading at its end. A sorted page keeps only its
+ * own entries, the smallest ones after the last entry of the page before, so
+ * it costs one pass over the directory per page up to it and no more memory
+ * than a page.
+ *
+ * The recorder appends an entry to DIRIDX_NAME in the directory of each
+ * recording. Reading it from the end gives the newest recordings in time
+ * proportional to the entries shown, and a binary search finds a date, as
+ * the entries are in the order of the clock. Recording over a file adds a
+ * second entry for it, and deleting a file does not remove its entry.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <ctype.h>
+#include <string.h>
+#include "dirlist.h"
+#include "utils/uartstdio.h"
+
+//
+// Match a name against a pattern with * for any run of characters and ? for
+// any one, ignoring case
+//
+bool dirMatch(const char * pattern, const char * name) {
+  const char * star = 0;
+  const char * back = 0;
+
+  while (*name) {
+    if ((*pattern == '?') || (toupper((uint8_t) *pattern) ==
+                              toupper((uint8_t) *name))) {
+      pattern++;
+      name++;
+    }
+    else if (*pattern == '*') {
+      star = pattern++;
+      back = name;
+    }
+    else if (star) {
+      pattern = star + 1;
+      name = ++back;
+    }
+    else {
+      return false;
+    }
+  }
+
+  while (*pattern == '*') {
+    pattern++;
+  }
+
+  return !*pattern;
+}
+
+//
+// FAT date of a YYYYMMDD argument, 0 if it is not one
+//
+uint16_t dirDate(const char * arg) {
+  uint32_t y, m, d;
+  uint8_t i;
+
+  for (i = 0; i < 8; i++) {
+    if (!isdigit((uint8_t) arg[i])) {
+      return 0;
+    }
+  }
+
+  y = (arg[0] - '0') * 1000 + (arg[1] - '0') * 100 + (arg[2] - '0') * 10 +
+      (arg[3] - '0');
+  m = (arg[4] - '0') * 10 + (arg[5] - '0');
+  d = (arg[6] - '0') * 10 + (arg[7] - '0');
+
+  if ((y < 1980) || (y > 2107) || !m || (m > 12) || !d || (d > 31)) {
+    return 0;
+  }
+
+  return (uint16_t) (((y - 1980) << 9) | (m << 5) | d);
+}
+
+//
+// One line as Cmd_ls prints it
+//
+void dirPrint(const dirEntryT * e) {
+  UARTprintf("%c%c%c%c%c %u/%02u/%02u %02u:%02u %9u  %s\n",
+             (e->attrib & AM_DIR) ? 'D' : '-',
+             (e->attrib & AM_RDO) ? 'R' : '-',
+             (e->attrib & AM_HID) ? 'H' : '-',
+             (e->attrib & AM_SYS) ? 'S' : '-',
+             (e->attrib & AM_ARC) ? 'A' : '-',
+             (e->date >> 9) + 1980, (e->date >> 5) & 15, e->date & 31,
+             (e->time >> 11), (e->time >> 5) & 63, e->size, e->name);
+}
+
+static void dirFill(dirEntryT * e, const FILINFO * info) {
+  memset(e, 0, sizeof(*e));
+  e->size = info->fsize;
+  e->date = info->fdate;
+  e->time = info->ftime;
+  e->attrib = info->fattrib;
+  // Both hold an 8.3 name, the memset leaves the terminator
+  memcpy(e->name, info->fname, sizeof(e->name) - 1);
+}
+
+static bool dirKeep(const dirQueryT * q, const dirEntryT * e) {
+  if (q->match && !dirMatch(q->match, e->name)) {
+    return false;
+  }
+  if (q->dateHi && ((e->date < q->dateLo) || (e->date > q->dateHi))) {
+    return false;
+  }
+
+  return true;
+}
+
+// Order of a sorted listing. Names are unique in a directory, so no two
+// entries compare equal.
+static int dirCompare(const dirQueryT * q, const dirEntryT * a,
+                      const dirEntryT * b) {
+  uint32_t ka, kb;
+
+  if (q->sort == dirSortDate) {
+    ka = ((uint32_t) a->date << 16) | a->time;
+    kb = ((uint32_t) b->date << 16) | b->time;
+    if (ka != kb) {
+      return (ka < kb) ? -1 : 1;
+    }
+  }
+
+  return strcmp(a->name, b->name);
+}
+
+//
+// A page in directory order, reading no further than the entry after it
+//
+static FRESULT dirListPlain(DIR * dir, FILINFO * info, const char * path,
+                            const dirQueryT * q) {
+  dirEntryT e;
+  uint32_t skip = (uint32_t) q->page * q->size;
+  uint32_t matched = 0;
+  uint16_t shown = 0;
+  bool more = false;
+  FRESULT res;
+
+  res = f_opendir(dir, path);
+
+  while (res == FR_OK) {
+    res = f_readdir(dir, info);
+    if ((res != FR_OK) || !info->fname[0]) {
+      break;
+    }
+
+    dirFill(&e, info);
+    if (!dirKeep(q, &e) || (matched++ < skip)) {
+      continue;
+    }
+
+    if (shown == q->size) {
+      more = true;
+      break;
+    }
+
+    dirPrint(&e);
+    shown++;
+  }
+
+  if (res == FR_OK) {
+    UARTprintf("\n%u shown%s\n", shown,
+               more ? ", more on the next page" : "");
+  }
+
+  return res;
+}
+
+//
+// List the page of entries of the directory at path that q asks for
+//
+FRESULT dirList(DIR * dir, FILINFO * info, const char * path,
+                const dirQueryT * q) {
+  dirEntryT * page = q->arena;
+  dirEntryT e;
+  dirEntryT last;
+  uint16_t size = (q->size < q->arenaSize) ? q->size : q->arenaSize;
+  uint16_t n = 0;
+  uint16_t pass;
+  uint16_t i;
+  uint32_t matched = 0;
+  FRESULT res = FR_OK;
+
+  if (q->sort == dirSortNone) {
+    return dirListPlain(dir, info, path, q);
+  }
+
+  for (pass = 0; pass <= q->page; pass++) {
+    // The next page starts after the last entry of this one
+    if (pass) {
+      if (n < size) {
+        n = 0;
+        matched = 0;
+        break;
+      }
+      last = page[n - 1];
+    }
+
+    n = 0;
+    matched = 0;
+
+    res = f_opendir(dir, path);
+    while (res == FR_OK) {
+      res = f_readdir(dir, info);
+      if ((res != FR_OK) || !info->fname[0]) {
+        break;
+      }
+
+      dirFill(&e, info);
+      if (!dirKeep(q, &e) || (pass && (dirCompare(q, &e, &last) <= 0))) {
+        continue;
+      }
+
+      matched++;
+      if ((n == size) && (dirCompare(q, &e, &page[n - 1]) >= 0)) {
+        continue;
+      }
+
+      // Insert in order, dropping the last entry of a full page
+      i = (n < size) ? n++ : n - 1;
+      while ((i > 0) && (dirCompare(q, &e, &page[i - 1]) < 0)) {
+        page[i] = page[i - 1];
+        i--;
+      }
+      page[i] = e;
+    }
+
+    if (res != FR_OK) {
+      return res;
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    dirPrint(&page[i]);
+  }
+
+  UARTprintf("\n%u shown, %u after them\n", n, matched - n);
+
+  return FR_OK;
+}
+
+static FRESULT dirIndexRead(FIL * idx, uint32_t i, dirEntryT * e) {
+  FRESULT res;
+  UINT br;
+
+  res = f_lseek(idx, i * sizeof(*e));
+  if (res == FR_OK) {
+    res = f_read(idx, e, sizeof(*e), &br);
+  }
+  if ((res == FR_OK) && (br != sizeof(*e))) {
+    res = FR_INT_ERR;
+  }
+
+  return res;
+}
+
+// Path of the index of the directory in the first len characters of path
+static FRESULT dirIndexPath(char * dst, uint32_t dstSize, const char * path,
+                            uint32_t len) {
+  if (len + 1 + sizeof(DIRIDX_NAME) > dstSize) {
+    return FR_INVALID_NAME;
+  }
+
+  memcpy(dst, path, len);
+  dst[len] = '/';
+  strcpy(dst + len + 1, DIRIDX_NAME);
+
+  return FR_OK;
+}
+
+//
+// Newest recordings first out of the index of the directory at path. With a
+// date range, the newest one in it is found by a binary search.
+//
+FRESULT dirRecent(FIL * idx, const char * path, const dirQueryT * q) {
+  char name[80];
+  dirEntryT e;
+  uint32_t skip = (uint32_t) q->page * q->size;
+  uint32_t n, lo, hi, mid;
+  uint16_t shown = 0;
+  FRESULT res;
+
+  res = dirIndexPath(name, sizeof(name), path,
+                     strcmp(path, "/") ? strlen(path) : 0);
+  if (res == FR_OK) {
+    res = f_open(idx, name, FA_READ);
+  }
+  if (res != FR_OK) {
+    return res;
+  }
+
+  n = f_size(idx) / sizeof(e);
+
+  // First entry after the range
+  hi = n;
+  if (q->dateHi) {
+    lo = 0;
+    while ((res == FR_OK) && (lo < hi)) {
+      mid = lo + (hi - lo) / 2;
+      res = dirIndexRead(idx, mid, &e);
+      if (res != FR_OK) {
+        break;
+      }
+      if (e.date <= q->dateHi) {
+        lo = mid + 1;
+      }
+      else {
+        hi = mid;
+      }
+    }
+  }
+
+  while ((res == FR_OK) && hi-- && (shown < q->size)) {
+    res = dirIndexRead(idx, hi, &e);
+    if ((res != FR_OK) || (q->dateHi && (e.date < q->dateLo))) {
+      break;
+    }
+
+    if ((q->match && !dirMatch(q->match, e.name)) || (skip && skip--)) {
+      continue;
+    }
+
+    dirPrint(&e);
+    shown++;
+  }
+
+  f_close(idx);
+
+  if (res == FR_OK) {
+    UARTprintf("\n%u shown of %u recordings\n", shown, n);
+  }
+
+  return res;
+}
+
+//
+// Number of entries in the index of the directory at path, 0 without one
+//
+uint32_t dirIndexCount(FIL * idx, const char * path) {
+  char name[80];
+  uint32_t n = 0;
+
+  if ((dirIndexPath(name, sizeof(name), path,
+                    strcmp(path, "/") ? strlen(path) : 0) == FR_OK) &&
+      (f_open(idx, name, FA_READ) == FR_OK)) {
+    n = f_size(idx) / sizeof(dirEntryT);
+    f_close(idx);
+  }
+
+  return n;
+}
+
+//
+// Add the recording just closed at wavPath, of size bytes, to the index of
+// its directory
+//
+FRESULT dirIndexAdd(FIL * idx, const char * wavPath, uint32_t size) {
+  const char * base = strrchr(wavPath, '/');
+  char path[80];
+  dirEntryT e;
+  DWORD t = get_fattime();
+  uint8_t i;
+  FRESULT res;
+  UINT bw;
+
+  memset(&e, 0, sizeof(e));
+  e.size = size;
+  e.date = (uint16_t) (t >> 16);
+  e.time = (uint16_t) t;
+  e.attrib = AM_ARC;
+
+  base = base ? base + 1 : wavPath;
+  for (i = 0; base[i] && (i < sizeof(e.name) - 1); i++) {
+    e.name[i] = toupper((uint8_t) base[i]);
+  }
+
+  res = dirIndexPath(path, sizeof(path), wavPath,
+                     (base > wavPath) ? base - wavPath - 1 : 0);
+  if (res != FR_OK) {
+    return res;
+  }
+
+  res = f_open(idx, path, FA_WRITE | FA_OPEN_ALWAYS);
+  if (res != FR_OK) {
+    return res;
+  }
+
+  // After the last whole entry
+  res = f_lseek(idx, f_size(idx) - f_size(idx) % sizeof(e));
+  if (res == FR_OK) {
+    res = f_write(idx, &e, sizeof(e), &bw);
+  }
+
+  f_close(idx);
+
+  return res;
+}
@@ -0,0 +1,56 @@
+/*
+ * dirlist.h
+ * Paged, filtered and sorted directory listings, and the recording index
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef DIRLIST_H_
+#define DIRLIST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/src/ff.h"
+
+// Index of the recordings in a directory, one dirEntryT per recording in the
+// order they were made
+#define DIRIDX_NAME "RECORDS.LST"
+
+// An entry of a listing, and of the index file
+typedef struct {
+  uint32_t size;
+  uint16_t date;     // FAT date and time
+  uint16_t time;
+  char name[13];     // 8.3 name
+  uint8_t attrib;
+  uint8_t reserved[2];
+} dirEntryT;
+
+typedef enum {
+  dirSortNone,       // Directory order, stops reading after the page
+  dirSortName,
+  dirSortDate
+} dirSortT;
+
+typedef struct {
+  const char * match; // Name pattern with * and ?, or 0 for all
+  uint16_t dateLo;    // FAT dates, inclusive
+  uint16_t dateHi;
+  dirSortT sort;
+  uint16_t page;      // Page number from 0
+  uint16_t size;      // Entries per page
+  bool recent;        // Newest first out of the index instead of the directory
+  dirEntryT * arena;  // Room for a page of a sorted listing
+  uint16_t arenaSize; // Entries
+} dirQueryT;
+
+bool dirMatch(const char * pattern, const char * name);
+uint16_t dirDate(const char * arg);
+void dirPrint(const dirEntryT * e);
+FRESULT dirList(DIR * dir, FILINFO * info, const char * path,
+                const dirQueryT * q);
+FRESULT dirRecent(FIL * idx, const char * path, const dirQueryT * q);
+uint32_t dirIndexCount(FIL * idx, const char * path);
+FRESULT dirIndexAdd(FIL * idx, const char * wavPath, uint32_t size);
+
+#endif /* DIRLIST_H_ */
@@ -0,0 +1,249 @@
+/*
+ * eval.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <math.h>
+#include <stdlib.h>
+#include "eval.h"
+#include "decim.h"
+#include "perf.h"
+#include "global.h"
+#include "utils/uartstdio.h"
+
+// CMSIS
+#include "arm_math.h"
+#include "fir_filter.h"
+
+enum {
+  evalMaxKernels = 8,
+  evalSignalSize = 2 * elementSize // The second block is measured
+};
+
+// Test tones, in FFT bins of elementSize samples at ADC_RATE so every tone
+// has a whole number of periods per block. 250 to 2500 Hz...
+static const uint16_t evalPassBins[] = {
+  4, 8, 12, 16, 20, 24, 28, 32, 36, 40
+};
+// ...and 4437 to 15000 Hz at 32ksps
+static const uint16_t evalStopBins[] = {
+  71, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240
+};
+
+#define EVAL_PASS_TONES (sizeof(evalPassBins) / sizeof(uint16_t))
+#define EVAL_STOP_TONES (sizeof(evalStopBins) / sizeof(uint16_t))
+#define EVAL_SIGNALS    (1 + EVAL_PASS_TONES + EVAL_STOP_TONES)
+
+typedef struct {
+  float64_t errSq;   // Error energy against the reference
+  float64_t refSq;   // Reference energy
+  float32_t maxErr;  // Largest error, in ADC counts
+  float32_t passMin; // Gain range over the passband tones, in dB
+  float32_t passMax;
+  float32_t stopMax; // Highest gain over the stopband tones, in dB
+  perfStatT cycles;  // Cycles per block
+} evalResultT;
+
+// One entry per kernel, plus the reference itself
+static evalResultT evalResult[evalMaxKernels + 1];
+
+//
+// Fill x with test signal sig: 0 is testInput scaled to +-EVAL_AMPLITUDE (twice
+// in a row), then the passband and the stopband tones.
+//
+static void evalSignal(uint8_t sig, int16_t * x) {
+  uint16_t t;
+  float32_t lo = testInput[0];
+  float32_t hi = testInput[0];
+  uint16_t bin;
+
+  if (sig == 0) {
+    for (t = 1; t < LENGTH; t++) {
+      lo = (testInput[t] < lo) ? testInput[t] : lo;
+      hi = (testInput[t] > hi) ? testInput[t] : hi;
+    }
+
+    for (t = 0; t < evalSignalSize; t++) {
+      x[t] = (int16_t) lrintf((testInput[t % LENGTH] - (lo + hi) / 2) /
+                              (hi - lo) * 2 * EVAL_AMPLITUDE);
+    }
+    return;
+  }
+
+  sig--;
+  bin = (sig < EVAL_PASS_TONES) ? evalPassBins[sig] :
+                                  evalStopBins[sig - EVAL_PASS_TONES];
+
+  for (t = 0; t < evalSignalSize; t++) {
+    x[t] = (int16_t) lrint(EVAL_AMPLITUDE *
+                           sin(2 * PI * bin * t / elementSize));
+  }
+}
+
+// Double precision filter output for input sample t, zero initial state
+static float64_t evalRef(const int16_t * x, uint16_t t) {
+  float64_t acc = 0;
+  uint16_t k;
+
+  for (k = 0; (k < TAPS) && (k <= t); k++) {
+    acc += (float64_t) firCoeffsf32[k] * x[t - k];
+  }
+
+  return acc;
+}
+
+// Gain of a tone with the given output energy over one block, in dB
+static float32_t evalGain(float64_t energy) {
+  float64_t tone = (float64_t) EVAL_AMPLITUDE * EVAL_AMPLITUDE / 2 *
+                   procOutSize;
+
+  return (float32_t) (10 * log10(energy / tone + 1e-20));
+}
+
+static void evalTone(evalResultT * r, uint8_t sig, float64_t energy) {
+  float32_t gain = evalGain(energy);
+
+  if (sig == 0) {
+    return;
+  }
+
+  if (sig <= EVAL_PASS_TONES) {
+    r->passMin = (gain < r->passMin) ? gain : r->passMin;
+    r->passMax = (gain > r->passMax) ? gain : r->passMax;
+  }
+  else {
+    r->stopMax = (gain > r->stopMax) ? gain : r->stopMax;
+  }
+}
+
+// Print a value with the given number of decimals (up to 3)
+static void evalPrintFixed(float32_t v, uint8_t decimals) {
+  int32_t scale = (decimals == 3) ? 1000 : (decimals == 2) ? 100 : 10;
+  int32_t t = (int32_t) (v * scale + ((v < 0) ? -0.5f : 0.5f));
+  const char * fmt = (decimals == 3) ? "%s%4d.%03d" :
+                     (decimals == 2) ? "%s%4d.%02d" : "%s%4d.%d";
+
+  UARTprintf(fmt, (t < 0) ? "-" : " ", abs(t) / scale, abs(t) % scale);
+}
+
+static float32_t evalSnr(evalResultT * r) {
+  return (r->errSq > 0) ? 10 * log10(r->refSq / r->errSq) : 999;
+}
+
+static bool evalInSpec(evalResultT * r) {
+  return (evalSnr(r) >= EVAL_MIN_SNR_DB) &&
+         (r->passMax - r->passMin <= EVAL_MAX_RIPPLE_DB) &&
+         (-r->stopMax >= EVAL_MIN_ATTEN_DB);
+}
+
+static void evalPrintRow(const char * name, evalResultT * r, bool timed) {
+  uint32_t perOut = perfStatAvg(&r->cycles) / procOutSize;
+
+  UARTprintf("%10s", name);
+  evalPrintFixed(evalSnr(r), 1);
+  evalPrintFixed(r->maxErr, 3);
+  evalPrintFixed(r->passMax - r->passMin, 2);
+  evalPrintFixed(-r->stopMax, 1);
+
+  if (timed) {
+    UARTprintf(" %7u %7u   %s\n", perOut,
+               perOut ? (SYS_CLK / perOut * procDecimation / 1000) : 0,
+               evalInSpec(r) ? "yes" : "no");
+  }
+  else {
+    UARTprintf("\n");
+  }
+}
+
+//
+// Run every decimating kernel over testInput and the test tones, compare with
+// a double precision reference at the input sample each output lines up with,
+// and print SNR, largest error, passband ripple, stopband attenuation and
+// cycles per output sample. "max kHz" is the ADC rate at which the kernel alone
+// would take all of the CPU.
+//
+void evalRun(void) {
+  int16_t * x = (int16_t *) procScratch(0);
+  void * scratch = procScratch(1);
+  float * out = (float *) ((uint8_t *) scratch + decimScratchSize);
+  const decimT * kern;
+  evalResultT * r;
+  evalResultT * ref = &evalResult[decimNumKernels];
+  uint8_t sig, k, b;
+  uint16_t m;
+  uint32_t start;
+  float64_t y, e, energy, refEnergy;
+  int16_t best = -1;
+  uint32_t bestCycles = UINT32_MAX;
+
+  decimInit();
+
+  for (k = 0; k <= decimNumKernels; k++) {
+    r = &evalResult[k];
+    r->errSq = 0;
+    r->refSq = 0;
+    r->maxErr = 0;
+    r->passMin = 1000;
+    r->passMax = -1000;
+    r->stopMax = -1000;
+    perfStatReset(&r->cycles);
+  }
+
+  for (sig = 0; sig < EVAL_SIGNALS; sig++) {
+    evalSignal(sig, x);
+
+    for (k = 0; k < decimNumKernels; k++) {
+      kern = &decimKernels[k];
+      r = &evalResult[k];
+      kern->init();
+
+      for (b = 0; b < evalSignalSize / elementSize; b++) {
+        start = perfNow();
+        kern->run(x + b * elementSize, out, scratch);
+        perfStatAdd(&r->cycles, perfNow() - start);
+
+        energy = 0;
+        refEnergy = 0;
+        for (m = 0; m < procOutSize; m++) {
+          y = evalRef(x, b * elementSize + m * procDecimation +
+                         kern->phase);
+          e = out[m] - y;
+
+          r->errSq += e * e;
+          r->refSq += y * y;
+          r->maxErr = (fabs(e) > r->maxErr) ? fabs(e) : r->maxErr;
+
+          energy += (float64_t) out[m] * out[m];
+          refEnergy += y * y;
+        }
+      }
+
+      // Gains are taken from the last block, after the filter settled
+      evalTone(r, sig, energy);
+      if (k == 0) {
+        evalTone(ref, sig, refEnergy);
+      }
+    }
+  }
+
+  UARTprintf("\n    kernel  SNR dB  max err  ripple   atten cyc/out max kHz  "
+             "spec\n");
+  evalPrintRow("reference", ref, false);
+
+  for (k = 0; k < decimNumKernels; k++) {
+    r = &evalResult[k];
+    evalPrintRow(decimKernels[k].name, r, true);
+
+    if (evalInSpec(r) && (perfStatAvg(&r->cycles) < bestCycles)) {
+      best = k;
+      bestCycles = perfStatAvg(&r->cycles);
+    }
+  }
+
+  if (best >= 0) {
+    UARTprintf("Cheapest kernel within spec: %s\n", decimKernels[best].name);
+  }
+  else {
+    UARTprintf("No kernel within spec\n");
+  }
+}
@@ -0,0 +1,24 @@
+/*
+ * eval.h
+ * Accuracy and speed evaluation of the decimating filter kernels
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef EVAL_H_
+#define EVAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Test tone amplitude, in ADC counts
+#define EVAL_AMPLITUDE      1800
+
+// Filter specification a kernel must meet
+#define EVAL_MIN_SNR_DB     60.0f // Against the double precision reference
+#define EVAL_MAX_RIPPLE_DB  0.5f  // Up to EVAL_PASS_HZ
+#define EVAL_MIN_ATTEN_DB   70.0f // From EVAL_STOP_HZ
+
+void evalRun(void);
+
+#endif /* EVAL_H_ */
@@ -0,0 +1,92 @@
+/*
+ * fir_filter.c
+ * Filter coefficients and test input
+ *
+ *  Created on: 11-05-2014
+ *      Author: boyhuesd
+ */
+#include "fir_filter.h"
+
+FIR_CONST float32_t firCoeffsf32[TAPS] = {
+-0.0000000000f, +0.0000022246f, +0.0000055713f, -0.0000008611f, -0.0000261239f, -0.0000637790f, -0.0000865633f, -0.0000575840f,
++0.0000437232f, +0.0001944839f, +0.0003200066f, +0.0003187768f, +0.0001183833f, -0.0002618587f, -0.0006798773f, -0.0009043528f,
+-0.0007176137f, -0.0000515997f, +0.0009127908f, +0.0017553560f, +0.0019680999f, +0.0012096845f, -0.0004480262f, -0.0024226866f,
+-0.0037742369f, -0.0035994754f, -0.0015247493f, +0.0019408727f, +0.0054195930f, +0.0071385888f, +0.0057371711f, +0.0010746474f,
+-0.0053766490f, -0.0108565642f, -0.0123714069f, -0.0081251014f, +0.0012910428f, +0.0125861336f, +0.0206846840f, +0.0207094898f,
++0.0103447223f, -0.0084120581f, -0.0290038573f, -0.0419579535f, -0.0380499961f, -0.0119262466f, +0.0352027213f, +0.0949631171f,
++0.1537597083f, +0.1967467000f, +0.2125018556f, +0.1967467000f, +0.1537597083f, +0.0949631171f, +0.0352027213f, -0.0119262466f,
+-0.0380499961f, -0.0419579535f, -0.0290038573f, -0.0084120581f, +0.0103447223f, +0.0207094898f, +0.0206846840f, +0.0125861336f,
++0.0012910428f, -0.0081251014f, -0.0123714069f, -0.0108565642f, -0.0053766490f, +0.0010746474f, +0.0057371711f, +0.0071385888f,
++0.0054195930f, +0.0019408727f, -0.0015247493f, -0.0035994754f, -0.0037742369f, -0.0024226866f, -0.0004480262f, +0.0012096845f,
++0.0019680999f, +0.0017553560f, +0.0009127908f, -0.0000515997f, -0.0007176137f, -0.0009043528f, -0.0006798773f, -0.0002618587f,
++0.0001183833f, +0.0003187768f, +0.0003200066f, +0.0001944839f, +0.0000437232f, -0.0000575840f, -0.0000865633f, -0.0000637790f,
+-0.0000261239f, -0.0000008611f, +0.0000055713f, +0.0000022246f, -0.0000000000f,
+};
+
+const float32_t testInput[LENGTH] =
+{
++1.1016856341f, +1.1030303810f, +1.1043734696f, +1.1057148842f, +1.1070546090f, +1.1083926284f, +1.1097289269f, +1.1110634889f,
++1.1123962987f, +1.1137273410f, +1.1150566003f, +1.1163840611f, +1.1177097081f, +1.1190335258f, +1.1203554990f, +1.1216756125f,
++1.1229938508f, +1.1243101989f, +1.1256246416f, +1.1269371637f, +1.1282477501f, +1.1295563858f, +1.1308630557f, +1.1321677449f,
++1.1334704384f, +1.1347711213f, +1.1360697788f, +1.1373663959f, +1.1386609580f, +1.1399534502f, +1.1412438579f, +1.1425321664f,
++1.1438183610f, +1.1451024272f, +1.1463843503f, +1.1476641160f, +1.1489417097f, +1.1502171169f, +1.1514903234f, +1.1527613148f,
++1.1540300766f, +1.1552965948f, +1.1565608551f, +1.1578228432f, +1.1590825451f, +1.1603399466f, +1.1615950338f, +1.1628477925f,
++1.1640982089f, +1.1653462690f, +1.1665919590f, +1.1678352649f, +1.1690761731f, +1.1703146697f, +1.1715507411f, +1.1727843736f,
++1.1740155536f, +1.1752442675f, +1.1764705019f, +1.1776942431f, +1.1789154779f, +1.1801341928f, +1.1813503744f, +1.1825640095f,
++1.1837750849f, +1.1849835873f, +1.1861895036f, +1.1873928206f, +1.1885935254f, +1.1897916049f, +1.1909870460f, +1.1921798360f,
++1.1933699620f, +1.1945574110f, +1.1957421704f, +1.1969242274f, +1.1981035694f, +1.1992801836f, +1.2004540576f, +1.2016251788f,
++1.2027935347f, +1.2039591128f, +1.2051219008f, +1.2062818864f, +1.2074390573f, +1.2085934011f, +1.2097449059f, +1.2108935593f,
++1.2120393493f, +1.2131822640f, +1.2143222912f, +1.2154594191f, +1.2165936358f, +1.2177249294f, +1.2188532882f, +1.2199787004f,
++1.2211011544f, +1.2222206386f, +1.2233371413f, +1.2244506510f, +1.2255611563f, +1.2266686458f, +1.2277731080f, +1.2288745317f,
++1.2299729057f, +1.2310682186f, +1.2321604594f, +1.2332496169f, +1.2343356801f, +1.2354186380f, +1.2364984797f, +1.2375751943f,
++1.2386487709f, +1.2397191988f, +1.2407864672f, +1.2418505655f, +1.2429114830f, +1.2439692092f, +1.2450237336f, +1.2460750457f,
++1.2471231351f, +1.2481679916f, +1.2492096047f, +1.2502479642f, +1.2512830601f, +1.2523148821f, +1.2533434202f, +1.2543686644f,
++1.2553906048f, +1.2564092313f, +1.2574245342f, +1.2584365038f, +1.2594451302f, +1.2604504038f, +1.2614523149f, +1.2624508541f,
++1.2634460118f, +1.2644377786f, +1.2654261450f, +1.2664111018f, +1.2673926396f, +1.2683707492f, +1.2693454216f, +1.2703166475f,
++1.2712844180f, +1.2722487240f, +1.2732095566f, +1.2741669069f, +1.2751207661f, +1.2760711256f, +1.2770179764f, +1.2779613101f,
++1.2789011181f, +1.2798373918f, +1.2807701227f, +1.2816993024f, +1.2826249227f, +1.2835469751f, +1.2844654515f, +1.2853803438f,
++1.2862916437f, +1.2871993432f, +1.2881034344f, +1.2890039093f, +1.2899007601f, +1.2907939788f, +1.2916835578f, +1.2925694894f,
++1.2934517659f, +1.2943303797f, +1.2952053234f, +1.2960765894f, +1.2969441705f, +1.2978080591f, +1.2986682481f, +1.2995247303f,
++1.3003774984f, +1.3012265454f, +1.3020718643f, +1.3029134480f, +1.3037512897f, +1.3045853825f, +1.3054157197f, +1.3062422943f,
++1.3070650999f, +1.3078841298f, +1.3086993774f, +1.3095108363f, +1.3103185000f, +1.3111223621f, +1.3119224163f, +1.3127186565f,
++1.3135110764f, +1.3142996698f, +1.3150844308f, +1.3158653533f, +1.3166424314f, +1.3174156592f, +1.3181850308f, +1.3189505406f,
++1.3197121828f, +1.3204699519f, +1.3212238421f, +1.3219738481f, +1.3227199644f, +1.3234621855f, +1.3242005062f, +1.3249349212f,
++1.3256654253f, +1.3263920133f, +1.3271146803f, +1.3278334211f, +1.3285482308f, +1.3292591045f, +1.3299660374f, +1.3306690248f,
++1.3313680618f, +1.3320631439f, +1.3327542666f, +1.3334414252f, +1.3341246153f, +1.3348038325f, +1.3354790725f, +1.3361503310f,
++1.3368176038f, +1.3374808868f, +1.3381401759f, +1.3387954670f, +1.3394467562f, +1.3400940395f, +1.3407373133f, +1.3413765736f,
++1.3420118168f, +1.3426430392f, +1.3432702372f, +1.3438934073f, +1.3445125461f, +1.3451276501f, +1.3457387160f, +1.3463457406f,
++1.3469487205f, +1.3475476527f, +1.3481425341f, +1.3487333616f, +1.3493201323f, +1.3499028433f, +1.3504814917f, +1.3510560748f,
++1.3516265898f, +1.3521930340f, +1.3527554050f, +1.3533137001f, +1.3538679169f, +1.3544180530f, +1.3549641060f, +1.3555060737f,
++1.3560439538f, +1.3565777442f, +1.3571074427f, +1.3576330474f, +1.3581545563f, +1.3586719674f, +1.3591852789f, +1.3596944890f,
++1.3601995961f, +1.3607005984f, +1.3611974942f, +1.3616902822f, +1.3621789608f, +1.3626635286f, +1.3631439842f, +1.3636203263f,
++1.3640925538f, +1.3645606654f, +1.3650246600f, +1.3654845366f, +1.3659402941f, +1.3663919317f, +1.3668394486f, +1.3672828438f,
++1.3677221166f, +1.3681572665f, +1.3685882926f, +1.3690151946f, +1.3694379718f, +1.3698566239f, +1.3702711505f, +1.3706815512f,
++1.3710878258f, +1.3714899741f, +1.3718879960f, +1.3722818914f, +1.3726716602f, +1.3730573026f, +1.3734388186f, +1.3738162085f,
++1.3741894723f, +1.3745586105f, +1.3749236233f, +1.3752845113f, +1.3756412747f, +1.3759939143f, +1.3763424304f, +1.3766868239f,
++1.3770270955f, +1.3773632457f, +1.3776952756f, +1.3780231860f, +1.3783469778f, +1.3786666521f, +1.3789822099f, +1.3792936523f,
++1.3796009805f, +1.3799041957f, +1.3802032993f, +1.3804982926f, +1.3807891771f, +1.3810759541f, +1.3813586253f, +1.3816371922f,
++1.3819116565f, +1.3821820199f, +1.3824482841f, +1.3827104510f, +1.3829685225f, +1.3832225005f, +1.3834723870f, +1.3837181841f,
++1.3839598938f, +1.3841975184f, +1.3844310601f, +1.3846605211f, +1.3848859039f, +1.3851072108f, +1.3853244443f, +1.3855376069f,
++1.3857467011f, +1.3859517296f, +1.3861526951f, +1.3863496004f, +1.3865424481f, +1.3867312413f, +1.3869159827f, +1.3870966754f,
++1.3872733224f, +1.3874459267f, +1.3876144915f, +1.3877790201f, +1.3879395155f, +1.3880959812f, +1.3882484205f, +1.3883968368f,
++1.3885412336f, +1.3886816144f, +1.3888179827f, +1.3889503423f, +1.3890786967f, +1.3892030498f, +1.3893234053f, +1.3894397671f,
++1.3895521391f, +1.3896605253f, +1.3897649295f, +1.3898653561f, +1.3899618089f, +1.3900542923f, +1.3901428104f, +1.3902273675f,
++1.3903079680f, +1.3903846162f, +1.3904573166f, +1.3905260736f, +1.3905908919f, +1.3906517760f, +1.3907087305f, +1.3907617602f,
++1.3908108697f, +1.3908560640f, +1.3908973479f, +1.3909347262f, +1.3909682039f, +1.3909977861f, +1.3910234778f, +1.3910452841f,
++1.3910632102f, +1.3910772613f, +1.3910874427f, +1.3910937596f, +1.3910962174f, +1.3910948216f, +1.3910895776f, +1.3910804910f,
++1.3910675672f, +1.3910508120f, +1.3910302309f, +1.3910058297f, +1.3909776142f, +1.3909455901f, +1.3909097634f, +1.3908701399f,
++1.3908267256f, +1.3907795265f, +1.3907285486f, +1.3906737980f, +1.3906152810f, +1.3905530037f, +1.3904869723f, +1.3904171931f,
++1.3903436725f, +1.3902664168f, +1.3901854326f, +1.3901007262f, +1.3900123042f, +1.3899201732f, +1.3898243397f, +1.3897248105f,
++1.3896215923f, +1.3895146918f, +1.3894041158f, +1.3892898712f, +1.3891719648f, +1.3890504036f, +1.3889251946f, +1.3887963449f,
++1.3886638613f, +1.3885277512f, +1.3883880217f, +1.3882446799f, +1.3880977331f, +1.3879471886f, +1.3877930537f, +1.3876353358f,
++1.3874740424f, +1.3873091809f, +1.3871407587f, +1.3869687835f, +1.3867932629f, +1.3866142044f, +1.3864316158f, +1.3862455048f,
++1.3860558791f, +1.3858627465f, +1.3856661149f, +1.3854659922f, +1.3852623863f, +1.3850553051f, +1.3848447566f, +1.3846307490f,
++1.3844132902f, +1.3841923885f, +1.3839680519f, +1.3837402887f, +1.3835091072f, +1.3832745156f, +1.3830365222f, +1.3827951354f,
++1.3825503636f, +1.3823022153f, +1.3820506988f, +1.3817958228f, +1.3815375959f, +1.3812760264f, +1.3810111232f, +1.3807428949f,
++1.3804713502f, +1.3801964978f, +1.3799183465f, +1.3796369051f, +1.3793521824f, +1.3790641874f, +1.3787729290f, +1.3784784161f,
++1.3781806578f, +1.3778796630f, +1.3775754408f, +1.3772680003f, +1.3769573507f, +1.3766435011f, +1.3763264607f, +1.3760062387f,
++1.3756828445f, +1.3753562874f, +1.3750265766f, +1.3746937215f, +1.3743577316f, +1.3740186163f, +1.3736763851f, +1.3733310474f,
++1.3729826128f, +1.3726310908f, +1.3722764912f, +1.3719188234f, +1.3715580971f, +1.3711943222f, +1.3708275081f, +1.3704576649f,
++1.3700848021f, +1.3697089297f, +1.3693300574f, +1.3689481952f, +1.3685633530f, +1.3681755406f, +1.3677847682f, +1.3673910456f,
++1.3669943829f, +1.3665947901f, +1.3661922773f, +1.3657868547f, +1.3653785323f, +1.3649673204f, +1.3645532291f, +1.3641362687f,
+};
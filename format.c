@@ -0,0 +1,92 @@
+/*
+ * format.c
+ *
+ *  Created on: 25-04-2014
+ *      Author: boyhuesd
+ */
+#include <string.h>
+#include "format.h"
+
+const uint8_t wavHeader[WAV_FMT_SIZE] = {
+    0x52, 0x49, 0x46, 0x46, // RIFF
+    0x00, 0x00, 0x00, 0x00, // Chunk Size
+    0x57, 0x41, 0x56, 0x45, // WAVE
+    0x66, 0x6d, 0x74, 0x20, // fmt
+    0x10, 0x00, 0x00, 0x00, // Subchunk 1 size
+    0x01, 0x00, // PCM format
+    0x01, 0x00, // Single channel
+    0x40, 0x1f, 0x00, 0x00, // Sample rate = 8ksps
+    0x80, 0x3e, 0x00, 0x00, // Byte rate = no. of channels * samplerate * bit/sample/8
+    0x02, 0x00, // Block align = no. of chan * bit/sam/8
+    0x10, 0x00, // Bits per sample
+};
+
+static void wavPut32(uint8_t * p, uint32_t v) {
+  p[0] = (uint8_t) v;
+  p[1] = (uint8_t) (v >> 8);
+  p[2] = (uint8_t) (v >> 16);
+  p[3] = (uint8_t) (v >> 24);
+}
+
+static uint32_t wavGet32(const uint8_t * p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+         ((uint32_t) p[3] << 24);
+}
+
+//
+// Fill the WAV_HEADER_SIZE bytes of header for dataSize bytes of sample data:
+// RIFF and fmt chunks, a JUNK chunk of zeros and the data chunk header
+//
+void wavHeaderFill(uint8_t * header, uint32_t dataSize) {
+  uint8_t * junk = header + WAV_FMT_SIZE;
+  uint8_t * data = header + WAV_HEADER_SIZE - 8;
+
+  memcpy(header, wavHeader, WAV_FMT_SIZE);
+  wavPut32(header + 4, dataSize + WAV_HEADER_SIZE - 8);
+
+  memcpy(junk, "JUNK", 4);
+  wavPut32(junk + 4, data - junk - 8);
+  memset(junk + 8, 0, data - junk - 8);
+
+  memcpy(data, "data", 4);
+  wavPut32(data + 4, dataSize);
+}
+
+//
+// Set the RIFF and data chunk sizes of a header read back from a file, with
+// the data at dataOffset as wavDataOffset() found it
+//
+void wavHeaderPatch(uint8_t * header, uint32_t dataOffset, uint32_t dataSize) {
+  wavPut32(header + 4, dataOffset + dataSize - 8);
+  wavPut32(header + dataOffset - 4, dataSize);
+}
+
+//
+// Offset of the sample data in a WAV file starting with the n bytes of header,
+// with its size in dataSize. Returns 0 if there is no data chunk in them, as
+// in a file that is not WAV. Files with the plain 44 byte header work too.
+//
+uint32_t wavDataOffset(const uint8_t * header, uint32_t n, uint32_t * dataSize) {
+  uint32_t pos = 12;
+  uint32_t size;
+
+  if ((n < 12) || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) {
+    return 0;
+  }
+
+  while (pos + 8 <= n) {
+    size = wavGet32(header + pos + 4);
+
+    if (!memcmp(header + pos, "data", 4)) {
+      *dataSize = size;
+      return pos + 8;
+    }
+    if (size > n) {
+      return 0;
+    }
+
+    pos += 8 + size + (size & 1);
+  }
+
+  return 0;
+}
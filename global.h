@@ -11,5 +11,13 @@
 #include "stdint.h"
 
 #define SYS_CLK 80000000UL
+#define ADC_RATE 32000UL // ADC sample rate
+
+// Define RAM_CODE, for the compiler and the linker (--define=RAM_CODE), to run
+// the ISRs, the ring operations and the filter kernel from SRAM. They are
+// placed in .ramfunc, which the boot code copies from flash with the BINIT
+// table of sd_card_ccs.cmd. SRAM has no wait states at 80MHz, but its code is
+// fetched over the system bus, where it competes with the data and the uDMA,
+// so compare the bench figures of both builds before keeping it.
 
 #endif /* GLOBAL_H_ */
@@ -0,0 +1,98 @@
+/*
+ * irq.c
+ *
+ * With all interrupts at the same priority, a DAC update due while the
+ * capture ISR or the FatFs tick runs waits for it to finish, and the output
+ * sample comes late. irqInit() sets the plan of irq.h up. The ring is shared
+ * across priorities, so cirbuf.c masks interrupts around its count updates,
+ * a few cycles each.
+ *
+ * With irqMeasure set the DAC and capture handlers stamp themselves. The
+ * latency is read off the timer that raised the event, which counts down
+ * from its load, and the jitter is the difference between two stamps less
+ * the period. "jitter on" starts it before e.g. cat or nano, "jitter" prints
+ * the histograms.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "irq.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "utils/uartstdio.h"
+
+volatile bool irqMeasure = false;
+
+irqTimingT irqDac;
+irqTimingT irqCapture;
+
+//
+// Set the priority of every interrupt in use. Called once, before any of them
+// is enabled.
+//
+void irqInit(void) {
+  IntPrioritySet(INT_TIMER1A, IRQ_PRIO_DAC);
+  IntPrioritySet(INT_ADC0SS3, IRQ_PRIO_CAPTURE);
+  IntPrioritySet(INT_TIMER3A, IRQ_PRIO_CAPTURE);
+  IntPrioritySet(INT_TIMER2A, IRQ_PRIO_CAPTURE);
+  IntPrioritySet(INT_UDMAERR, IRQ_PRIO_DMA);
+  IntPrioritySet(INT_SSI0, IRQ_PRIO_DMA);
+  IntPrioritySet(FAULT_SYSTICK, IRQ_PRIO_TICK);
+}
+
+// Clear the histograms with irqMeasure off, the next stamps start over
+void irqClear(void) {
+  memset(&irqDac, 0, sizeof(irqDac));
+  memset(&irqCapture, 0, sizeof(irqCapture));
+}
+
+static void irqHistAdd(irqHistT * h, uint32_t cycles) {
+  uint32_t b = cycles / irqBinCycles;
+
+  h->bin[(b < irqBins) ? b : irqBins]++;
+  h->count++;
+  if (cycles > h->max) {
+    h->max = cycles;
+  }
+}
+
+//
+// Stamp a handler at now, elapsed cycles after its timer event. period is the
+// nominal time between two handlers.
+//
+void irqStamp(irqTimingT * t, uint32_t now, uint32_t elapsed,
+              uint32_t period) {
+  int32_t off;
+
+  irqHistAdd(&t->latency, elapsed);
+
+  if (t->last) {
+    off = (int32_t) (now - t->last - period);
+    irqHistAdd(&t->jitter, (off < 0) ? -off : off);
+  }
+
+  t->last = now;
+}
+
+static void irqHistPrint(const char * name, const irqHistT * h) {
+  uint8_t b;
+
+  UARTprintf("\"%s\":{\"count\":%u,\"max\":%u,\"bins\":[", name, h->count,
+             h->max);
+  for (b = 0; b <= irqBins; b++) {
+    UARTprintf("%s%u", b ? "," : "", h->bin[b]);
+  }
+  UARTprintf("]}");
+}
+
+//
+// Print the histograms of a handler as JSON, in bins of irqBinCycles with the
+// last one for everything above
+//
+void irqPrint(const char * name, const irqTimingT * t) {
+  UARTprintf("{\"isr\":\"%s\",\"bin\":%u,", name, irqBinCycles);
+  irqHistPrint("latency", &t->latency);
+  UARTprintf(",");
+  irqHistPrint("jitter", &t->jitter);
+  UARTprintf("}\n");
+}
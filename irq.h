@@ -0,0 +1,56 @@
+/*
+ * irq.h
+ * Interrupt priorities, and latency and jitter histograms of the sample ISRs
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef IRQ_H_
+#define IRQ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// NVIC priorities, the top 3 bits count and lower values preempt higher ones.
+// The DAC update is the only thing that has to happen at an exact time. The
+// capture ISR has an element of time to claim the next one, the card driver
+// only sets a flag, and the FatFs tick can wait a few ms.
+#define IRQ_PRIO_DAC     0x00 // Timer1A
+#define IRQ_PRIO_CAPTURE 0x20 // ADC0SS3, Timer3A burst, Timer2A task lists
+#define IRQ_PRIO_DMA     0x40 // uDMA error, SSI0 transfer done
+#define IRQ_PRIO_TICK    0x60 // SysTick
+
+enum {
+  irqBins = 32,       // Histogram bins, plus one for everything above
+  irqBinCycles = 40   // 0.5us per bin
+};
+
+typedef struct {
+  uint32_t bin[irqBins + 1];
+  uint32_t count;
+  uint32_t max;
+} irqHistT;
+
+//
+// Timing of one ISR: latency from the timer event to the handler, and how far
+// the time between two handlers is off the period
+//
+typedef struct {
+  uint32_t last; // Stamp of the previous handler, 0 before the first
+  irqHistT latency;
+  irqHistT jitter;
+} irqTimingT;
+
+// Set to stamp the DAC and capture handlers
+extern volatile bool irqMeasure;
+
+extern irqTimingT irqDac;
+extern irqTimingT irqCapture;
+
+void irqInit(void);
+void irqClear(void);
+void irqStamp(irqTimingT * t, uint32_t now, uint32_t elapsed,
+              uint32_t period);
+void irqPrint(const char * name, const irqTimingT * t);
+
+#endif /* IRQ_H_ */
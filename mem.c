@@ -0,0 +1,107 @@
+/*
+ * mem.c
+ *
+ * main paints the stack below its own frame with MEM_PAINT first thing, and
+ * the deepest word overwritten since marks how much of it was ever used,
+ * interrupts included as they run on the same stack. The section bounds come
+ * from the RUN_START and RUN_SIZE symbols sd_card_ccs.cmd defines; the linker
+ * map has the full listing, see tools/mapsize.c.
+ *
+ *  Created on: 19-10-2026
+ */
+#include "mem.h"
+#include "utils/uartstdio.h"
+
+// Defined in sd_card_ccs.cmd, only their addresses count
+extern uint32_t memDataStart, memDataSize;
+extern uint32_t memBssStart, memBssSize;
+extern uint32_t memHeapStart, memHeapSize;
+extern uint32_t memStackStart, memStackSize;
+#ifdef RAM_CODE
+extern uint32_t memCodeStart, memCodeSize;
+#endif
+
+#define MEM_SYM(s) ((uint32_t) &(s))
+
+//
+// Paint the stack from its bottom up to memPaintMargin bytes below the frame
+// of the caller. Called first thing in main, with little of it in use.
+//
+void memPaint(void) {
+  volatile uint32_t here;
+  uint32_t * p = (uint32_t *) MEM_SYM(memStackStart);
+  uint32_t * end = (uint32_t *) (((uint32_t) &here - memPaintMargin) & ~3u);
+
+  while (p < end) {
+    *p++ = MEM_PAINT;
+  }
+}
+
+//
+// Deepest the stack has gone since memPaint(), in bytes from its top
+//
+uint32_t memStackUsed(void) {
+  const uint32_t * p = (const uint32_t *) MEM_SYM(memStackStart);
+  const uint32_t * top = (const uint32_t *) (MEM_SYM(memStackStart) +
+                                             MEM_SYM(memStackSize));
+
+  while ((p < top) && (*p == MEM_PAINT)) {
+    p++;
+  }
+
+  return (uint32_t) top - (uint32_t) p;
+}
+
+static uint32_t memEnd(uint32_t start, uint32_t size, uint32_t end) {
+  return (start + size > end) ? start + size : end;
+}
+
+//
+// Sizes of the RAM sections, and the SRAM left after the last one
+//
+void memSections(memSectionsT * s) {
+  uint32_t end = MEM_SRAM_BASE;
+
+  s->data = MEM_SYM(memDataSize);
+  s->bss = MEM_SYM(memBssSize);
+  s->heap = MEM_SYM(memHeapSize);
+  s->stack = MEM_SYM(memStackSize);
+
+  end = memEnd(MEM_SYM(memDataStart), s->data, end);
+  end = memEnd(MEM_SYM(memBssStart), s->bss, end);
+  end = memEnd(MEM_SYM(memHeapStart), s->heap, end);
+  end = memEnd(MEM_SYM(memStackStart), s->stack, end);
+
+#ifdef RAM_CODE
+  s->code = MEM_SYM(memCodeSize);
+  end = memEnd(MEM_SYM(memCodeStart), s->code, end);
+#else
+  s->code = 0;
+#endif
+
+  s->free = MEM_SRAM_BASE + MEM_SRAM_SIZE - end;
+}
+
+//
+// Print the RAM budget as JSON: sections, stack use, the given objects and
+// how many more ring elements of elementBytes the free SRAM would hold
+//
+void memPrint(const memObjT * objects, uint8_t n, uint32_t elementBytes) {
+  memSectionsT s;
+  uint32_t used = memStackUsed();
+  uint8_t i;
+
+  memSections(&s);
+
+  UARTprintf("{\"sram\":%u,\"data\":%u,\"bss\":%u,\"heap\":%u,\"code\":%u,"
+             "\"free\":%u,\n", MEM_SRAM_SIZE, s.data, s.bss, s.heap, s.code,
+             s.free);
+  UARTprintf("\"stack\":{\"size\":%u,\"used\":%u,\"free\":%u},\n", s.stack,
+             used, s.stack - used);
+  UARTprintf("\"objects\":[");
+  for (i = 0; i < n; i++) {
+    UARTprintf("%s\n{\"name\":\"%s\",\"bytes\":%u}", i ? "," : "",
+               objects[i].name, objects[i].bytes);
+  }
+  UARTprintf("\n],\"more_elements\":%u}\n", s.free / elementBytes);
+}
@@ -0,0 +1,44 @@
+/*
+ * mem.h
+ * RAM budget: stack high-watermark and section sizes from the linker
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef MEM_H_
+#define MEM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MEM_SRAM_BASE 0x20000000
+#define MEM_SRAM_SIZE 0x8000
+
+// Word the unused stack is painted with
+#define MEM_PAINT 0xA5A5A5A5
+
+enum {
+  memPaintMargin = 64 // Bytes left alone below the stack pointer of memPaint()
+};
+
+// A statically allocated object, for the per-object listing
+typedef struct {
+  const char * name;
+  uint32_t bytes;
+} memObjT;
+
+typedef struct {
+  uint32_t data;  // Initialized data
+  uint32_t bss;   // Zeroed data
+  uint32_t heap;  // .sysmem, --heap_size
+  uint32_t stack; // .stack, --stack_size
+  uint32_t code;  // .ramfunc, with RAM_CODE
+  uint32_t free;  // SRAM past the last of them
+} memSectionsT;
+
+void memPaint(void);
+uint32_t memStackUsed(void);
+void memSections(memSectionsT * s);
+void memPrint(const memObjT * objects, uint8_t n, uint32_t elementBytes);
+
+#endif /* MEM_H_ */
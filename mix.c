@@ -0,0 +1,267 @@
+/*
+ * mix.c
+ *
+ * Each stream has a ring of mixDepth blocks in an arena the caller gives,
+ * which the reader fills from its file and mixRun() empties into the DAC
+ * ring. A stream is started by setting it on, and played again by flushing
+ * its ring and filling it anew, so the file stays open all along.
+ *
+ * mixKernel() sums all streams in one pass over the output. The products
+ * of the Q14 gains go into a 32-bit accumulator with saturating adds, two
+ * streams per SMUAD on the Cortex-M4, and the sum saturates once per sample
+ * to the mixOutBits the PWM of dacIntHandler() takes, so loud streams clip
+ * instead of wrapping around. The plain C loop adds the streams in the same
+ * pairs, so both versions give bit-identical results.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "mix.h"
+
+#if defined(ARM_MATH_CM4)
+#include "arm_math.h"
+#endif
+
+#ifdef RAM_CODE
+#pragma CODE_SECTION(mixKernel, ".ramfunc")
+#endif
+
+// Saturating 32-bit add, as QADD
+static int32_t mixQadd(int32_t a, int32_t b) {
+  int64_t sum = (int64_t) a + b;
+
+  if (sum > INT32_MAX) {
+    return INT32_MAX;
+  }
+  if (sum < INT32_MIN) {
+    return INT32_MIN;
+  }
+
+  return (int32_t) sum;
+}
+
+// Saturate to mixOutBits, as SSAT
+static int16_t mixSat(int32_t x) {
+  if (x > mixOutMax) {
+    return mixOutMax;
+  }
+  if (x < mixOutMin) {
+    return mixOutMin;
+  }
+
+  return (int16_t) x;
+}
+
+//
+// Sum n samples of streams inputs, each times its gain, into out. Gains are
+// Q14 from 0 to INT16_MAX, so the products of a pair of streams fit 32 bits.
+// The inputs and out are word aligned.
+//
+void mixKernel(const int16_t * const * in, const int16_t * gain,
+               uint8_t streams, int16_t * out, uint16_t n) {
+  uint16_t i = 0;
+  uint8_t s;
+  int32_t acc;
+
+#if defined(ARM_MATH_CM4)
+  uint32_t pair[(mixKernelMax + 1) / 2];
+  uint32_t a, b;
+  int32_t lo, hi;
+
+  // Gains of each pair of streams in the halves of a word
+  for (s = 0; s < streams; s += 2) {
+    pair[s / 2] = (uint16_t) gain[s];
+    if (s + 1 < streams) {
+      pair[s / 2] |= (uint32_t) gain[s + 1] << 16;
+    }
+  }
+
+  for (; i + 2 <= n; i += 2) {
+    lo = 0;
+    hi = 0;
+
+    for (s = 0; s + 2 <= streams; s += 2) {
+      a = *(const uint32_t *) &in[s][i];
+      b = *(const uint32_t *) &in[s + 1][i];
+      lo = __QADD(lo, __SMUAD(__PKHBT(a, b, 16), pair[s / 2]));
+      hi = __QADD(hi, __SMUAD(__PKHTB(b, a, 16), pair[s / 2]));
+    }
+    if (s < streams) {
+      a = *(const uint32_t *) &in[s][i];
+      lo = __QADD(lo, __SMUAD(a, pair[s / 2]));
+      hi = __QADD(hi, __SMUAD(a, pair[s / 2] << 16));
+    }
+
+    *(uint32_t *) &out[i] = __PKHBT(__SSAT(lo >> mixGainBits, mixOutBits),
+                                    __SSAT(hi >> mixGainBits, mixOutBits), 16);
+  }
+#endif
+
+  for (; i < n; i++) {
+    acc = 0;
+
+    for (s = 0; s + 2 <= streams; s += 2) {
+      acc = mixQadd(acc, in[s][i] * gain[s] + in[s + 1][i] * gain[s + 1]);
+    }
+    if (s < streams) {
+      acc = mixQadd(acc, in[s][i] * gain[s]);
+    }
+
+    out[i] = mixSat(acc >> mixGainBits);
+  }
+}
+
+//
+// Set all streams off with empty rings in arena, mixArenaSamples word aligned
+//
+void mixInit(mixT * m, int16_t * arena) {
+  uint8_t s;
+
+  memset(m, 0, sizeof(*m));
+
+  for (s = 0; s < mixMaxStreams; s++) {
+    m->stream[s].block = arena + s * mixDepth * mixBlock;
+    m->stream[s].gain = mixUnity;
+  }
+}
+
+//
+// Block of stream s to fill with mixBlock samples, 0 if its ring is full
+//
+int16_t * mixFree(mixT * m, uint8_t s) {
+  mixStreamT * st = &m->stream[s];
+
+  if (st->count == mixDepth) {
+    return 0;
+  }
+
+  return st->block + st->head * mixBlock;
+}
+
+//
+// Pass the block of mixFree() with n samples in it to the mixer. A short block
+// is padded with silence and ends the stream.
+//
+void mixPut(mixT * m, uint8_t s, uint16_t n) {
+  mixStreamT * st = &m->stream[s];
+
+  if (n) {
+    memset(st->block + st->head * mixBlock + n, 0,
+           (mixBlock - n) * sizeof(int16_t));
+    st->head = (st->head + 1) % mixDepth;
+    st->count++;
+  }
+
+  if (n < mixBlock) {
+    st->ended = true;
+  }
+}
+
+//
+// Mix stream s from its next block on with a Q14 gain
+//
+void mixStart(mixT * m, uint8_t s, int16_t gain) {
+  m->stream[s].gain = (gain < 0) ? 0 : gain;
+  m->stream[s].on = true;
+}
+
+//
+// Set stream s off and empty its ring, to fill it again from the start
+//
+void mixFlush(mixT * m, uint8_t s) {
+  mixStreamT * st = &m->stream[s];
+
+  st->on = false;
+  st->ended = false;
+  st->head = 0;
+  st->tail = 0;
+  st->count = 0;
+  st->pos = 0;
+}
+
+bool mixActive(const mixT * m) {
+  uint8_t s;
+
+  for (s = 0; s < mixMaxStreams; s++) {
+    if (m->stream[s].on) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//
+// Mix n output samples, n even, from the streams that are on. A stream with
+// no block ready adds silence and counts as starved; one that has ended goes
+// off once its ring is empty. Returns the streams mixed.
+//
+uint8_t mixRun(mixT * m, int16_t * out, uint16_t n) {
+  const int16_t * in[mixMaxStreams];
+  int16_t gain[mixMaxStreams];
+  uint8_t used[mixMaxStreams];
+  mixStreamT * st;
+  uint16_t done = 0;
+  uint16_t len;
+  uint8_t s, k;
+  uint8_t mixed = 0;
+
+  while (done < n) {
+    len = n - done;
+    k = 0;
+
+    for (s = 0; s < mixMaxStreams; s++) {
+      st = &m->stream[s];
+
+      if (st->on && !st->count && st->ended) {
+        st->on = false;
+      }
+      if (!st->on || !st->count) {
+        continue;
+      }
+
+      // Up to the end of the shortest block left
+      if (mixBlock - st->pos < len) {
+        len = mixBlock - st->pos;
+      }
+
+      in[k] = st->block + st->tail * mixBlock + st->pos;
+      gain[k] = st->gain;
+      used[k++] = s;
+    }
+
+    for (s = 0; s < mixMaxStreams; s++) {
+      st = &m->stream[s];
+      if (st->on && !st->count) {
+        st->starved += len;
+      }
+    }
+
+    if (k) {
+      mixKernel(in, gain, k, out + done, len);
+    }
+    else {
+      memset(out + done, 0, len * sizeof(int16_t));
+    }
+
+    for (s = 0; s < k; s++) {
+      st = &m->stream[used[s]];
+
+      st->pos += len;
+      if (st->pos == mixBlock) {
+        st->pos = 0;
+        st->tail = (st->tail + 1) % mixDepth;
+        st->count--;
+      }
+    }
+
+    if (k > mixed) {
+      mixed = k;
+    }
+    done += len;
+  }
+
+  m->samples += n;
+
+  return mixed;
+}
@@ -0,0 +1,58 @@
+/*
+ * mix.h
+ * Playback mixer: several streams, each with its own ring and gain, summed
+ * into the samples of the DAC
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef MIX_H_
+#define MIX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum {
+  mixMaxStreams = 3,  // Background and two overlays
+  mixBlock = 128,     // Samples per ring block, 16ms at DAC_RATE
+  mixDepth = 2,       // Blocks per stream ring
+  mixGainBits = 14,   // Gains are Q14, up to twice the input
+  mixUnity = 1 << mixGainBits,
+  mixOutBits = 12,    // Output range of the DAC, centered ADC counts
+  mixOutMax = (1 << (mixOutBits - 1)) - 1,
+  mixOutMin = -(1 << (mixOutBits - 1)),
+  mixArenaSamples = mixMaxStreams * mixDepth * mixBlock,
+  mixAhead = 3,       // DAC ring elements mixed ahead, the delay of a start
+  mixKernelMax = 8    // Streams mixKernel() takes
+};
+
+// One stream: a ring of mixDepth blocks, filled by the reader and mixed in
+// order. Both ends run in the main loop.
+typedef struct {
+  int16_t * block; // mixDepth blocks of mixBlock samples
+  uint8_t head;    // Next block to fill
+  uint8_t tail;    // Next block to mix
+  uint8_t count;   // Blocks filled and not mixed
+  uint16_t pos;    // Samples of the tail block mixed
+  int16_t gain;    // Q14
+  bool on;         // Mixed into the output
+  bool ended;      // No more blocks will come
+  uint32_t starved; // Output samples it had no block for
+} mixStreamT;
+
+typedef struct {
+  mixStreamT stream[mixMaxStreams];
+  uint32_t samples; // Output samples mixed
+} mixT;
+
+void mixInit(mixT * m, int16_t * arena);
+int16_t * mixFree(mixT * m, uint8_t s);
+void mixPut(mixT * m, uint8_t s, uint16_t n);
+void mixStart(mixT * m, uint8_t s, int16_t gain);
+void mixFlush(mixT * m, uint8_t s);
+bool mixActive(const mixT * m);
+uint8_t mixRun(mixT * m, int16_t * out, uint16_t n);
+void mixKernel(const int16_t * const * in, const int16_t * gain,
+               uint8_t streams, int16_t * out, uint16_t n);
+
+#endif /* MIX_H_ */
@@ -0,0 +1,704 @@
+/*
+ * mmc_dma.c
+ *
+ * FatFs disk layer for an SD card on SSI0 (PA2 CLK, PA3 CS, PA4 RX, PA5 TX),
+ * after ChaN's generic MMC driver as ported in TivaWare's mmc-ek-tm4c123g.c,
+ * which it replaces in the build. Commands, tokens and CRCs still go byte by
+ * byte. The 512 byte data blocks are moved by the uDMA on the SSI0 RX and TX
+ * channels while the CPU waits in mmcIdle, and so is the card busy time after
+ * a write.
+ *
+ * The RX channel drains the FIFO on writes and sends into a sink byte, the TX
+ * channel clocks a fill byte out on reads. RX has the lower channel number,
+ * so the uDMA serves it first and the RX FIFO can not overflow.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_ssi.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/ssi.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
+#include "fatfs/src/diskio.h"
+#include "mmc_dma.h"
+#include "perf.h"
+#include "rtc.h"
+
+// Peripherals and pins of the card socket
+#define SDC_SSI_BASE            SSI0_BASE
+#define SDC_SSI_SYSCTL_PERIPH   SYSCTL_PERIPH_SSI0
+#define SDC_GPIO_PORT_BASE      GPIO_PORTA_BASE
+#define SDC_GPIO_SYSCTL_PERIPH  SYSCTL_PERIPH_GPIOA
+#define SDC_SSI_CLK             GPIO_PIN_2
+#define SDC_SSI_TX              GPIO_PIN_5
+#define SDC_SSI_RX              GPIO_PIN_4
+#define SDC_SSI_PINS            (SDC_SSI_TX | SDC_SSI_RX | SDC_SSI_CLK)
+#define SDC_CS                  GPIO_PIN_3
+
+// MMC/SDC commands
+#define CMD0    (0x40+0)    // GO_IDLE_STATE
+#define CMD1    (0x40+1)    // SEND_OP_COND
+#define CMD8    (0x40+8)    // SEND_IF_COND
+#define CMD9    (0x40+9)    // SEND_CSD
+#define CMD10   (0x40+10)   // SEND_CID
+#define CMD12   (0x40+12)   // STOP_TRANSMISSION
+#define CMD16   (0x40+16)   // SET_BLOCKLEN
+#define CMD17   (0x40+17)   // READ_SINGLE_BLOCK
+#define CMD18   (0x40+18)   // READ_MULTIPLE_BLOCK
+#define CMD23   (0x40+23)   // SET_BLOCK_COUNT
+#define CMD24   (0x40+24)   // WRITE_BLOCK
+#define CMD25   (0x40+25)   // WRITE_MULTIPLE_BLOCK
+#define CMD41   (0x40+41)   // SEND_OP_COND (ACMD)
+#define CMD55   (0x40+55)   // APP_CMD
+#define CMD58   (0x40+58)   // READ_OCR
+
+// Card type flags
+#define CT_MMC   0x01
+#define CT_SD1   0x02
+#define CT_SD2   0x04
+#define CT_SDC   (CT_SD1 | CT_SD2)
+#define CT_BLOCK 0x08       // Block addressing
+
+bool mmcUseDma = true;
+void (* volatile mmcIdle)(void) = 0;
+uint64_t mmcIdleCycles = 0;
+mmcStatT mmcStat;
+
+static volatile DSTATUS Stat = STA_NOINIT;
+static volatile BYTE Timer1, Timer2; // 100Hz decrement timers
+static BYTE CardType;
+static BYTE PowerFlag = 0;
+
+static volatile bool mmcBusy;        // uDMA block transfer running
+static uint8_t mmcFill = 0xFF;       // Sent while reading a block
+static uint8_t mmcSink;              // Received while writing a block
+
+static void SELECT(void) {
+  GPIOPinWrite(SDC_GPIO_PORT_BASE, SDC_CS, 0);
+}
+
+static void DESELECT(void) {
+  GPIOPinWrite(SDC_GPIO_PORT_BASE, SDC_CS, SDC_CS);
+}
+
+static void xmit_spi(BYTE dat) {
+  uint32_t rcvdat;
+
+  SSIDataPut(SDC_SSI_BASE, dat);
+  SSIDataGet(SDC_SSI_BASE, &rcvdat); // Flush the byte clocked in
+}
+
+static BYTE rcvr_spi(void) {
+  uint32_t rcvdat;
+
+  SSIDataPut(SDC_SSI_BASE, 0xFF);
+  SSIDataGet(SDC_SSI_BASE, &rcvdat);
+
+  return (BYTE) rcvdat;
+}
+
+//
+// Wait until the card is ready. In DMA mode the wait goes to mmcIdle, the
+// card is busy for the whole programming time after each block written.
+//
+static BYTE wait_ready(void) {
+  uint32_t start = perfNow();
+  BYTE res;
+
+  Timer2 = 50; // 500ms
+  rcvr_spi();
+  do {
+    res = rcvr_spi();
+
+    if ((res != 0xFF) && mmcUseDma && mmcIdle) {
+      mmcIdle();
+    }
+  } while ((res != 0xFF) && Timer2);
+
+  if (mmcUseDma) {
+    mmcIdleCycles += perfNow() - start;
+  }
+
+  return res;
+}
+
+//
+// Move n bytes by uDMA, out of tx (or the fill byte) and into rx (or the
+// sink byte), and wait in mmcIdle until the RX channel is done
+//
+static bool mmcXfer(const BYTE * tx, BYTE * rx, uint16_t n) {
+  uint32_t start;
+
+  uDMAChannelControlSet(UDMA_CHANNEL_SSI0RX | UDMA_PRI_SELECT,
+                        UDMA_SIZE_8 | UDMA_SRC_INC_NONE |
+                        (rx ? UDMA_DST_INC_8 : UDMA_DST_INC_NONE) |
+                        UDMA_ARB_4);
+  uDMAChannelControlSet(UDMA_CHANNEL_SSI0TX | UDMA_PRI_SELECT,
+                        UDMA_SIZE_8 | UDMA_DST_INC_NONE |
+                        (tx ? UDMA_SRC_INC_8 : UDMA_SRC_INC_NONE) |
+                        UDMA_ARB_4);
+  uDMAChannelTransferSet(UDMA_CHANNEL_SSI0RX | UDMA_PRI_SELECT,
+                         UDMA_MODE_BASIC,
+                         (void *) (SDC_SSI_BASE + SSI_O_DR),
+                         rx ? rx : &mmcSink, n);
+  uDMAChannelTransferSet(UDMA_CHANNEL_SSI0TX | UDMA_PRI_SELECT,
+                         UDMA_MODE_BASIC, tx ? (void *) tx : &mmcFill,
+                         (void *) (SDC_SSI_BASE + SSI_O_DR), n);
+
+  mmcBusy = true;
+  start = perfNow();
+
+  uDMAChannelEnable(UDMA_CHANNEL_SSI0RX);
+  uDMAChannelEnable(UDMA_CHANNEL_SSI0TX);
+  SSIDMAEnable(SDC_SSI_BASE, SSI_DMA_RX | SSI_DMA_TX);
+
+  Timer1 = 10; // 100ms
+  while (mmcBusy && Timer1) {
+    if (mmcIdle) {
+      mmcIdle();
+    }
+  }
+
+  SSIDMADisable(SDC_SSI_BASE, SSI_DMA_RX | SSI_DMA_TX);
+  mmcIdleCycles += perfNow() - start;
+
+  if (mmcBusy) {
+    uDMAChannelDisable(UDMA_CHANNEL_SSI0TX);
+    uDMAChannelDisable(UDMA_CHANNEL_SSI0RX);
+    mmcBusy = false;
+    return false;
+  }
+
+  return true;
+}
+
+//
+// The uDMA done interrupts of both SSI0 channels come here. RX finishes
+// last, the block is through when it has stopped.
+//
+void mmcIntHandler(void) {
+  if (!uDMAChannelIsEnabled(UDMA_CHANNEL_SSI0RX)) {
+    mmcBusy = false;
+  }
+}
+
+//
+// Clock 80 cycles with CS and DI high so the card goes to native mode
+//
+static void send_initial_clock_train(void) {
+  unsigned int i;
+  uint32_t dat;
+
+  DESELECT();
+
+  // Drive the TX line high as a GPIO while clocking
+  GPIOPinTypeGPIOOutput(SDC_GPIO_PORT_BASE, SDC_SSI_TX);
+  GPIOPinWrite(SDC_GPIO_PORT_BASE, SDC_SSI_TX, SDC_SSI_TX);
+
+  for (i = 0; i < 10; i++) {
+    SSIDataPut(SDC_SSI_BASE, 0xFF);
+    SSIDataGet(SDC_SSI_BASE, &dat);
+  }
+
+  GPIOPinTypeSSI(SDC_GPIO_PORT_BASE, SDC_SSI_TX);
+}
+
+static void power_on(void) {
+  uint32_t dat;
+
+  SysCtlPeripheralEnable(SDC_SSI_SYSCTL_PERIPH);
+  SysCtlPeripheralEnable(SDC_GPIO_SYSCTL_PERIPH);
+
+  GPIOPinConfigure(GPIO_PA2_SSI0CLK);
+  GPIOPinConfigure(GPIO_PA4_SSI0RX);
+  GPIOPinConfigure(GPIO_PA5_SSI0TX);
+  GPIOPinTypeSSI(SDC_GPIO_PORT_BASE, SDC_SSI_PINS);
+  GPIOPinTypeGPIOOutput(SDC_GPIO_PORT_BASE, SDC_CS);
+
+  GPIOPadConfigSet(SDC_GPIO_PORT_BASE, SDC_SSI_PINS | SDC_CS,
+                   GPIO_STRENGTH_4MA, GPIO_PIN_TYPE_STD_WPU);
+
+  // 400kHz until the card is initialized
+  SSIConfigSetExpClk(SDC_SSI_BASE, SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
+                     SSI_MODE_MASTER, 400000, 8);
+  SSIEnable(SDC_SSI_BASE);
+
+  while (SSIDataGetNonBlocking(SDC_SSI_BASE, &dat));
+
+  // Block transfers. The control table is set up by acqConfig() at boot.
+  uDMAChannelAssign(UDMA_CH10_SSI0RX);
+  uDMAChannelAssign(UDMA_CH11_SSI0TX);
+  uDMAChannelAttributeDisable(UDMA_CHANNEL_SSI0RX, UDMA_ATTR_ALL);
+  uDMAChannelAttributeDisable(UDMA_CHANNEL_SSI0TX, UDMA_ATTR_ALL);
+  IntEnable(INT_SSI0);
+
+  PowerFlag = 1;
+}
+
+static void set_max_speed(void) {
+  uint32_t i;
+
+  SSIDisable(SDC_SSI_BASE);
+
+  i = SysCtlClockGet() / 2;
+  if (i > 12500000) {
+    i = 12500000;
+  }
+
+  SSIConfigSetExpClk(SDC_SSI_BASE, SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
+                     SSI_MODE_MASTER, i, 8);
+  SSIEnable(SDC_SSI_BASE);
+}
+
+static void power_off(void) {
+  SELECT();
+  wait_ready();
+  DESELECT();
+  rcvr_spi();
+
+  IntDisable(INT_SSI0);
+  PowerFlag = 0;
+}
+
+static int chk_power(void) {
+  return PowerFlag;
+}
+
+//
+// Receive a data block of btr bytes, a multiple of 4
+//
+static bool rcvr_datablock(BYTE * buff, UINT btr) {
+  BYTE token;
+
+  Timer1 = 10; // 100ms
+  do {
+    token = rcvr_spi();
+  } while ((token == 0xFF) && Timer1);
+
+  if (token != 0xFE) {
+    return false;
+  }
+
+  if (mmcUseDma && (btr == 512)) {
+    if (!mmcXfer(0, buff, btr)) {
+      return false;
+    }
+  }
+  else {
+    do {
+      *buff++ = rcvr_spi();
+      *buff++ = rcvr_spi();
+      *buff++ = rcvr_spi();
+      *buff++ = rcvr_spi();
+    } while (btr -= 4);
+  }
+
+  // CRC
+  rcvr_spi();
+  rcvr_spi();
+
+  return true;
+}
+
+//
+// Send a 512 byte data block with the given token, or only the stop token
+//
+#if _READONLY == 0
+static bool xmit_datablock(const BYTE * buff, BYTE token) {
+  BYTE resp;
+  BYTE wc;
+
+  if (wait_ready() != 0xFF) {
+    return false;
+  }
+
+  xmit_spi(token);
+
+  if (token != 0xFD) {
+    if (mmcUseDma) {
+      if (!mmcXfer(buff, 0, 512)) {
+        return false;
+      }
+    }
+    else {
+      wc = 0;
+      do {
+        xmit_spi(*buff++);
+        xmit_spi(*buff++);
+      } while (--wc);
+    }
+
+    // CRC
+    xmit_spi(0xFF);
+    xmit_spi(0xFF);
+
+    resp = rcvr_spi();
+    if ((resp & 0x1F) != 0x05) {
+      return false;
+    }
+  }
+
+  return true;
+}
+#endif
+
+static BYTE send_cmd(BYTE cmd, DWORD arg) {
+  BYTE n, res;
+
+  if (wait_ready() != 0xFF) {
+    return 0xFF;
+  }
+
+  xmit_spi(cmd);
+  xmit_spi((BYTE) (arg >> 24));
+  xmit_spi((BYTE) (arg >> 16));
+  xmit_spi((BYTE) (arg >> 8));
+  xmit_spi((BYTE) arg);
+
+  // Only CMD0 and CMD8 are checked in SPI mode
+  n = 0xFF;
+  if (cmd == CMD0) {
+    n = 0x95;
+  }
+  if (cmd == CMD8) {
+    n = 0x87;
+  }
+  xmit_spi(n);
+
+  // Skip the stuff byte after CMD12
+  if (cmd == CMD12) {
+    rcvr_spi();
+  }
+
+  n = 10;
+  do {
+    res = rcvr_spi();
+  } while ((res & 0x80) && --n);
+
+  return res;
+}
+
+//
+// The card takes up to a second to leave its idle state. A recording started
+// at reset goes on in mmcIdle meanwhile.
+//
+static void mmcInitIdle(void) {
+  if (mmcIdle) {
+    mmcIdle();
+  }
+}
+
+DSTATUS disk_initialize(BYTE drv) {
+  BYTE n, ty, ocr[4];
+
+  if (drv) {
+    return STA_NOINIT;
+  }
+  if (Stat & STA_NODISK) {
+    return Stat;
+  }
+
+  power_on();
+  send_initial_clock_train();
+
+  SELECT();
+  ty = 0;
+
+  if (send_cmd(CMD0, 0) == 1) {
+    Timer1 = 100; // 1s
+    if (send_cmd(CMD8, 0x1AA) == 1) {
+      // SDC version 2, check the voltage range
+      for (n = 0; n < 4; n++) {
+        ocr[n] = rcvr_spi();
+      }
+      if ((ocr[2] == 0x01) && (ocr[3] == 0xAA)) {
+        do {
+          if ((send_cmd(CMD55, 0) <= 1) && (send_cmd(CMD41, 1UL << 30) == 0)) {
+            break;
+          }
+          mmcInitIdle();
+        } while (Timer1);
+
+        if (Timer1 && (send_cmd(CMD58, 0) == 0)) {
+          for (n = 0; n < 4; n++) {
+            ocr[n] = rcvr_spi();
+          }
+          ty = (ocr[0] & 0x40) ? (CT_SD2 | CT_BLOCK) : CT_SD2;
+        }
+      }
+    }
+    else {
+      // SDC version 1 or MMC
+      ty = ((send_cmd(CMD55, 0) <= 1) && (send_cmd(CMD41, 0) <= 1)) ?
+           CT_SD1 : CT_MMC;
+      do {
+        if (ty == CT_SD1) {
+          if ((send_cmd(CMD55, 0) <= 1) && (send_cmd(CMD41, 0) == 0)) {
+            break;
+          }
+        }
+        else if (send_cmd(CMD1, 0) == 0) {
+          break;
+        }
+        mmcInitIdle();
+      } while (Timer1);
+
+      if (!Timer1 || (send_cmd(CMD16, 512) != 0)) {
+        ty = 0;
+      }
+    }
+  }
+
+  CardType = ty;
+  DESELECT();
+  rcvr_spi();
+
+  if (ty) {
+    Stat &= ~STA_NOINIT;
+    set_max_speed();
+  }
+  else {
+    power_off();
+  }
+
+  return Stat;
+}
+
+DSTATUS disk_status(BYTE drv) {
+  if (drv) {
+    return STA_NOINIT;
+  }
+
+  return Stat;
+}
+
+DRESULT disk_read(BYTE drv, BYTE * buff, DWORD sector, BYTE count) {
+  if (drv || !count) {
+    return RES_PARERR;
+  }
+  if (Stat & STA_NOINIT) {
+    return RES_NOTRDY;
+  }
+
+  mmcStat.reads++;
+  mmcStat.readSectors += count;
+
+  if (!(CardType & CT_BLOCK)) {
+    sector *= 512;
+  }
+
+  SELECT();
+
+  if (count == 1) {
+    if ((send_cmd(CMD17, sector) == 0) && rcvr_datablock(buff, 512)) {
+      count = 0;
+    }
+  }
+  else if (send_cmd(CMD18, sector) == 0) {
+    do {
+      if (!rcvr_datablock(buff, 512)) {
+        break;
+      }
+      buff += 512;
+    } while (--count);
+
+    send_cmd(CMD12, 0);
+  }
+
+  DESELECT();
+  rcvr_spi();
+
+  return count ? RES_ERROR : RES_OK;
+}
+
+#if _READONLY == 0
+DRESULT disk_write(BYTE drv, const BYTE * buff, DWORD sector, BYTE count) {
+  if (drv || !count) {
+    return RES_PARERR;
+  }
+  if (Stat & STA_NOINIT) {
+    return RES_NOTRDY;
+  }
+  if (Stat & STA_PROTECT) {
+    return RES_WRPRT;
+  }
+
+  mmcStat.writes++;
+  mmcStat.writeSectors += count;
+
+  if (!(CardType & CT_BLOCK)) {
+    sector *= 512;
+  }
+
+  SELECT();
+
+  if (count == 1) {
+    if ((send_cmd(CMD24, sector) == 0) && xmit_datablock(buff, 0xFE)) {
+      count = 0;
+    }
+  }
+  else {
+    // Pre-erase the blocks about to be written
+    if (CardType & CT_SDC) {
+      send_cmd(CMD55, 0);
+      send_cmd(CMD23, count);
+    }
+
+    if (send_cmd(CMD25, sector) == 0) {
+      do {
+        if (!xmit_datablock(buff, 0xFC)) {
+          break;
+        }
+        buff += 512;
+      } while (--count);
+
+      // Stop token
+      if (!xmit_datablock(0, 0xFD)) {
+        count = 1;
+      }
+    }
+  }
+
+  DESELECT();
+  rcvr_spi();
+
+  return count ? RES_ERROR : RES_OK;
+}
+#endif
+
+DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void * buff) {
+  DRESULT res;
+  BYTE n, csd[16], * ptr = buff;
+  WORD csize;
+
+  if (drv) {
+    return RES_PARERR;
+  }
+
+  res = RES_ERROR;
+
+  if (ctrl == CTRL_POWER) {
+    switch (*ptr) {
+    case 0:
+      if (chk_power()) {
+        power_off();
+      }
+      res = RES_OK;
+      break;
+    case 1:
+      power_on();
+      res = RES_OK;
+      break;
+    case 2:
+      *(ptr + 1) = (BYTE) chk_power();
+      res = RES_OK;
+      break;
+    default:
+      res = RES_PARERR;
+    }
+
+    return res;
+  }
+
+  if (Stat & STA_NOINIT) {
+    return RES_NOTRDY;
+  }
+
+  SELECT();
+
+  switch (ctrl) {
+  case GET_SECTOR_COUNT:
+    if ((send_cmd(CMD9, 0) == 0) && rcvr_datablock(csd, 16)) {
+      if ((csd[0] >> 6) == 1) {
+        // SDC version 2
+        csize = csd[9] + ((WORD) csd[8] << 8) + 1;
+        *(DWORD *) buff = (DWORD) csize << 10;
+      }
+      else {
+        // SDC version 1 or MMC
+        n = (csd[5] & 15) + ((csd[10] & 128) >> 7) + ((csd[9] & 3) << 1) + 2;
+        csize = (csd[8] >> 6) + ((WORD) csd[7] << 2) +
+                ((WORD) (csd[6] & 3) << 10) + 1;
+        *(DWORD *) buff = (DWORD) csize << (n - 9);
+      }
+      res = RES_OK;
+    }
+    break;
+
+  case GET_SECTOR_SIZE:
+    *(WORD *) buff = 512;
+    res = RES_OK;
+    break;
+
+  case CTRL_SYNC:
+    if (wait_ready() == 0xFF) {
+      res = RES_OK;
+    }
+    break;
+
+  case MMC_GET_CSD:
+    if ((send_cmd(CMD9, 0) == 0) && rcvr_datablock(ptr, 16)) {
+      res = RES_OK;
+    }
+    break;
+
+  case MMC_GET_CID:
+    if ((send_cmd(CMD10, 0) == 0) && rcvr_datablock(ptr, 16)) {
+      res = RES_OK;
+    }
+    break;
+
+  case MMC_GET_OCR:
+    if (send_cmd(CMD58, 0) == 0) {
+      for (n = 0; n < 4; n++) {
+        *ptr++ = rcvr_spi();
+      }
+      res = RES_OK;
+    }
+    break;
+
+  case MMC_GET_TYPE:
+    *ptr = CardType;
+    res = RES_OK;
+    break;
+
+  default:
+    res = RES_PARERR;
+  }
+
+  DESELECT();
+  rcvr_spi();
+
+  return res;
+}
+
+//
+// Called from the SysTick handler every 10ms
+//
+void disk_timerproc(void) {
+  BYTE n;
+
+  n = Timer1;
+  if (n) {
+    Timer1 = --n;
+  }
+
+  n = Timer2;
+  if (n) {
+    Timer2 = --n;
+  }
+}
+
+//
+// From the RTC once "date" set it, RTC_FALLBACK_YEAR-01-01 00:00 until then
+//
+DWORD get_fattime(void) {
+  return rtcFatTime();
+}
@@ -0,0 +1,40 @@
+/*
+ * mmc_dma.h
+ * SD card disk layer for FatFs on SSI0 with uDMA block transfers
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef MMC_DMA_H_
+#define MMC_DMA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Move data blocks with the uDMA, else byte by byte like the TivaWare port
+extern bool mmcUseDma;
+
+//
+// Called over and over while the uDMA moves a block or the card is busy, so
+// the caller of f_write() can get work done meanwhile. It must not call FatFs.
+// A long call delays the disk access by the time it overruns the wait.
+//
+extern void (* volatile mmcIdle)(void);
+
+// Cycles spent waiting for the uDMA or the card, given to mmcIdle
+extern uint64_t mmcIdleCycles;
+
+// Disk layer calls and the sectors they moved, to see how FatFs splits up
+// the file accesses
+typedef struct {
+  uint32_t reads;
+  uint32_t readSectors;
+  uint32_t writes;
+  uint32_t writeSectors;
+} mmcStatT;
+
+extern mmcStatT mmcStat;
+
+void mmcIntHandler(void);
+
+#endif /* MMC_DMA_H_ */
@@ -0,0 +1,243 @@
+/*
+ * mon.c
+ *
+ * The capture moves blocks of monBlock * procDecimation ADC samples into
+ * elements of the ring, and the main loop filters each one in place into
+ * monBlock samples at DAC_RATE. The element then goes on a queue the DAC
+ * takes its elements from, which frees it back into the ring once played, so
+ * a block is never copied on its way to the PWM.
+ *
+ * The DAC period is set to procDecimation ADC periods, so both count the same
+ * clock and the queue neither runs dry nor grows. The DAC starts once lead
+ * blocks are filtered, so a block may wait lead - 1 block times for the
+ * filter before the DAC needs it. A tick with no block to play is a gap, and
+ * every gap adds a tick to the latency from then on.
+ *
+ * Latency is taken when the DAC takes a block. Its output sample j holds ADC
+ * samples up to procDecimation * j + procDecimation - 1, converted
+ * (monBlock - 1 - j) DAC periods before the capture interrupt stamped the
+ * block, and goes out j + 1 periods after the fetch. That adds up to
+ *
+ *   fetch - stamp + monBlock DAC periods
+ *
+ * for every sample of the block. It leaves out the conversion and the capture
+ * interrupt latency, a few us that "jitter" shows, the PWM period of 12.8us
+ * before a new width shows, and the group delay of the filter, which
+ * monPrint() adds.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "mon.h"
+#include "dac.h"
+#include "capture.h"
+#include "proc.h"
+#include "global.h"
+#include "utils/uartstdio.h"
+
+#ifdef RAM_CODE
+#pragma CODE_SECTION(monNext, ".ramfunc")
+#endif
+
+monStatT monStat;
+
+static uint16_t monBlock;  // Output samples per block
+static uint32_t monPeriod; // Cycles per DAC sample
+
+// Filtered elements the DAC plays next, written by the main loop at the head
+// and read by the DAC interrupt at the tail
+static elementT * volatile monQueue[bufSize];
+static volatile uint8_t monHead;
+static volatile uint8_t monTail;
+static bool monStarted;
+
+// Recording: two halves of monRecBlock samples, one filled while the other
+// one is written
+static FIL * monRec;
+static int16_t * monRecBuf;
+static bool monRecPending[2];
+static uint8_t monRecHalf; // Half being filled
+static uint8_t monRecNext; // Half to write next
+static uint16_t monRecFill;
+
+//
+// The next block to play, from the DAC interrupt
+//
+static elementT * monNext(void) {
+  elementT * elem;
+  uint32_t now = perfNow();
+
+  if (monTail == monHead) {
+    monStat.gaps += monStarted;
+    return 0;
+  }
+
+  elem = monQueue[monTail];
+  monTail = (monTail + 1) % bufSize;
+
+  perfStatAdd(&monStat.latency,
+              now - elem->stamp + monBlock * monPeriod);
+  monStarted = true;
+
+  return elem;
+}
+
+//
+// Set the monitor up for blocks of block output samples, a power of two from
+// monBlockMin to monBlockMax. rec is the file to record to, or 0, and recBuf
+// holds 2 * monRecBlock samples for it. The capture has to be set up with
+// capSize = block * procDecimation.
+//
+void monInit(uint16_t block, FIL * rec, int16_t * recBuf) {
+  memset(&monStat, 0, sizeof(monStat));
+  perfStatReset(&monStat.latency);
+  perfStatReset(&monStat.proc);
+
+  monBlock = block;
+  monPeriod = procDecimation * (SYS_CLK / capRate + 1);
+  monHead = 0;
+  monTail = 0;
+  monStarted = false;
+
+  monRec = rec;
+  monRecBuf = recBuf;
+  monRecPending[0] = false;
+  monRecPending[1] = false;
+  monRecHalf = 0;
+  monRecNext = 0;
+  monRecFill = 0;
+
+  procInitSmall();
+}
+
+//
+// Copy a filtered block into the recording, or count it as dropped while
+// both halves wait for the card
+//
+static void monRecPut(const int16_t * x) {
+  if (monRecPending[monRecHalf]) {
+    monStat.recDropped += monBlock;
+    return;
+  }
+
+  memcpy(monRecBuf + monRecHalf * monRecBlock + monRecFill, x,
+         monBlock * sizeof(int16_t));
+  monRecFill += monBlock;
+
+  if (monRecFill == monRecBlock) {
+    monRecPending[monRecHalf] = true;
+    monRecHalf ^= 1;
+    monRecFill = 0;
+  }
+}
+
+//
+// Filter the blocks captured and queue them for the DAC. It is the mmcIdle
+// of a recording, so it makes no FatFs calls.
+//
+void monStep(void) {
+  elementT * elem;
+  uint32_t start;
+
+  while ((elem = bufGet(gpBuf)) != 0) {
+    start = perfNow();
+    procSmall(elem, monBlock * procDecimation);
+    perfStatAdd(&monStat.proc, perfNow() - start);
+
+    if (monRec) {
+      monRecPut(elem->data);
+    }
+
+    // The DAC frees it once played
+    monQueue[monHead] = elem;
+    monHead = (monHead + 1) % bufSize;
+    monStat.blocks++;
+  }
+}
+
+// Blocks filtered the DAC has not taken yet
+uint8_t monQueued(void) {
+  return (monHead + bufSize - monTail) % bufSize;
+}
+
+//
+// Hand the DAC over to the monitor and start it, in step with the capture
+//
+void monStart(void) {
+  dacIndex = 0;
+  dacBuf = 0;
+  dacLength = monBlock;
+  dacNext = monNext;
+  dacPeriodSet(monPeriod);
+  dacEnable();
+}
+
+//
+// Stop the DAC and give it back to the ring, at its usual rate
+//
+void monStop(void) {
+  dacDisable();
+  dacNext = 0;
+  dacBuf = 0;
+  dacLength = elementSize;
+  dacPeriodSet(SYS_CLK/DAC_RATE + 1);
+}
+
+//
+// Write the halves of the recording that are full, and with flush the samples
+// of the one being filled too. FR_DENIED when the card is full.
+//
+FRESULT monRecWrite(bool flush) {
+  FRESULT res = FR_OK;
+  UINT n, bw;
+
+  while (monRecPending[monRecNext]) {
+    n = monRecBlock * sizeof(int16_t);
+    res = f_write(monRec, monRecBuf + monRecNext * monRecBlock, n, &bw);
+    if ((res == FR_OK) && (bw < n)) {
+      res = FR_DENIED;
+    }
+    if (res != FR_OK) {
+      return res;
+    }
+
+    monStat.recSamples += monRecBlock;
+    monRecPending[monRecNext] = false;
+    monRecNext ^= 1;
+  }
+
+  if (flush && monRecFill) {
+    n = monRecFill * sizeof(int16_t);
+    res = f_write(monRec, monRecBuf + monRecHalf * monRecBlock, n, &bw);
+    if ((res == FR_OK) && (bw < n)) {
+      res = FR_DENIED;
+    }
+    monStat.recSamples += bw / sizeof(int16_t);
+    monRecFill = 0;
+  }
+
+  return res;
+}
+
+//
+// Print the block size, the gaps and the latency in us as JSON. total_us adds
+// the group delay of the TAPS long filter to the average.
+//
+void monPrint(uint8_t lead) {
+  uint32_t us = SYS_CLK / 1000000;
+  uint32_t filter = (TAPS - 1) / 2 * 1000000 / capRate;
+  perfStatT * l = &monStat.latency;
+  uint32_t min = l->count ? l->min : 0;
+
+  UARTprintf("{\"block\":%u,\"lead\":%u,\"block_us\":%u,\"blocks\":%u,"
+             "\"gaps\":%u,", monBlock, lead, monBlock * monPeriod / us,
+             monStat.blocks, monStat.gaps);
+  UARTprintf("\"latency_us\":{\"min\":%u,\"avg\":%u,\"max\":%u},"
+             "\"filter_us\":%u,\"total_us\":%u,", min / us,
+             perfStatAvg(l) / us, l->max / us, filter,
+             perfStatAvg(l) / us + filter);
+  UARTprintf("\"proc_cycles\":{\"avg\":%u,\"max\":%u},"
+             "\"rec_samples\":%u,\"rec_dropped\":%u}\n",
+             perfStatAvg(&monStat.proc), monStat.proc.max,
+             monStat.recSamples, monStat.recDropped);
+}
@@ -0,0 +1,46 @@
+/*
+ * mon.h
+ * Live monitor: capture, filter and DAC in blocks of a few ms, with the ADC
+ * to PWM latency of every block measured
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef MON_H_
+#define MON_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/src/ff.h"
+#include "cirbuf.h"
+#include "perf.h"
+
+enum {
+  monBlockMin = 8,          // Output samples per block, BLOCK_SIZE ADC samples
+  monBlockMax = 64,         // Half an element of ADC samples
+  monBlockDefault = 16,     // 2ms at DAC_RATE
+  monLeadMax = 4,
+  monLeadDefault = 2,       // Blocks filtered before the DAC starts
+  monRecBlock = elementSize // Samples per write, half the recording buffer
+};
+
+typedef struct {
+  uint32_t blocks;     // Blocks filtered
+  uint32_t gaps;       // DAC ticks with no block to play
+  perfStatT latency;   // Cycles from the ADC to the PWM, without the filter
+  perfStatT proc;      // Cycles to filter a block
+  uint32_t recSamples; // Samples written to the recording
+  uint32_t recDropped; // Samples the recording had no room for
+} monStatT;
+
+extern monStatT monStat;
+
+void monInit(uint16_t block, FIL * rec, int16_t * recBuf);
+void monStep(void);
+uint8_t monQueued(void);
+void monStart(void);
+void monStop(void);
+FRESULT monRecWrite(bool flush);
+void monPrint(uint8_t lead);
+
+#endif /* MON_H_ */
@@ -0,0 +1,116 @@
+/*
+ * ols.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "ols.h"
+#include "proc.h"
+#include "conv.h"
+
+//
+// Smallest FFT size for a filter of the given length, 0 if it is too long.
+// hop = N/2 must divide elementSize and keep the decimation phase, which any
+// power of two from olsMinFft does.
+//
+uint16_t olsFftSize(uint16_t taps) {
+  uint16_t n = olsMinFft;
+
+  while ((n / 2 + 1 < taps) && (n < olsMaxFft)) {
+    n *= 2;
+  }
+
+  return (n / 2 + 1 >= taps) ? n : 0;
+}
+
+//
+// Estimated cycles per element for the overlap-save engine, or UINT32_MAX if
+// the filter does not fit
+//
+uint32_t olsCost(uint16_t taps) {
+  uint32_t n = olsFftSize(taps);
+  uint32_t stages = 0;
+  uint32_t frame;
+
+  if (!n) {
+    return UINT32_MAX;
+  }
+
+  while ((2u << stages) < n) {
+    stages++;
+  }
+
+  // Forward and inverse FFT, then everything linear in N
+  frame = 2 * (n / 2) * stages * OLS_FFT_CYCLES + n * OLS_BIN_CYCLES;
+
+  return frame * (elementSize / (n / 2));
+}
+
+// Estimated cycles per element for the direct form FIR
+uint32_t olsFirCost(uint16_t taps) {
+  return (uint32_t) elementSize * taps * OLS_FIR_TAP_CYCLES;
+}
+
+//
+// Set up the engine for a filter and clear the input history. Returns false if
+// the filter is longer than olsMaxTaps.
+//
+bool olsInit(olsT * o, const float32_t * coeffs, uint16_t taps,
+             float32_t * h, float32_t * frame) {
+  uint16_t i;
+
+  o->size = olsFftSize(taps);
+  if (!o->size) {
+    return false;
+  }
+
+  o->hop = o->size / 2;
+  o->h = h;
+  o->frame = frame;
+  arm_rfft_fast_init_f32(&o->fft, o->size);
+
+  // Spectrum of the zero padded impulse response. coeffs are in the order
+  // arm_fir_f32() takes them, time reversed, so any filter gives the same
+  // output as the direct form. The inverse FFT scales by 1/N, so the product
+  // needs no extra scaling.
+  memset(frame, 0, o->size * sizeof(float32_t));
+  for (i = 0; i < taps; i++) {
+    frame[i] = coeffs[taps - 1 - i];
+  }
+  arm_rfft_fast_f32(&o->fft, frame, h, 0);
+
+  memset(frame, 0, o->size * sizeof(float32_t));
+
+  return true;
+}
+
+//
+// Filter elementSize centered samples scaled by CONV_SCALE and decimate them
+// into procOutSize int16 samples, like procFilterRun(). tmp holds at least N
+// floats and may not overlap in, which is left untouched.
+//
+void olsRun(olsT * o, const float32_t * in, float32_t * tmp, int16_t * out) {
+  float32_t * frame = o->frame;
+  float32_t * h = o->h;
+  uint16_t hop = o->hop;
+  uint16_t i;
+
+  for (i = 0; i < elementSize; i += hop) {
+    memcpy(frame + hop, in + i, hop * sizeof(float32_t));
+    arm_rfft_fast_f32(&o->fft, frame, tmp, 0);
+
+    // Packed format: DC and Nyquist are real and share the first bin
+    tmp[0] *= h[0];
+    tmp[1] *= h[1];
+    arm_cmplx_mult_cmplx_f32(tmp + 2, h + 2, tmp + 2, hop - 1);
+
+    arm_rfft_fast_f32(&o->fft, tmp, frame, 1);
+
+    // The second half has no circular wrap-around, it is the filter output
+    convFloatToInt(frame + hop, out + i / procDecimation, hop / procDecimation,
+                   procDecimation, INT16_MAX);
+
+    // These samples are the history of the next frame
+    memcpy(frame, in + i, hop * sizeof(float32_t));
+  }
+}
@@ -0,0 +1,50 @@
+/*
+ * ols.h
+ * Overlap-save FFT convolution for long filters
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef OLS_H_
+#define OLS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cirbuf.h"
+
+// CMSIS
+#include "arm_math.h"
+
+enum {
+  olsMinFft = 32,          // Smallest arm_rfft_fast_f32 size
+  olsMaxFft = elementSize, // Largest, so the caller's tmp buffer fits a frame
+  olsMaxTaps = olsMaxFft / 2 + 1
+};
+
+// Cost model used to pick the engine, in cycles per element. Estimates for
+// the M4 FPU, check them against "bench crossover" and adjust.
+#define OLS_FIR_TAP_CYCLES 3 // Direct FIR, per tap and input sample
+#define OLS_FFT_CYCLES     3 // Real FFT, per (N/2)log2(N/2) butterfly leg
+#define OLS_BIN_CYCLES     8 // Spectrum product, copies and FFT pre/post pass
+
+//
+// Frames of N samples hold N/2 samples of history and N/2 new ones, so filters
+// of up to N/2 + 1 taps come out exact. h and frame point to N floats each
+// that the caller provides.
+//
+typedef struct {
+  arm_rfft_fast_instance_f32 fft;
+  uint16_t size;     // FFT size N
+  uint16_t hop;      // New samples per frame, N / 2
+  float32_t * h;     // Filter spectrum
+  float32_t * frame; // The first hop samples hold the input history
+} olsT;
+
+uint16_t olsFftSize(uint16_t taps);
+uint32_t olsCost(uint16_t taps);
+uint32_t olsFirCost(uint16_t taps);
+bool olsInit(olsT * o, const float32_t * coeffs, uint16_t taps,
+             float32_t * h, float32_t * frame);
+void olsRun(olsT * o, const float32_t * in, float32_t * tmp, int16_t * out);
+
+#endif /* OLS_H_ */
@@ -0,0 +1,53 @@
+/*
+ * perf.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include "perf.h"
+#include "utils/uartstdio.h"
+
+// Enable the DWT cycle counter
+void perfInit(void) {
+  HWREG(PERF_DEMCR) |= PERF_DEMCR_TRCENA;
+  HWREG(PERF_DWT_CYCCNT) = 0;
+  HWREG(PERF_DWT_CTRL) |= PERF_DWT_CYCCNTENA;
+}
+
+void perfStatReset(perfStatT * stat) {
+  stat->count = 0;
+  stat->total = 0;
+  stat->min = UINT32_MAX;
+  stat->max = 0;
+}
+
+// Add one measurement (in cycles) to the statistic
+void perfStatAdd(perfStatT * stat, uint32_t cycles) {
+  stat->count++;
+  stat->total += cycles;
+
+  if (cycles < stat->min) {
+    stat->min = cycles;
+  }
+  if (cycles > stat->max) {
+    stat->max = cycles;
+  }
+}
+
+uint32_t perfStatAvg(perfStatT * stat) {
+  if (stat->count == 0) {
+    return 0;
+  }
+
+  return (uint32_t) (stat->total / stat->count);
+}
+
+// Print "name: avg/min/max cycles (n)" to the console
+void perfStatPrint(const char * name, perfStatT * stat) {
+  if (stat->count == 0) {
+    UARTprintf("%s: no samples\n", name);
+    return;
+  }
+
+  UARTprintf("%s: avg %u min %u max %u cycles (n=%u)\n", name,
+             perfStatAvg(stat), stat->min, stat->max, stat->count);
+}
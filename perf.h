@@ -0,0 +1,44 @@
+/*
+ * perf.h
+ * Cycle counting helpers based on the Cortex-M4 DWT cycle counter
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef PERF_H_
+#define PERF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_types.h"
+
+// Core debug / DWT registers (not covered by the TivaWare inc/ headers)
+#define PERF_DEMCR          0xE000EDFC
+#define PERF_DEMCR_TRCENA   0x01000000
+#define PERF_DWT_CTRL       0xE0001000
+#define PERF_DWT_CYCCNTENA  0x00000001
+#define PERF_DWT_CYCCNT     0xE0001004
+
+// Current value of the free running cycle counter (wraps every ~53 s @80MHz).
+// Host models build with PERF_HOST and keep the time themselves.
+#ifdef PERF_HOST
+uint32_t perfHostNow(void);
+#define perfNow()           perfHostNow()
+#else
+#define perfNow()           (HWREG(PERF_DWT_CYCCNT))
+#endif
+
+typedef struct {
+  uint32_t count;  // Number of samples
+  uint64_t total;  // Sum of all samples
+  uint32_t min;
+  uint32_t max;
+} perfStatT;
+
+void perfInit(void);
+void perfStatReset(perfStatT * stat);
+void perfStatAdd(perfStatT * stat, uint32_t cycles);
+uint32_t perfStatAvg(perfStatT * stat);
+void perfStatPrint(const char * name, perfStatT * stat);
+
+#endif /* PERF_H_ */
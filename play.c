@@ -0,0 +1,353 @@
+/*
+ * play.c
+ *
+ * The player keeps two files open: the one playing and the next one. While
+ * the ring the DAC plays is full, the next file is opened, its header read
+ * and its first playAheadBytes of samples prefetched. Each element is filled
+ * from the file playing, and at its end the same element goes on with the
+ * prefetched samples and then the rest of the next file, so the DAC plays
+ * the last sample of one file and the first of the next one DAC_RATE apart.
+ * No open or seek stands between them, only the read of an element.
+ *
+ * A file is opened with the ring waiting for it only when the ring never
+ * filled while the one before played, and that is counted as late.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "play.h"
+#include "format.h"
+#include "dirlist.h"
+#include "utils/uartstdio.h"
+
+//
+// Open the WAV file at path and seek to its samples. start and bytes get
+// where they are. header is a buffer of WAV_HEADER_SIZE bytes. Returns
+// FR_INVALID_OBJECT, with the file closed, if it is not a WAV file.
+//
+FRESULT playOpen(FIL * fp, const char * path, uint8_t * header,
+                 uint32_t * start, uint32_t * bytes) {
+  uint32_t dataSize;
+  FRESULT res;
+  UINT n;
+
+  res = f_open(fp, path, FA_READ);
+  if (res != FR_OK) {
+    return res;
+  }
+
+  res = f_read(fp, header, WAV_HEADER_SIZE, &n);
+  if (res == FR_OK) {
+    *start = wavDataOffset(header, n, &dataSize);
+    if (!*start) {
+      res = FR_INVALID_OBJECT;
+    }
+  }
+
+  if (res == FR_OK) {
+    *bytes = (f_size(fp) > *start) ? f_size(fp) - *start : 0;
+    if (dataSize && (dataSize < *bytes)) {
+      *bytes = dataSize;
+    }
+
+    // Whole samples only
+    *bytes &= ~1u;
+
+    res = f_lseek(fp, *start);
+  }
+
+  if (res != FR_OK) {
+    f_close(fp);
+  }
+
+  return res;
+}
+
+//
+// name in the current directory, or from the root if it starts with a
+// slash, into the path of the player. False if it does not fit.
+//
+static bool playPath(playT * p, const char * name) {
+  uint32_t len = 0;
+
+  if (name[0] != '/') {
+    len = strlen(p->cwd);
+    if (len + 1 >= sizeof(p->path)) {
+      return false;
+    }
+    strcpy(p->path, p->cwd);
+    if (strcmp(p->cwd, "/")) {
+      p->path[len++] = '/';
+    }
+  }
+
+  if (len + strlen(name) + 1 > sizeof(p->path)) {
+    return false;
+  }
+  strcpy(p->path + len, name);
+
+  return true;
+}
+
+//
+// Next line of the playlist that names a file, without blanks around it.
+// Lines starting with # are comments.
+//
+static bool playLine(playT * p, char * line, uint32_t size) {
+  uint32_t len;
+  char * s;
+  char c;
+  UINT n;
+
+  for (;;) {
+    len = 0;
+    n = 0;
+
+    while ((f_read(p->list, &c, 1, &n) == FR_OK) && n && (c != '\n')) {
+      if ((c != '\r') && (len + 1 < size)) {
+        line[len++] = c;
+      }
+    }
+    line[len] = 0;
+
+    while (len && (line[len - 1] == ' ' || line[len - 1] == '\t')) {
+      line[--len] = 0;
+    }
+    for (s = line; (*s == ' ') || (*s == '\t'); s++) {
+    }
+
+    if (*s && (*s != '#')) {
+      memmove(line, s, strlen(s) + 1);
+      return true;
+    }
+
+    // End of the playlist
+    if (!n) {
+      return false;
+    }
+  }
+}
+
+//
+// Path of the next file of the list into p->path, false at its end
+//
+static bool playName(playT * p) {
+  char line[playPathSize];
+
+  if (p->pattern) {
+    while ((f_readdir(p->dir, p->info) == FR_OK) && p->info->fname[0]) {
+      if (!(p->info->fattrib & AM_DIR) &&
+          dirMatch(p->pattern, p->info->fname)) {
+        return playPath(p, p->info->fname);
+      }
+    }
+    return false;
+  }
+
+  while (playLine(p, line, sizeof(line))) {
+    if (playPath(p, line)) {
+      return true;
+    }
+    UARTprintf("%s: name too long\n", line);
+  }
+
+  return false;
+}
+
+//
+// Open the next file of the list that is a WAV file and prefetch its first
+// samples into ahead. Sets last at the end of the list.
+//
+static FRESULT playPrefetch(playT * p) {
+  uint8_t next = p->cur ^ 1;
+  uint32_t start;
+  FRESULT res;
+  UINT n;
+
+  while (!p->ready && !p->last) {
+    if (!playName(p)) {
+      p->last = true;
+      break;
+    }
+
+    res = playOpen(p->fp[next], p->path, p->ahead, &start, &p->left[next]);
+    if (res == FR_INVALID_OBJECT) {
+      UARTprintf("%s: not a WAV file, skipped\n", p->path);
+      p->skipped++;
+      continue;
+    }
+    if (res != FR_OK) {
+      return res;
+    }
+
+    n = (p->left[next] < playAheadBytes) ? p->left[next] : playAheadBytes;
+    res = f_read(p->fp[next], p->ahead, n, &n);
+    if (res != FR_OK) {
+      f_close(p->fp[next]);
+      return res;
+    }
+
+    p->left[next] -= n;
+    p->aheadBytes = n;
+    p->ready = true;
+  }
+
+  return FR_OK;
+}
+
+//
+// Fill n samples of out from the file playing, and at its end from the next
+// ones. filled gets the samples filled, less than n at the end of the list.
+//
+static FRESULT playFill(playT * p, int16_t * out, uint16_t n,
+                        uint16_t * filled) {
+  uint8_t * dst = (uint8_t *) out;
+  uint32_t want = n * sizeof(int16_t);
+  uint32_t done = 0;
+  uint32_t k;
+  FRESULT res = FR_OK;
+  UINT got;
+
+  while (done < want) {
+    // The prefetched start of the file
+    if (p->aheadPos < p->aheadEnd) {
+      k = p->aheadEnd - p->aheadPos;
+      if (k > want - done) {
+        k = want - done;
+      }
+      memcpy(dst + done, p->ahead + p->aheadPos, k);
+      p->aheadPos += k;
+      done += k;
+      continue;
+    }
+
+    // The rest of it
+    if (p->left[p->cur]) {
+      k = (p->left[p->cur] < want - done) ? p->left[p->cur] : want - done;
+      res = f_read(p->fp[p->cur], dst + done, k, &got);
+      if (res != FR_OK) {
+        break;
+      }
+
+      // A file shorter than its header says ends where it does
+      p->left[p->cur] = (got < k) ? 0 : p->left[p->cur] - got;
+      done += got;
+      continue;
+    }
+
+    // At its end, on with the next file in the same element
+    if (!p->ready) {
+      res = playPrefetch(p);
+      if ((res != FR_OK) || !p->ready) {
+        break;
+      }
+      p->late += p->files ? 1 : 0;
+    }
+
+    if (p->files) {
+      f_close(p->fp[p->cur]);
+    }
+    p->cur ^= 1;
+    p->ready = false;
+    p->aheadPos = 0;
+    p->aheadEnd = p->aheadBytes;
+    p->files++;
+  }
+
+  *filled = done / sizeof(int16_t);
+  p->samples += *filled;
+
+  return res;
+}
+
+//
+// Set the player up for arg, a pattern of WAV files in the directory cwd, or
+// a playlist file with a name per line. A name that has no * or ? and ends
+// with .WAV is a pattern too, for a single file. fp are the two files the
+// player plays from, list the one for the playlist, dir and info the
+// directory reads for a pattern. ahead is a word aligned buffer of
+// playAheadBytes.
+//
+FRESULT playInit(playT * p, const char * arg, const char * cwd, FIL * fp[2],
+                 FIL * list, DIR * dir, FILINFO * info, uint8_t * ahead) {
+  uint32_t len = strlen(arg);
+  FRESULT res;
+
+  memset(p, 0, sizeof(*p));
+  p->fp[0] = fp[0];
+  p->fp[1] = fp[1];
+  p->dir = dir;
+  p->info = info;
+  p->ahead = ahead;
+  p->cwd = cwd;
+
+  if (strchr(arg, '*') || strchr(arg, '?') ||
+      ((len > 4) && dirMatch("*.WAV", arg))) {
+    p->pattern = arg;
+    res = f_opendir(dir, cwd);
+  }
+  else if (playPath(p, arg)) {
+    res = f_open(list, p->path, FA_READ);
+    p->list = (res == FR_OK) ? list : 0;
+  }
+  else {
+    res = FR_INVALID_NAME;
+  }
+
+  if (res != FR_OK) {
+    return res;
+  }
+
+  // The first file, for the first element
+  return playPrefetch(p);
+}
+
+//
+// One turn of the player loop: fill an element of the ring the DAC plays if
+// it has room, or prefetch the next file while it is full. done is set when
+// the last sample of the list is in the ring, with silence after it up to
+// the end of its element.
+//
+FRESULT playStep(playT * p, volatile bufT * buf) {
+  elementT * elem;
+  uint16_t n = 0;
+  FRESULT res;
+
+  if (p->done) {
+    return FR_OK;
+  }
+
+  // The ring is full: time to open the next file, once the start of the one
+  // playing is out of ahead
+  elem = bufGetFree(buf);
+  if (!elem) {
+    return (p->aheadPos < p->aheadEnd) ? FR_OK : playPrefetch(p);
+  }
+
+  res = playFill(p, elem->data, elementSize, &n);
+  if (n < elementSize) {
+    memset(&elem->data[n], 0, (elementSize - n) * sizeof(bufDataT));
+    p->done = true;
+  }
+  bufItemSetFree(buf, elem->index);
+
+  return res;
+}
+
+//
+// Close the files left open, after the last step or an error
+//
+void playClose(playT * p) {
+  if (p->files) {
+    f_close(p->fp[p->cur]);
+  }
+  if (p->ready) {
+    f_close(p->fp[p->cur ^ 1]);
+  }
+  if (p->list) {
+    f_close(p->list);
+  }
+
+  p->ready = false;
+  p->list = 0;
+}
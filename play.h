@@ -0,0 +1,57 @@
+/*
+ * play.h
+ * Gapless playback of a playlist or of the WAV files matching a pattern
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef PLAY_H_
+#define PLAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/src/ff.h"
+#include "cirbuf.h"
+
+enum {
+  playAheadBytes = 2 * elementSize * sizeof(bufDataT), // Next file prefetched
+  playPathSize = 80
+};
+
+typedef struct {
+  // Files: the one playing and the next one, open and prefetched
+  FIL * fp[2];
+  uint8_t cur;
+  uint32_t left[2];   // Sample bytes not read yet
+  bool ready;         // Next file open, its first samples in ahead
+  bool last;          // No more names in the list
+  bool done;          // All of the list is in the ring
+
+  // Start of the next file, played from aheadPos to aheadEnd after the switch
+  uint8_t * ahead;
+  uint16_t aheadBytes;
+  uint16_t aheadPos;
+  uint16_t aheadEnd;
+
+  // Names, from a playlist file or a directory
+  FIL * list;
+  DIR * dir;
+  FILINFO * info;
+  const char * pattern; // Name pattern with * and ?, 0 for a playlist
+  const char * cwd;
+  char path[playPathSize];
+
+  uint32_t files;     // Files started
+  uint32_t late;      // Files opened with the ring waiting for them
+  uint32_t skipped;   // Names that are not WAV files
+  uint32_t samples;   // Samples put in the ring
+} playT;
+
+FRESULT playOpen(FIL * fp, const char * path, uint8_t * header,
+                 uint32_t * start, uint32_t * bytes);
+FRESULT playInit(playT * p, const char * arg, const char * cwd, FIL * fp[2],
+                 FIL * list, DIR * dir, FILINFO * info, uint8_t * ahead);
+FRESULT playStep(playT * p, volatile bufT * buf);
+void playClose(playT * p);
+
+#endif /* PLAY_H_ */
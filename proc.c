@@ -0,0 +1,300 @@
+/*
+ * proc.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "proc.h"
+#include "conv.h"
+#include "cic.h"
+#include "chain.h"
+
+// The CMSIS kernels it calls follow it into SRAM, see sd_card_ccs.cmd
+#ifdef RAM_CODE
+#pragma CODE_SECTION(procFilterRun, ".ramfunc")
+#pragma CODE_SECTION(procSmall, ".ramfunc")
+#endif
+
+// Data filtering helper arrays
+static float32_t inputf32[LENGTH]; // Filter inputs
+static float32_t outputf32[LENGTH]; // Filter output
+
+// Filter of the recording chain
+static procFilterT procFilter;
+
+#ifdef PROC_CHAIN
+#if !(CHAIN_STAGES & CHAIN_DECIM)
+#error "PROC_CHAIN needs CHAIN_DECIM in CHAIN_STAGES"
+#endif
+static chainT procChain;
+#endif
+
+// Mean of the previous block, used as zero crossing reference
+static int16_t prevMean;
+
+// Element filtered by procAhead() and not collected yet
+static int16_t aheadOut[procOutSize];
+static procStatT aheadStat;
+static bool aheadReady;
+
+// Oversampled chain: CIC, droop compensation, then the recording filter as a
+// polyphase decimator
+static uint8_t procRatio = 1; // ADC samples per sample at ADC_RATE
+static cicT procCic;
+static float32_t procCompCoeffs[cicCompTaps];
+static float32_t procCompState[BLOCK_SIZE + cicCompTaps - 1];
+static arm_fir_instance_f32 procComp;
+static arm_fir_decimate_instance_f32 procFinal;
+
+//
+// Reset the filter state. Must be called before each recording.
+//
+void procInit(void) {
+  procInitRate(1, 0);
+}
+
+//
+// Reset the filter state for an ADC running ratio times ADC_RATE, through a
+// CIC decimator of the given order. A ratio of 1 is the plain chain of
+// procInit(). Returns false, and sets up the plain chain, if cicInit() does
+// not take the ratio and order.
+//
+bool procInitRate(uint8_t ratio, uint8_t order) {
+  procFilterInit(&procFilter, firCoeffsf32, TAPS);
+#ifdef PROC_CHAIN
+  chainInit(&procChain);
+#endif
+  prevMean = 0;
+  aheadReady = false;
+  procRatio = 1;
+
+  if (ratio == 1) {
+    return true;
+  }
+
+  if (!cicInit(&procCic, order, ratio)) {
+    return false;
+  }
+
+  cicCompDesign(procCompCoeffs, order, ratio);
+  arm_fir_init_f32(&procComp, cicCompTaps, procCompCoeffs, procCompState,
+                   BLOCK_SIZE);
+
+  // The direct form filter is not used, its state is big enough for this one
+  arm_fir_decimate_init_f32(&procFinal, TAPS, procDecimation,
+                            (float32_t *) firCoeffsf32, procFilter.state,
+                            BLOCK_SIZE);
+  procRatio = ratio;
+
+  return true;
+}
+
+//
+// Reset the filter state for procSmall(), which runs the recording filter as
+// a polyphase decimator like the oversampled chain. It takes the state of the
+// direct form filter, so procBlock() needs a procInit() after it.
+//
+void procInitSmall(void) {
+  procInit();
+
+  arm_fir_decimate_init_f32(&procFinal, TAPS, procDecimation,
+                            (float32_t *) firCoeffsf32, procFilter.state,
+                            BLOCK_SIZE);
+}
+
+//
+// Filter and decimate the first n ADC samples of elem, a multiple of
+// BLOCK_SIZE up to half an element, into its first n / procDecimation
+// samples, which the DAC plays as they are. The decimator only computes the
+// outputs it keeps. Only the first scratch buffer is used.
+//
+void procSmall(elementT * elem, uint16_t n) {
+  float32_t * out = inputf32 + n;
+  uint16_t i;
+
+  convAdcToFloat(elem->data, inputf32, n);
+
+  for (i = 0; i < n; i += BLOCK_SIZE) {
+    arm_fir_decimate_f32(&procFinal, inputf32 + i, out + i / procDecimation,
+                         BLOCK_SIZE);
+  }
+
+  convFloatToInt(out, elem->data, n / procDecimation, 1, INT16_MAX);
+}
+
+//
+// Output samples procBlock() writes per element, procOutSize divided by the
+// oversampling ratio
+//
+uint16_t procOut(void) {
+  return procOutSize / procRatio;
+}
+
+//
+// Set up a filter instance for the given coefficients and clear its state.
+// Each instance keeps its own state, so several chains (e.g. threads of the
+// host batch tool) can run side by side. Returns false if the filter is too
+// long for the build.
+//
+bool procFilterInit(procFilterT * f, const float32_t * coeffs, uint16_t taps) {
+  f->fast = false;
+
+#ifdef PROC_OLS
+  if ((taps > PROC_MAX_TAPS) || (olsCost(taps) < olsFirCost(taps))) {
+    f->fast = olsInit(&f->ols, coeffs, taps, f->olsH, f->olsFrame);
+    return f->fast;
+  }
+#endif
+
+  if (taps > PROC_MAX_TAPS) {
+    return false;
+  }
+
+  arm_fir_init_f32(&f->fir, taps, (float32_t *) coeffs, &f->state[0],
+                   BLOCK_SIZE);
+  return true;
+}
+
+//
+// Filter elementSize centered samples already scaled by CONV_SCALE and
+// decimate them into procOutSize int16 samples. tmp holds elementSize floats
+// and may not overlap in.
+//
+void procFilterRun(procFilterT * f, const float32_t * in, float32_t * tmp,
+                   int16_t * out) {
+  uint16_t i;
+
+#ifdef PROC_OLS
+  if (f->fast) {
+    olsRun(&f->ols, in, tmp, out);
+    return;
+  }
+#endif
+
+  // Filter it and save to the temporary buffer
+  for (i = 0; i < LENGTH / BLOCK_SIZE; i++) {
+    arm_fir_f32(&f->fir, (float32_t *) in + (i * BLOCK_SIZE),
+                tmp + (i * BLOCK_SIZE), BLOCK_SIZE);
+  }
+
+  // Convert and copy the filtered output, saturating on overload
+  convFloatToInt(tmp, out, procOutSize, procDecimation, INT16_MAX);
+}
+
+//
+// An oversampled element through the three stages, BLOCK_SIZE samples at a
+// time at ADC_RATE. Each stage leaves its output in the other scratch buffer.
+// The samples come out scaled up by cicGainBits.
+//
+static void procBlockRate(elementT * elem, int16_t * out) {
+  uint16_t n = elementSize / procRatio; // Samples at ADC_RATE
+  uint16_t i;
+
+  cicRun(&procCic, elem->data, inputf32, elementSize);
+  elem->status = FREE;
+
+  for (i = 0; i < n; i += BLOCK_SIZE) {
+    arm_fir_f32(&procComp, inputf32 + i, outputf32 + i, BLOCK_SIZE);
+  }
+
+  for (i = 0; i < n; i += BLOCK_SIZE) {
+    arm_fir_decimate_f32(&procFinal, outputf32 + i,
+                         inputf32 + i / procDecimation, BLOCK_SIZE);
+  }
+
+  convFloatToInt(inputf32, out, n / procDecimation, 1,
+                 INT16_MAX * (1 << cicGainBits));
+}
+
+//
+// Process one ADC element: remove the offset, filter and decimate it into
+// procOut() samples at out. The element is set FREE once its data has been
+// consumed, its samples are not modified. If stat is not null, block
+// statistics for the activity detector are gathered in the same pass over the
+// samples; the oversampled chain leaves it alone.
+//
+void procBlock(elementT * elem, int16_t * out, procStatT * stat) {
+  uint16_t i;
+  int16_t x;
+  int32_t sum = 0;
+  uint32_t sumSq = 0;
+  uint16_t zeroCross = 0;
+  bool above, wasAbove;
+
+  if (procRatio > 1) {
+    procBlockRate(elem, out);
+    return;
+  }
+
+  if (stat) {
+    wasAbove = (elem->data[0] - CONV_ADC_OFFSET) > prevMean;
+
+    for (i = 0; i < elementSize; i++) {
+      // WAVE file format compatibility
+      x = elem->data[i] - CONV_ADC_OFFSET;
+
+      // Convert from int16 to f32 and copy to new array
+      inputf32[i] = (float32_t) x * CONV_SCALE;
+
+      sum += x;
+      sumSq += (uint32_t) (x * x);
+      above = x > prevMean;
+      zeroCross += (above != wasAbove);
+      wasAbove = above;
+    }
+
+    prevMean = (int16_t) (sum / elementSize);
+    stat->sum = sum;
+    stat->sumSq = sumSq;
+    stat->zeroCross = zeroCross;
+  }
+#ifdef PROC_CHAIN
+  chainRun(&procChain, elem->data, out);
+  elem->status = FREE;
+#else
+  else {
+    convAdcToFloat(elem->data, inputf32, elementSize);
+  }
+
+  // Update status of the element used
+  elem->status = FREE;
+
+  procFilterRun(&procFilter, inputf32, outputf32, out);
+#endif
+}
+
+//
+// Process the next element now, e.g. while waiting for the SD card, and keep
+// the output for procCollect(). Only one element is held, check
+// procAheadReady() before taking one out of the ring.
+//
+void procAhead(elementT * elem, bool stats) {
+  procBlock(elem, aheadOut, stats ? &aheadStat : 0);
+  aheadReady = true;
+}
+
+bool procAheadReady(void) {
+  return aheadReady;
+}
+
+//
+// Copy out the element processed by procAhead(), in place of a procBlock()
+// call on it
+//
+void procCollect(int16_t * out, procStatT * stat) {
+  memcpy(out, aheadOut, procOut() * sizeof(int16_t));
+  if (stat) {
+    *stat = aheadStat;
+  }
+
+  aheadReady = false;
+}
+
+//
+// The two elementSize float buffers of the chain hold nothing between two
+// procBlock() calls. Other users (e.g. the spectrum analyzer) may borrow them
+// there instead of keeping their own copies in RAM.
+//
+float * procScratch(uint8_t n) {
+  return n ? outputf32 : inputf32;
+}
@@ -0,0 +1,73 @@
+/*
+ * proc.h
+ * Per-block processing chain for recording (offset removal, FIR, decimation)
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef PROC_H_
+#define PROC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cirbuf.h"
+
+// CMSIS
+#include "arm_math.h"
+#include "fir_filter.h"
+#include "ols.h"
+
+// Longest filter procFilterInit() takes with the direct form FIR
+#ifndef PROC_MAX_TAPS
+#define PROC_MAX_TAPS TAPS
+#endif
+
+// Define PROC_OLS to let procFilterInit() switch to overlap-save convolution
+// when the cost model says it is cheaper, and to take filters of up to
+// olsMaxTaps. Its buffers take 2 * olsMaxFft floats, which the device does not
+// have to spare next to the ring, so it is off by default.
+
+// Define PROC_CHAIN to run the fused chain of chain.h, with the CHAIN_STAGES
+// picked at build time, in place of the conversion and the FIR. It reads the
+// ADC samples directly, so only the gated recording leaves its input in the
+// filter scratch for the spectrum analyzer.
+
+enum {
+  procDecimation = 4,
+  procOutSize = elementSize / procDecimation // Output samples per element
+};
+
+// Cheap block statistics gathered while converting the samples
+typedef struct {
+  int32_t sum;        // Sum of the centered samples
+  uint32_t sumSq;     // Sum of squares of the centered samples
+  uint16_t zeroCross; // Crossings of the previous block mean
+} procStatT;
+
+// State of one filter and decimation chain
+typedef struct {
+  bool fast; // Overlap-save engine in use
+  arm_fir_instance_f32 fir;
+  float32_t state[BLOCK_SIZE + PROC_MAX_TAPS - 1];
+#ifdef PROC_OLS
+  olsT ols;
+  float32_t olsH[olsMaxFft];
+  float32_t olsFrame[olsMaxFft];
+#endif
+} procFilterT;
+
+void procInit(void);
+bool procInitRate(uint8_t ratio, uint8_t order);
+void procInitSmall(void);
+void procSmall(elementT * elem, uint16_t n);
+uint16_t procOut(void);
+bool procFilterInit(procFilterT * f, const float32_t * coeffs, uint16_t taps);
+void procFilterRun(procFilterT * f, const float32_t * in, float32_t * tmp,
+                   int16_t * out);
+void procBlock(elementT * elem, int16_t * out, procStatT * stat);
+void procAhead(elementT * elem, bool stats);
+bool procAheadReady(void);
+void procCollect(int16_t * out, procStatT * stat);
+float * procScratch(uint8_t n);
+
+#endif /* PROC_H_ */
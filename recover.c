@@ -0,0 +1,156 @@
+/*
+ * recover.c
+ *
+ * FatFs writes the size of a file to its directory entry when the file is
+ * synced or closed. Cmd_nano syncs the WAV file and its index every
+ * recoverSyncBlocks blocks, so after a power loss the directory holds the
+ * recording up to the last sync, with the zero sizes of the first header.
+ *
+ * A recording in progress has RECOVER_MARK set in its directory entry, which
+ * FatFs keeps when it syncs. The recordings to recover are found by reading
+ * the directory alone. Each one costs its header sector and a few sectors at
+ * the end of its index, however long it is: the WAV data is cut after its
+ * last whole block, the header gets the sizes, the index loses the entries
+ * past the data and the recording goes into DIRIDX_NAME.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "recover.h"
+#include "format.h"
+#include "tsidx.h"
+#include "dirlist.h"
+#include "utils/uartstdio.h"
+
+//
+// Mark the recording at path as in progress, or clear the mark once it is
+// complete
+//
+FRESULT recoverMark(const char * path, bool mark) {
+  return f_chmod(path, mark ? RECOVER_MARK : 0, RECOVER_MARK);
+}
+
+//
+// Check the header of the WAV file at path against its size, and fix it. A
+// marked file is a recording cut off and ends with its last whole block
+// afterwards; any other file only gets the sizes in its header. sector is a
+// buffer of WAV_HEADER_SIZE bytes.
+//
+FRESULT recoverFile(FIL * fp, const char * path, bool marked, uint8_t * sector,
+                    recoverStatT * st) {
+  uint32_t size, offset, dataSize, data;
+  bool fresh;
+  FRESULT res;
+  UINT n;
+
+  res = f_open(fp, path, FA_READ | FA_WRITE);
+  if (res != FR_OK) {
+    return res;
+  }
+
+  size = f_size(fp);
+  memset(sector, 0, WAV_HEADER_SIZE);
+  res = f_read(fp, sector, WAV_HEADER_SIZE, &n);
+  st->checked++;
+
+  // A recording that lost its header gets a new one
+  offset = (res == FR_OK) ? wavDataOffset(sector, n, &dataSize) : 0;
+  fresh = !offset;
+  if (fresh) {
+    if (!marked) {
+      f_close(fp);
+      return res;
+    }
+    offset = WAV_HEADER_SIZE;
+    dataSize = 0;
+  }
+
+  data = (size > offset) ? size - offset : 0;
+  if (marked) {
+    data -= data % recoverBlockBytes;
+  }
+
+  if ((res == FR_OK) && (marked || (dataSize != data))) {
+    if (size > offset + data) {
+      res = f_lseek(fp, offset + data);
+      if (res == FR_OK) {
+        res = f_truncate(fp);
+      }
+      st->cut += size - offset - data;
+    }
+
+    if (fresh) {
+      wavHeaderFill(sector, data);
+    }
+    else {
+      wavHeaderPatch(sector, offset, data);
+    }
+
+    if (res == FR_OK) {
+      res = f_lseek(fp, 0);
+    }
+    if (res == FR_OK) {
+      res = f_write(fp, sector, fresh ? WAV_HEADER_SIZE : offset, &n);
+    }
+
+    st->fixed++;
+    UARTprintf("fixed %s: %u bytes of samples\n", path, data);
+  }
+
+  f_close(fp);
+
+  if ((res == FR_OK) && marked) {
+    res = tsRecover(fp, path, offset + data);
+  }
+  if ((res == FR_OK) && marked) {
+    res = dirIndexAdd(fp, path, offset + data);
+  }
+  if ((res == FR_OK) && marked) {
+    res = recoverMark(path, false);
+  }
+
+  return res;
+}
+
+//
+// Recover the marked recordings in the directory at path, and with all set
+// check the header of every other WAV file too
+//
+FRESULT recoverDir(DIR * dir, FILINFO * info, FIL * fp, const char * path,
+                   bool all, uint8_t * sector, recoverStatT * st) {
+  char name[80];
+  uint32_t len = strcmp(path, "/") ? strlen(path) : 0;
+  bool marked;
+  FRESULT res;
+
+  memset(st, 0, sizeof(*st));
+
+  res = f_opendir(dir, path);
+  while (res == FR_OK) {
+    res = f_readdir(dir, info);
+    if ((res != FR_OK) || !info->fname[0]) {
+      break;
+    }
+
+    if ((info->fattrib & AM_DIR) || !dirMatch("*.WAV", info->fname)) {
+      continue;
+    }
+
+    st->files++;
+    marked = (info->fattrib & RECOVER_MARK) != 0;
+    if (!marked && !all) {
+      continue;
+    }
+
+    if (len + 1 + strlen(info->fname) + sizeof(TSIDX_EXT) > sizeof(name)) {
+      return FR_INVALID_NAME;
+    }
+    memcpy(name, path, len);
+    name[len] = '/';
+    strcpy(name + len + 1, info->fname);
+
+    res = recoverFile(fp, name, marked, sector, st);
+  }
+
+  return res;
+}
@@ -0,0 +1,37 @@
+/*
+ * recover.h
+ * Recovery of the recordings a reset or a power loss cut off
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef RECOVER_H_
+#define RECOVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/src/ff.h"
+#include "cirbuf.h"
+
+// Attribute of the directory entry of a recording in progress
+#define RECOVER_MARK AM_SYS
+
+enum {
+  recoverBlockBytes = elementSize * 2, // WAV bytes per block
+  recoverSyncBlocks = 16               // Blocks a power loss may lose, ~1s
+};
+
+typedef struct {
+  uint32_t files;   // WAV files in the directory
+  uint32_t checked; // Headers read
+  uint32_t fixed;
+  uint32_t cut;     // Bytes cut off the ends of the files fixed
+} recoverStatT;
+
+FRESULT recoverMark(const char * path, bool mark);
+FRESULT recoverFile(FIL * fp, const char * path, bool marked, uint8_t * sector,
+                    recoverStatT * st);
+FRESULT recoverDir(DIR * dir, FILINFO * info, FIL * fp, const char * path,
+                   bool all, uint8_t * sector, recoverStatT * st);
+
+#endif /* RECOVER_H_ */
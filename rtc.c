@@ -0,0 +1,191 @@
+/*
+ * rtc.c
+ *
+ * The RTC of the hibernation module counts seconds from the 32.768kHz crystal
+ * of the LaunchPad, and keeps counting through a reset, or with a battery on
+ * VBAT through a power loss as well. It holds seconds from rtcEpochYear, which
+ * are turned into the calendar time here.
+ *
+ * A word of the battery backed memory of the module tells whether the counter
+ * was set. Until it is, rtcGet() fails and files get RTC_FALLBACK_YEAR-01-01
+ * 00:00, so their dates do not mean anything and the date filter and sort of
+ * "ls" only see the order in which they were written.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <ctype.h>
+#include "rtc.h"
+#include "global.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/hibernate.h"
+#include "driverlib/sysctl.h"
+
+// In the first word of the battery backed memory once the counter is set
+#define RTC_MAGIC 0x52544331 // "RTC1"
+
+static const uint8_t rtcMonthDays[12] = {
+  31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+static bool rtcLeap(uint16_t year) {
+  return !(year % 4) && ((year % 100) || !(year % 400));
+}
+
+static uint8_t rtcDays(uint16_t year, uint8_t month) {
+  return rtcMonthDays[month - 1] + ((month == 2) && rtcLeap(year));
+}
+
+//
+// Start the module clock, and the RTC if the module was off. It keeps the
+// count it had when it was running already.
+//
+void rtcInit(void) {
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_HIBERNATE);
+  while (!SysCtlPeripheralReady(SYSCTL_PERIPH_HIBERNATE)) {
+  }
+
+  HibernateEnableExpClk(SYS_CLK);
+
+  if (!HibernateIsActive()) {
+    HibernateClockConfig(HIBERNATE_OSC_LOWDRIVE);
+    HibernateRTCEnable();
+  }
+}
+
+bool rtcValid(void) {
+  uint32_t magic;
+
+  HibernateDataGet(&magic, 1);
+
+  return magic == RTC_MAGIC;
+}
+
+// The number in the n digits at s, or -1
+static int32_t rtcDigits(const char * s, uint8_t n) {
+  int32_t v = 0;
+
+  while (n--) {
+    if (!isdigit((uint8_t) *s)) {
+      return -1;
+    }
+    v = v * 10 + (*s++ - '0');
+  }
+
+  return v;
+}
+
+//
+// Read date as YYYYMMDD and time as HHMMSS, time 0 for midnight. False when
+// either is out of range.
+//
+bool rtcParse(const char * date, const char * time, rtcTimeT * t) {
+  int32_t year = rtcDigits(date, 4);
+  int32_t month = rtcDigits(date + 4, 2);
+  int32_t day = rtcDigits(date + 6, 2);
+  int32_t hour, minute, second;
+
+  if ((year < rtcEpochYear) || (year > rtcMaxYear) || (month < 1) ||
+      (month > 12) || (day < 1) || (day > rtcDays(year, month)) ||
+      date[8]) {
+    return false;
+  }
+
+  t->year = year;
+  t->month = month;
+  t->day = day;
+  t->hour = 0;
+  t->minute = 0;
+  t->second = 0;
+
+  if (!time) {
+    return true;
+  }
+
+  hour = rtcDigits(time, 2);
+  minute = rtcDigits(time + 2, 2);
+  second = rtcDigits(time + 4, 2);
+
+  if ((hour < 0) || (hour > 23) || (minute < 0) || (minute > 59) ||
+      (second < 0) || (second > 59) || time[6]) {
+    return false;
+  }
+
+  t->hour = hour;
+  t->minute = minute;
+  t->second = second;
+
+  return true;
+}
+
+//
+// Set the counter to t, a time rtcParse() accepts, and mark it valid
+//
+void rtcSet(const rtcTimeT * t) {
+  uint32_t days = 0;
+  uint32_t magic = RTC_MAGIC;
+  uint16_t y;
+  uint8_t m;
+
+  for (y = rtcEpochYear; y < t->year; y++) {
+    days += rtcLeap(y) ? 366 : 365;
+  }
+  for (m = 1; m < t->month; m++) {
+    days += rtcDays(t->year, m);
+  }
+  days += t->day - 1;
+
+  HibernateRTCSet(days * 86400 + t->hour * 3600 + t->minute * 60 + t->second);
+  HibernateDataSet(&magic, 1);
+}
+
+//
+// The time now. False, with t untouched, while the counter was never set.
+//
+bool rtcGet(rtcTimeT * t) {
+  uint32_t sec;
+  uint32_t days;
+  uint16_t y = rtcEpochYear;
+  uint8_t m = 1;
+
+  if (!rtcValid()) {
+    return false;
+  }
+
+  sec = HibernateRTCGet();
+  days = sec / 86400;
+  sec %= 86400;
+
+  while (days >= (rtcLeap(y) ? 366u : 365u)) {
+    days -= rtcLeap(y) ? 366 : 365;
+    y++;
+  }
+  while (days >= rtcDays(y, m)) {
+    days -= rtcDays(y, m);
+    m++;
+  }
+
+  t->year = y;
+  t->month = m;
+  t->day = days + 1;
+  t->hour = sec / 3600;
+  t->minute = sec / 60 % 60;
+  t->second = sec % 60;
+
+  return true;
+}
+
+//
+// The time now packed as get_fattime() returns it, RTC_FALLBACK_YEAR-01-01
+// 00:00 while the counter was never set
+//
+uint32_t rtcFatTime(void) {
+  rtcTimeT t;
+
+  if (!rtcGet(&t) || (t.year > rtcMaxYear)) {
+    return ((RTC_FALLBACK_YEAR - 1980UL) << 25) | (1UL << 21) | (1UL << 16);
+  }
+
+  return ((t.year - 1980UL) << 25) | ((uint32_t) t.month << 21) |
+         ((uint32_t) t.day << 16) | ((uint32_t) t.hour << 11) |
+         ((uint32_t) t.minute << 5) | (t.second / 2);
+}
@@ -0,0 +1,38 @@
+/*
+ * rtc.h
+ * Calendar time from the RTC of the hibernation module, for file timestamps
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef RTC_H_
+#define RTC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Date files get while the clock is not set, as before there was one
+#define RTC_FALLBACK_YEAR 2014
+
+enum {
+  rtcEpochYear = 2000, // The counter holds seconds from its first day
+  rtcMaxYear = 2107    // Last year of a FAT date
+};
+
+typedef struct {
+  uint16_t year;
+  uint8_t month;  // 1 to 12
+  uint8_t day;    // 1 to 31
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+} rtcTimeT;
+
+void rtcInit(void);
+bool rtcValid(void);
+bool rtcParse(const char * date, const char * time, rtcTimeT * t);
+void rtcSet(const rtcTimeT * t);
+bool rtcGet(rtcTimeT * t);
+uint32_t rtcFatTime(void);
+
+#endif /* RTC_H_ */
@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
@@ -47,10 +48,31 @@
 #include "cirbuf.h"
 #include "format.h"
 #include "dac.h"
-
-// CMSIS
-#include "arm_math.h"
-#include "fir_filter.h"
+#include "proc.h"
+#include "vad.h"
+#include "spectrum.h"
+#include "bench.h"
+#include "eval.h"
+#include "perf.h"
+#include "conv.h"
+#include "capture.h"
+#include "tsidx.h"
+#include "mmc_dma.h"
+#include "space.h"
+#include "dirlist.h"
+#include "boot.h"
+#include "recover.h"
+#include "cic.h"
+#include "irq.h"
+#include "mem.h"
+#include "mix.h"
+#include "play.h"
+#include "mon.h"
+#include "rtc.h"
+
+#ifdef RAM_CODE
+#pragma CODE_SECTION(adcInterruptHandler, ".ramfunc")
+#endif
 
 #define _CAT
 
@@ -86,6 +108,8 @@ volatile bufT adcBuf;
 volatile bufT * gpBuf;
 volatile elementT * pingPtr;
 volatile elementT * pongPtr;
+uint32_t acqChannel;  // Ping-pong channel, ADC3 or Timer3A in burst mode
+void * acqFifo;       // Sequencer FIFO it reads
 volatile bool bufferOverflow = false;
 volatile bool stop;
 volatile uint8_t testCount = 0;
@@ -106,6 +130,7 @@ uint8_t controlTable[1024];
 //*****************************************************************************
 volatile uint32_t uDMAErrorCounter = 0;
 volatile uint8_t sysTickTest = 0;
+volatile uint32_t sysTickCount = 0; // 10ms ticks since reset
 // TEST VARIABLES
 volatile uint32_t doneTimes = 0;
 
@@ -139,8 +164,11 @@ void acqConfig(void) {
     SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
 
 
-    // Prevent hardfault because of clock instability.
-    SysCtlDelay(100000);
+    // Prevent hardfault because of clock instability. The clocks take a few
+    // cycles to start, so wait for them instead of a fixed delay.
+    while (!SysCtlPeripheralReady(SYSCTL_PERIPH_ADC0) ||
+           !SysCtlPeripheralReady(SYSCTL_PERIPH_GPIOE)) {
+    }
 
     // Enable ADC channel
     GPIOPinTypeADC(GPIO_PORTE_BASE, GPIO_PIN_3); // CH0
@@ -152,6 +180,7 @@ void acqConfig(void) {
 
     // Allow DMA channel request upon ADC completion.
     ADCSequenceDMAEnable(ADC0_BASE, 3);
+    ADCSequenceOverflowClear(ADC0_BASE, 3);
 
 
 
@@ -173,27 +202,41 @@ void acqConfig(void) {
                                 UDMA_ATTR_ALTSELECT | UDMA_ATTR_HIGH_PRIORITY |
                                 UDMA_ATTR_REQMASK);
 
-    // Config option for uDMA channels
-    uDMAChannelControlSet(UDMA_CHANNEL_ADC3 | UDMA_PRI_SELECT,
-                          UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16 |
-                          UDMA_ARB_1);
-    uDMAChannelControlSet(UDMA_CHANNEL_ADC3 | UDMA_ALT_SELECT,
-                          UDMA_SIZE_16 | UDMA_SRC_INC_NONE | UDMA_DST_INC_16 |
-                          UDMA_ARB_1);
+    if (capScatter) {
+      // Task lists over several elements, one interrupt per list
+      capStart(gpBuf, controlTable);
+    }
+    else {
+      if (capBurst) {
+        // SS0 samples, Timer3 requests capBurstSize of them at a time
+        capBurstConfig();
+        acqChannel = CAP_BURST_DMA;
+        acqFifo = (void *) (ADC0_BASE + ADC_O_SSFIFO0);
+      }
+      else {
+        // Config option for uDMA channels
+        uDMAChannelControlSet(UDMA_CHANNEL_ADC3 | UDMA_PRI_SELECT,
+                              UDMA_SIZE_16 | UDMA_SRC_INC_NONE |
+                              UDMA_DST_INC_16 | UDMA_ARB_1);
+        uDMAChannelControlSet(UDMA_CHANNEL_ADC3 | UDMA_ALT_SELECT,
+                              UDMA_SIZE_16 | UDMA_SRC_INC_NONE |
+                              UDMA_DST_INC_16 | UDMA_ARB_1);
+        acqChannel = UDMA_CHANNEL_ADC3;
+        acqFifo = (void *) (ADC0_BASE + ADC_O_SSFIFO3);
+      }
 
-    // Transfer setting for first pair of transfer.
-    pingPtr = bufGetFree(gpBuf);
-    pongPtr = bufGetFree(gpBuf);
-    uDMAChannelTransferSet(UDMA_CHANNEL_ADC3 | UDMA_PRI_SELECT,
-                          UDMA_MODE_PINGPONG,
-                          (void *) (ADC0_BASE + ADC_O_SSFIFO3),
-                          (void *) pingPtr->data,
-                          ELEMENT_SIZE);
-    uDMAChannelTransferSet(UDMA_CHANNEL_ADC3 | UDMA_ALT_SELECT,
-                          UDMA_MODE_PINGPONG,
-                          (void *) (ADC0_BASE + ADC_O_SSFIFO3),
-                          (void *) pongPtr->data,
-                          ELEMENT_SIZE);
+      // Transfer setting for first pair of transfer.
+      pingPtr = bufGetFree(gpBuf);
+      pongPtr = bufGetFree(gpBuf);
+      uDMAChannelTransferSet(acqChannel | UDMA_PRI_SELECT,
+                            UDMA_MODE_PINGPONG, acqFifo,
+                            (void *) pingPtr->data,
+                            capSize);
+      uDMAChannelTransferSet(acqChannel | UDMA_ALT_SELECT,
+                            UDMA_MODE_PINGPONG, acqFifo,
+                            (void *) pongPtr->data,
+                            capSize);
+    }
 
     // TIMER 0 configuration
     // Clock the TIMER 0
@@ -203,18 +246,27 @@ void acqConfig(void) {
     TimerConfigure(TIMER0_BASE, TIMER_CFG_PERIODIC);
 
     // Set timer to trigger ADC at rate 8000Hz
-    TimerLoadSet(TIMER0_BASE, TIMER_A, SYS_CLK/32000); // 32ksps
+    TimerLoadSet(TIMER0_BASE, TIMER_A, SYS_CLK/capRate); // 32ksps
 
     // Trigger ADC using timer
     TimerControlTrigger(TIMER0_BASE, TIMER_A, 1);
 
     // Enable interrupt
-    IntEnable(INT_ADC0SS3);
+    if (!capScatter && !capBurst) {
+      IntEnable(INT_ADC0SS3);
+    }
     IntEnable(INT_UDMAERR); // uDMA error
+    perfStatReset(&capIsrPerf);
 
     // Enable ADC & uDMA
-    ADCSequenceEnable(ADC0_BASE, 3);
-    uDMAChannelEnable(UDMA_CHANNEL_ADC3); // Enable uDMA channel for operation
+    if (capBurst) {
+      ADCSequenceEnable(ADC0_BASE, 0);
+      uDMAChannelEnable(CAP_BURST_DMA);
+    }
+    else {
+      ADCSequenceEnable(ADC0_BASE, 3);
+      uDMAChannelEnable(UDMA_CHANNEL_ADC3); // Enable uDMA channel for operation
+    }
 }
 
 //*****************************************************************************
@@ -226,15 +278,32 @@ void acqConfig(void) {
 void adcInterruptHandler(void)
 {
   uint32_t mode;
+  uint32_t start = perfNow();
+
+  // Burst mode takes the transfer done interrupt on the Timer3A vector
+  if (capBurst) {
+    TimerIntClear(TIMER3_BASE, TIMER_TIMA_TIMEOUT);
+  }
+  else {
+    ADCIntClear(ADC0_BASE, 3);
+  }
 
-  ADCIntClear(ADC0_BASE, 3);
+  // Latency from the conversion trigger of the last sample of the element
+  if (irqMeasure) {
+    irqStamp(&irqCapture, start,
+             SYS_CLK/capRate - TimerValueGet(TIMER0_BASE, TIMER_A),
+             capSize * (SYS_CLK/capRate + 1));
+  }
 
   // Check if the PING buffer is full
-  mode = uDMAChannelModeGet(UDMA_CHANNEL_ADC3 | UDMA_PRI_SELECT);
+  mode = uDMAChannelModeGet(acqChannel | UDMA_PRI_SELECT);
 
   // Data was received complete into PING buffer. So the controller is transfer
   // using PONG buffer.
   if (mode == UDMA_MODE_STOP) {
+    pingPtr->stamp = start;
+    pingPtr->tick = sysTickCount;
+
     // Set the buffer elment status to FREE
     bufItemSetFree(gpBuf, pingPtr->index);
 
@@ -242,11 +311,10 @@ void adcInterruptHandler(void)
     pingPtr = bufGetFree(gpBuf);
     if (pingPtr) {
       // Setup new transfer
-      uDMAChannelTransferSet(UDMA_CHANNEL_ADC3 | UDMA_PRI_SELECT,
-                              UDMA_MODE_PINGPONG,
-                              (void *) (ADC0_BASE + ADC_O_SSFIFO3),
+      uDMAChannelTransferSet(acqChannel | UDMA_PRI_SELECT,
+                              UDMA_MODE_PINGPONG, acqFifo,
                               (void *) pingPtr->data,
-                              BUFFER_SIZE);
+                              capSize);
     }
     else {
       bufferOverflow = true;
@@ -260,20 +328,21 @@ void adcInterruptHandler(void)
   }
 
   // Check if PONG transfer is completed
-  mode = uDMAChannelModeGet(UDMA_CHANNEL_ADC3 | UDMA_ALT_SELECT);
+  mode = uDMAChannelModeGet(acqChannel | UDMA_ALT_SELECT);
 
   // Data was received complete into PONG buffer.
   if (mode == UDMA_MODE_STOP) {
+    pongPtr->stamp = start;
+    pongPtr->tick = sysTickCount;
     bufItemSetFree(gpBuf, pongPtr->index);
 
     pongPtr = bufGetFree(gpBuf);
 
     if (pongPtr) {
-      uDMAChannelTransferSet(UDMA_CHANNEL_ADC3 | UDMA_ALT_SELECT,
-                              UDMA_MODE_PINGPONG,
-                              (void *) (ADC0_BASE + ADC_O_SSFIFO3),
+      uDMAChannelTransferSet(acqChannel | UDMA_ALT_SELECT,
+                              UDMA_MODE_PINGPONG, acqFifo,
                               (void *) pongPtr->data,
-                              BUFFER_SIZE);
+                              capSize);
     }
     else {
       bufferOverflow = true;
@@ -287,6 +356,7 @@ void adcInterruptHandler(void)
 
   doneTimes++;
 
+  perfStatAdd(&capIsrPerf, perfNow() - start);
 }
 
 //****************************************************************************
@@ -366,6 +436,14 @@ static DIR g_sDirObject;
 static FILINFO g_sFileInfo;
 static FIL g_sFileObject;
 
+//*****************************************************************************
+//
+// The files the "mix" command plays over the one in g_sFileObject.  "play"
+// takes the first for the next file and the second for its playlist.
+//
+//*****************************************************************************
+static FIL g_psMixFiles[mixMaxStreams - 1];
+
 //*****************************************************************************
 //
 // A structure that holds a mapping between an FRESULT numerical code, and a
@@ -394,7 +472,7 @@ tFResultString;
 // the console.
 //
 //*****************************************************************************
-tFResultString g_psFResultStrings[] =
+const tFResultString g_psFResultStrings[] =
 {
     FRESULT_ENTRY(FR_OK),
     FRESULT_ENTRY(FR_DISK_ERR),
@@ -481,6 +559,7 @@ SysTickHandler(void)
     // Call the FatFs tick timer.
     //
     disk_timerproc();
+    sysTickCount++;
     sysTickTest++;
     if (sysTickTest == 2 ) {
       GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_2, (GPIOPinRead(GPIO_PORTF_BASE, GPIO_PIN_2) ^ GPIO_PIN_2));
@@ -489,6 +568,75 @@ SysTickHandler(void)
     }
 }
 
+//
+// ls with options, a page at a time: "match PATTERN", "date YYYYMMDD" or
+// "date YYYYMMDD-YYYYMMDD", "sort name" or "sort date", "page N", "size N",
+// and "recent" for the newest recordings out of the index nano keeps
+//
+static int
+lsQuery(int argc, char *argv[])
+{
+  dirQueryT q;
+  char * dash;
+  int i;
+
+  memset(&q, 0, sizeof(q));
+  q.size = 20;
+
+  // The filters are idle, their scratch holds a sorted page
+  q.arena = (dirEntryT *) procScratch(0);
+  q.arenaSize = elementSize * sizeof(float) / sizeof(dirEntryT);
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "recent")) {
+      q.recent = true;
+      continue;
+    }
+
+    if (i + 1 == argc) {
+      UARTprintf("Missing value for %s\n", argv[i]);
+      return(0);
+    }
+
+    if (!strcmp(argv[i], "match")) {
+      q.match = argv[++i];
+    }
+    else if (!strcmp(argv[i], "date")) {
+      i++;
+      dash = strchr(argv[i], '-');
+      q.dateLo = dirDate(argv[i]);
+      q.dateHi = dash ? dirDate(dash + 1) : q.dateLo;
+      if (!q.dateLo || !q.dateHi) {
+        UARTprintf("Dates are YYYYMMDD\n");
+        return(0);
+      }
+    }
+    else if (!strcmp(argv[i], "sort")) {
+      i++;
+      q.sort = !strcmp(argv[i], "date") ? dirSortDate : dirSortName;
+    }
+    else if (!strcmp(argv[i], "page")) {
+      q.page = (uint16_t) atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "size")) {
+      q.size = (uint16_t) atoi(argv[++i]);
+      if (!q.size) {
+        q.size = 1;
+      }
+    }
+    else {
+      UARTprintf("Unknown option %s\n", argv[i]);
+      return(0);
+    }
+  }
+
+  if (q.recent) {
+    return((int)dirRecent(&g_sFileObject, g_pcCwdBuf, &q));
+  }
+
+  return((int)dirList(&g_sDirObject, &g_sFileInfo, g_pcCwdBuf, &q));
+}
+
 //*****************************************************************************
 //
 // This function implements the "ls" command.  It opens the current directory
@@ -505,7 +653,7 @@ Cmd_ls(int argc, char *argv[])
     uint32_t ui32FileCount;
     uint32_t ui32DirCount;
     FRESULT iFResult;
-    FATFS *psFatFs;
+    spaceT sSpace;
     char *pcFileName;
 #if _USE_LFN
     char pucLfn[_MAX_LFN + 1];
@@ -513,6 +661,13 @@ Cmd_ls(int argc, char *argv[])
     g_sFileInfo.lfsize = sizeof(pucLfn);
 #endif
 
+    //
+    // Options list a page of the directory, or of the recording index.
+    //
+    if(argc > 1)
+    {
+        return(lsQuery(argc, argv));
+    }
 
     //
     // Open the current directory for access.
@@ -611,9 +766,9 @@ Cmd_ls(int argc, char *argv[])
                 ui32FileCount, ui32TotalSize, ui32DirCount);
 
     //
-    // Get the free space.
+    // Get the free space, kept by FatFs so this does not scan the FAT.
     //
-    iFResult = f_getfree("/", (DWORD *)&ui32TotalSize, &psFatFs);
+    iFResult = spaceGet(&sSpace);
 
     //
     // Check for error and return if there is a problem.
@@ -626,8 +781,7 @@ Cmd_ls(int argc, char *argv[])
     //
     // Display the amount of free space that was calculated.
     //
-    UARTprintf(", %10uK bytes free\n", (ui32TotalSize *
-                                        psFatFs->free_clust / 2));
+    UARTprintf(", %10uK bytes free\n", spaceFreeKB(&sSpace));
 
     //
     // Made it to here, return with no errors.
@@ -811,6 +965,16 @@ Cmd_pwd(int argc, char *argv[])
     return(0);
 }
 
+//
+// Disk layer calls since the command started. With the sample data sector
+// aligned in the file, each block is one call for all of its sectors.
+//
+static void diskStatPrint(void) {
+  UARTprintf("disk: %u reads of %u sectors, %u writes of %u sectors\n",
+             mmcStat.reads, mmcStat.readSectors, mmcStat.writes,
+             mmcStat.writeSectors);
+}
+
 //*****************************************************************************
 //
 // This function implements the "cat" command.  It reads the contents of a file
@@ -834,12 +998,13 @@ Cmd_cat(int argc, char *argv[])
     uint32_t filesize = 0;
     uint32_t numOfByteToRead;
 
-    uint8_t fmtHeader[80];
+    uint32_t offset;
 
     elementT * bufData;
     uint8_t i;
 
     stop = false;
+    memset(&mmcStat, 0, sizeof(mmcStat));
 
     bufInit(gpBuf);
 
@@ -890,27 +1055,30 @@ Cmd_cat(int argc, char *argv[])
     // 0. Read the file size
     filesize = f_size(&g_sFileObject);
 
-    // 1. Read the WAV file header
-    iFResult = f_read(&g_sFileObject, fmtHeader, 44, (UINT *)&ui32BytesRead);
+    // 1. Read the WAV file header, a whole sector, into a free element
+    bufData = bufGetFree(gpBuf);
+    iFResult = f_read(&g_sFileObject, bufData->data, WAV_HEADER_SIZE,
+                      (UINT *)&ui32BytesRead);
     if (iFResult != FR_OK) {
       return ((int) iFResult);
     }
 
-    subChunk2Size = ((uint32_t) fmtHeader[43] << 24) |
-                    ((uint32_t) fmtHeader[42] << 16) |
-                    ((uint32_t) fmtHeader[41] << 8) |
-                    (uint32_t) fmtHeader[40];
+    offset = wavDataOffset((uint8_t *) bufData->data, ui32BytesRead,
+                           &subChunk2Size);
+    if (!offset) {
+      UARTprintf("Not a WAV file\n");
+      return(0);
+    }
 
-    filesize -= 44; // Removed header
+    filesize -= offset; // Removed header
 
     // Seek to the location of the first sample data
-    iFResult = f_lseek(&g_sFileObject, 44);
+    iFResult = f_lseek(&g_sFileObject, offset);
     if (iFResult != FR_OK) {
       return ((int) iFResult);
     }
 
-    // Get a free buffer and preload first sector
-    bufData = bufGetFree(gpBuf);
+    // Preload first sector
     iFResult = f_read(&g_sFileObject, bufData->data, 1024, (UINT *)&ui32BytesRead);
     if (iFResult != FR_OK) {
       return ((int) iFResult);
@@ -952,15 +1120,423 @@ Cmd_cat(int argc, char *argv[])
 
     }
 
+    diskStatPrint();
+
     //
     // Return success.
     //
     return(0);
 }
 
+//
+// Full path of name in the current directory, into g_pcTmpBuf. False if it
+// does not fit.
+//
+static bool pathInCwd(const char * name) {
+  if (strlen(g_pcCwdBuf) + strlen(name) + 1 + 1 > sizeof(g_pcTmpBuf)) {
+    return false;
+  }
+
+  strcpy(g_pcTmpBuf, g_pcCwdBuf);
+  if (strcmp("/", g_pcCwdBuf)) {
+    strcat(g_pcTmpBuf, "/");
+  }
+  strcat(g_pcTmpBuf, name);
+
+  return true;
+}
+
+//
+// Open the WAV file name in the current directory and seek to its samples.
+// start and bytes get where they are. The header is read into the second
+// filter scratch, which playback leaves unused.
+//
+static FRESULT wavOpen(FIL * fp, const char * name, uint32_t * start,
+                       uint32_t * bytes) {
+  FRESULT res;
+
+  if (!pathInCwd(name)) {
+    return FR_INVALID_NAME;
+  }
+
+  res = playOpen(fp, g_pcTmpBuf, (uint8_t *) procScratch(1), start, bytes);
+  if (res == FR_INVALID_OBJECT) {
+    UARTprintf("%s: not a WAV file\n", name);
+  }
+
+  return res;
+}
+
+//
+// Read blocks of file fp into the ring of stream s while it has room, with
+// left bytes of samples to go
+//
+static FRESULT mixFeed(mixT * m, uint8_t s, FIL * fp, uint32_t * left) {
+  int16_t * block;
+  FRESULT res = FR_OK;
+  UINT n;
+
+  while (!m->stream[s].ended && (block = mixFree(m, s))) {
+    n = (*left < mixBlock * 2) ? *left : mixBlock * 2;
+
+    res = f_read(fp, block, n, &n);
+    if (res != FR_OK) {
+      mixPut(m, s, 0);
+      break;
+    }
+
+    *left -= n;
+    mixPut(m, s, n / 2);
+  }
+
+  return res;
+}
+
+//*****************************************************************************
+//
+// This function implements the "mix" command.  It plays the first WAV file
+// with the others mixed over it, each at its own gain in percent after a
+// colon, e.g. "mix music.wav beep.wav:50".  All files are opened and their
+// first blocks read before the output starts.  The key of a file number
+// starts the file, and plays it again from the start by seeking back in the
+// file still open; q stops.  The streams are mixed a block at a time into
+// the ring the DAC plays, at most mixAhead elements ahead of it.
+//
+//*****************************************************************************
+int
+Cmd_mix(int argc, char *argv[])
+{
+    FIL * files[mixMaxStreams];
+    uint32_t start[mixMaxStreams];
+    uint32_t bytes[mixMaxStreams];
+    uint32_t left[mixMaxStreams];
+    int16_t gain[mixMaxStreams];
+    bool fresh[mixMaxStreams];
+    mixT mix;
+    elementT * elem = 0;
+    uint16_t fill = 0;
+    uint8_t streams = argc - 1;
+    uint8_t s;
+    int32_t key, percent;
+    char * colon;
+    FRESULT iFResult = FR_OK;
+
+    if ((streams < 1) || (streams > mixMaxStreams)) {
+        UARTprintf("1 to %u files\n", mixMaxStreams);
+        return(0);
+    }
+
+    stop = false;
+    memset(&mmcStat, 0, sizeof(mmcStat));
+    bufInit(gpBuf);
+
+    // The stream rings take the first filter scratch
+    mixInit(&mix, (int16_t *) procScratch(0));
+
+    for (s = 0; s < streams; s++) {
+        files[s] = s ? &g_psMixFiles[s - 1] : &g_sFileObject;
+        gain[s] = mixUnity;
+
+        colon = strchr(argv[s + 1], ':');
+        if (colon) {
+            *colon = 0;
+            percent = atoi(colon + 1);
+            gain[s] = (percent * mixUnity / 100 > INT16_MAX) ?
+                      INT16_MAX : percent * mixUnity / 100;
+        }
+
+        iFResult = wavOpen(files[s], argv[s + 1], &start[s], &bytes[s]);
+        if (iFResult != FR_OK) {
+            streams = s;
+            break;
+        }
+
+        left[s] = bytes[s];
+        fresh[s] = true;
+        iFResult = mixFeed(&mix, s, files[s], &left[s]);
+        if (iFResult != FR_OK) {
+            streams = s + 1;
+            break;
+        }
+    }
+
+    if (iFResult == FR_OK) {
+        mixStart(&mix, 0, gain[0]);
+        fresh[0] = false;
+
+        dacIndex = 0;
+        dacBuf = 0;
+        dacEnable();
+    }
+
+    while (!stop && mixActive(&mix)) {
+        for (s = 0; s < streams; s++) {
+            iFResult = mixFeed(&mix, s, files[s], &left[s]);
+            if (iFResult != FR_OK) {
+                break;
+            }
+        }
+        if (iFResult != FR_OK) {
+            break;
+        }
+
+        // A block of each stream into the element being mixed
+        if (!elem && (gpBuf->count < mixAhead)) {
+            elem = bufGetFree(gpBuf);
+        }
+        if (elem) {
+            mixRun(&mix, elem->data + fill, mixBlock);
+            fill += mixBlock;
+
+            if (fill == elementSize) {
+                bufItemSetFree(gpBuf, elem->index);
+                elem = 0;
+                fill = 0;
+            }
+        }
+
+        key = UARTCharGetNonBlocking(UART0_BASE);
+        if (key == 'q') {
+            break;
+        }
+
+        // Start a stream, from the start again if it was played before
+        s = (uint8_t) (key - '0');
+        if ((key >= '0') && (s < streams)) {
+            if (!fresh[s]) {
+                mixFlush(&mix, s);
+                iFResult = f_lseek(files[s], start[s]);
+                left[s] = bytes[s];
+                if (iFResult == FR_OK) {
+                    iFResult = mixFeed(&mix, s, files[s], &left[s]);
+                }
+            }
+            fresh[s] = false;
+            mixStart(&mix, s, gain[s]);
+        }
+    }
+
+    // The last element mixed in part ends in silence
+    if (elem) {
+        memset(elem->data + fill, 0, (elementSize - fill) * sizeof(int16_t));
+        bufItemSetFree(gpBuf, elem->index);
+    }
+
+    // The DAC plays the elements left and stops
+    stop = true;
+
+    for (s = 0; s < streams; s++) {
+        f_close(files[s]);
+    }
+
+    UARTprintf("{\"streams\":%u,\"samples\":%u,\"starved\":[", streams,
+               mix.samples);
+    for (s = 0; s < streams; s++) {
+        UARTprintf("%s%u", s ? "," : "", mix.stream[s].starved);
+    }
+    UARTprintf("]}\n");
+
+    diskStatPrint();
+
+    return((int) iFResult);
+}
+
+//*****************************************************************************
+//
+// This function implements the "play" command.  It plays the WAV files named
+// in a playlist, one per line, or those matching a pattern in the current
+// directory, one after the other without a gap.  The next file is opened and
+// its first samples read while the ring is full, so the DAC goes from the
+// last sample of a file to the first of the next one with no silence, see
+// play.c.  q stops.
+//
+//*****************************************************************************
+int
+Cmd_play(int argc, char *argv[])
+{
+    FIL * files[2] = { &g_sFileObject, &g_psMixFiles[0] };
+    playT play;
+    FRESULT iFResult;
+
+    if (argc < 2) {
+        UARTprintf("play playlist|pattern\n");
+        return(0);
+    }
+
+    stop = false;
+    memset(&mmcStat, 0, sizeof(mmcStat));
+    bufInit(gpBuf);
+
+    // The start of the next file goes in the first filter scratch
+    iFResult = playInit(&play, argv[1], g_pcCwdBuf, files, &g_psMixFiles[1],
+                        &g_sDirObject, &g_sFileInfo,
+                        (uint8_t *) procScratch(0));
+
+    if (iFResult == FR_OK) {
+        dacIndex = 0;
+        dacBuf = 0;
+        dacEnable();
+    }
+
+    while ((iFResult == FR_OK) && !play.done) {
+        iFResult = playStep(&play, gpBuf);
+
+        if (UARTCharGetNonBlocking(UART0_BASE) == 'q') {
+            break;
+        }
+    }
+
+    // The DAC plays the elements left and stops
+    stop = true;
+    playClose(&play);
+
+    UARTprintf("{\"files\":%u,\"late\":%u,\"skipped\":%u,\"samples\":%u}\n",
+               play.files, play.late, play.skipped, play.samples);
+    diskStatPrint();
+
+    return((int) iFResult);
+}
+
+//
+// Whole blocks nano can still record: WAV data and index entries after their
+// headers, in two files
+//
+static uint32_t nanoBlocksFree(const spaceT * sp) {
+  return spaceBlocks(sp, WAV_HEADER_SIZE + sizeof(tsHeaderT),
+                     vadBlockSize * 2 + sizeof(tsEntryT), 2);
+}
+
+// Recording time of blocks output blocks
+static uint32_t nanoSeconds(uint32_t blocks) {
+  return (uint32_t) ((uint64_t) blocks * vadBlockSize * procDecimation /
+                     ADC_RATE);
+}
+
+//
+// Filters the next element while nano waits for the SD card. Its stamps are
+// kept for the index, the element itself is back in the ring by then.
+//
+static bool nanoStats;
+static uint32_t nanoStamp;
+static uint32_t nanoTick;
+static uint32_t nanoAhead; // Elements filtered during disk waits
+
+static void nanoIdle(void) {
+  elementT * elem;
+
+  if (procAheadReady()) {
+    return;
+  }
+
+  elem = bufGet(gpBuf);
+  if (elem) {
+    nanoStamp = elem->stamp;
+    nanoTick = elem->tick;
+    procAhead(elem, nanoStats);
+    nanoAhead++;
+  }
+}
+
+//
+// Filters the elements captured since reset into the block slots of the
+// detector while the card comes up and the file is opened. With the slots
+// full, elements are dropped so the ring does not overflow.
+//
+enum {
+  nanoBootElements = (vadPreBlocks + 1) * vadElements
+};
+
+static int16_t * nanoBootOut;
+static uint32_t nanoBootStamp[vadPreBlocks + 1];
+static uint32_t nanoBootTick[vadPreBlocks + 1];
+static uint32_t nanoBuffered; // Elements filtered into the slots
+static uint32_t nanoDropped;
+
+static void nanoBootIdle(void) {
+  elementT * elem;
+  uint8_t block = nanoBuffered / vadElements;
+
+  elem = bufGet(gpBuf);
+  if (!elem) {
+    return;
+  }
+
+  if (nanoBuffered == nanoBootElements) {
+    nanoDropped++;
+    bufItemSetFree(gpBuf, elem->index);
+    return;
+  }
+
+  if (nanoBuffered % vadElements == 0) {
+    nanoBootStamp[block] = elem->stamp;
+    nanoBootTick[block] = elem->tick;
+  }
+
+  procBlock(elem, nanoBootOut + nanoBuffered * procOutSize, 0);
+  nanoBuffered++;
+}
+
+//
+// How far nano got opening the recording at g_pcTmpBuf, which nanoAbort()
+// undoes
+//
+enum {
+  nanoNothing,   // Only the capture runs
+  nanoWavOpen,   // The WAV file is open
+  nanoMarked,    // and marked in progress
+  nanoIndexOpen  // and its index is open
+};
+
+//
+// Error exit of nano: stop the capture, close what is open and finish a
+// marked recording as far as it was written, the way a recovery after a
+// power loss does, so no handle stays open and no mark stays set. Returns
+// res.
+//
+static int nanoAbort(FRESULT res, uint8_t open, tsIdxT * ts, bool sg) {
+  recoverStatT st;
+
+  mmcIdle = 0;
+  capTimerDisable();
+  capBurst = false;
+  capRate = ADC_RATE;
+  if (sg) {
+    capStop();
+  }
+
+  if (open >= nanoIndexOpen) {
+    tsClose(ts);
+  }
+  if (open >= nanoWavOpen) {
+    f_close(&g_sFileObject);
+  }
+  if ((open >= nanoMarked) &&
+      (recoverFile(&g_sFileObject, g_pcTmpBuf, true,
+                   (uint8_t *) procScratch(0), &st) != FR_OK)) {
+    recoverMark(g_pcTmpBuf, false);
+  }
+
+  return ((int) res);
+}
+
 //*****************************************************************************
 // Mar 17, 2014. Modified "cat" for "nano" like command
 // Data buffer is filled with useless data
+//
+// Options after the file name:
+// "gate" only writes blocks with voice activity, plus a few blocks of
+// pre-trigger history and a hangover after each segment.
+// "spec" runs the spectrum analyzer on input blocks while recording, whenever
+// the ring is not backing up.  It does not go with "over".
+// "sg" captures with uDMA scatter-gather task lists, taking one interrupt per
+// capBlocks elements instead of one per element.
+// "boot" takes over the capture main started at reset. The file is named
+// after the index of the root directory, with the file name as prefix, and
+// the recording is not gated.
+// "over R" runs the ADC R times faster, R a power of two up to cicMaxRatio,
+// and decimates through a CIC filter of order cicOrder, or the one given with
+// "order N". The samples keep cicGainBits more bits. The recording is not
+// gated, and the ring lasts R times shorter through the card's write delays.
 //*****************************************************************************
 int
 Cmd_nano(int argc, char *argv[])
@@ -969,49 +1545,117 @@ Cmd_nano(int argc, char *argv[])
   UINT bw;
   uint32_t numOfSamples;
   uint32_t subChunk2Size; // Wave subchunksize data
-  uint32_t chunkSize;
   uint32_t count; // Number of elements to acquire
-
-  static uint8_t fmtHeader[80];
+  uint32_t written; // Number of blocks written to the disk
+  uint32_t synced = 0; // Blocks written at the last sync
+  uint32_t start;
+  bool gated = false;
+  bool spec = false;
+  bool sg = false;
+  bool burst = false;
+  bool boot = false;
+  uint8_t ratio = 1;
+  uint8_t order = cicOrder;
+
+  // The header is a sector, the filter scratch is free while it is written
+  uint8_t * fmtHeader = (uint8_t *) procScratch(0);
 
   static elementT * bufData;
+  bool ahead;
   uint16_t i;
-  uint8_t t;
+  uint16_t t;
+  uint8_t n;
+
+  static vadT vad;
+  static int16_t * blocks[vadPreBlocks + 1];
+  static tsIdxT ts;
+  uint32_t block;
+  spaceT space;
+  uint32_t limit; // Blocks that fit on the card
+  procStatT stat;
+  perfStatT procPerf;
+  perfStatT vadPerf;
+
+  for (i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "gate")) {
+      gated = true;
+    }
+    else if (!strcmp(argv[i], "spec")) {
+      spec = true;
+    }
+    else if (!strcmp(argv[i], "sg")) {
+      sg = true;
+    }
+    else if (!strcmp(argv[i], "burst")) {
+      burst = true;
+    }
+    else if (!strcmp(argv[i], "boot")) {
+      boot = true;
+    }
+    else if (!strcmp(argv[i], "over") && (i + 1 < argc)) {
+      ratio = strtoul(argv[++i], 0, 10);
+    }
+    else if (!strcmp(argv[i], "order") && (i + 1 < argc)) {
+      order = strtoul(argv[++i], 0, 10);
+    }
+  }
+
+  if (boot && !bootTime.sample) {
+    UARTprintf("No capture since reset\n");
+    return(0);
+  }
 
-  // Data filtering helper arrays
-  static float32_t inputf32[LENGTH]; // Filter inputs
-  static float32_t outputf32[LENGTH]; // Filter output
-  static float32_t firBufferf32[BLOCK_SIZE + TAPS - 1]; // Buffer state // todo fix
-  //static int16_t bufferOutputi16[2048];
-  static int16_t outputi16[LENGTH];
+  // The capture since reset runs at ADC_RATE, and the oversampled chain
+  // gathers no statistics for the detector
+  ratio = boot ? 1 : ratio;
+  gated = gated && !boot && (ratio == 1);
 
-  // Filter kernel structure
-  static arm_fir_instance_f32 s;
-  static uint32_t blocksize = BLOCK_SIZE;
-  uint8_t timesDone = 0;
-  uint8_t numOfBlocks = LENGTH/blocksize;
+  if (burst && (ADC_RATE * ratio > capBurstMaxRate)) {
+    UARTprintf("Rate out of range\n");
+    return(0);
+  }
 
-  static float32_t *input, *output;
-  input = inputf32;
-  output = outputf32;
+  // The analyzer takes elements at ADC_RATE, while the oversampled chain
+  // leaves its scratch at the CIC output rate
+  if (spec && (ratio > 1)) {
+    UARTprintf("spec does not run with over\n");
+    return(0);
+  }
 
   //
-  // FIR filter initialization
+  // Filter and detector initialization
   //
-  arm_fir_init_f32(&s, TAPS, (float32_t *) &firCoeffsf32[0], &firBufferf32[0], blocksize);
+  if (!procInitRate(ratio, order)) {
+    UARTprintf("Ratio or order out of range\n");
+    return(0);
+  }
+  vadInit(&vad);
+  perfStatReset(&procPerf);
+  perfStatReset(&vadPerf);
+  specInit(spec ? SPEC_NANO_BLOCKS : 0);
 
   // Stop action
   stop = false;
   count = 0;
-
-  // Copy header from format.h
-  for (i = 0; i < 44; i++) {
-    fmtHeader[i] = wavHeader[i];
-  };
-
-  // Init the buffer
-  bufInit(gpBuf);
-  acqConfig();
+  written = 0;
+  memset(&mmcStat, 0, sizeof(mmcStat));
+
+  if (boot) {
+    // Filter the ring into the block slots until the file is open
+    nanoBootOut = vadSlot(&vad);
+    nanoBuffered = 0;
+    nanoDropped = 0;
+    mmcIdle = nanoBootIdle;
+  }
+  else {
+    // Init the buffer
+    bufInit(gpBuf);
+    capScatter = sg;
+    capBurst = burst && !sg;
+    capRate = ADC_RATE * ratio;
+    acqConfig();
+    capScatter = false;
+  }
 
   // First, check to make sure that the current path (CWD), plus the file
   // name, plus a separator and trailing null, will all fit in the temporary
@@ -1020,7 +1664,7 @@ Cmd_nano(int argc, char *argv[])
   if(strlen(g_pcCwdBuf) + strlen(argv[1]) + 1 + 1 > sizeof(g_pcTmpBuf))
   {
       UARTprintf("Resulting path name is too long\n");
-      return(0);
+      return nanoAbort(FR_OK, nanoNothing, &ts, sg);
   }
 
   //
@@ -1040,75 +1684,191 @@ Cmd_nano(int argc, char *argv[])
   // Now finally, append the file name to result in a fully specified file.
   //
   strcat(g_pcTmpBuf, argv[1]);
+
+  // Check the recording fits, a gated one writes up to vadPreBlocks + 1
+  // blocks at once
+  iFResult = spaceGet(&space);
+  if(iFResult != FR_OK)
+  {
+      return nanoAbort(iFResult, nanoNothing, &ts, sg);
+  }
+
+  limit = nanoBlocksFree(&space);
+  UARTprintf("space: %uK bytes free, %u s of recording\n",
+             spaceFreeKB(&space), nanoSeconds(limit));
+
+  if (limit <= vadPreBlocks + 1) {
+    UARTprintf("Not enough space\n");
+    return nanoAbort(FR_DENIED, nanoNothing, &ts, sg);
+  }
+  limit -= vadPreBlocks + 1;
+
   //
   // Open the file for writing.
   //
-  iFResult = f_open(&g_sFileObject, g_pcTmpBuf, FA_WRITE | FA_OPEN_ALWAYS);
+  if (boot) {
+    iFResult = bootCreate(&g_sFileObject, &g_sFileObject, g_pcTmpBuf, argv[1]);
+  }
+  else {
+    iFResult = f_open(&g_sFileObject, g_pcTmpBuf, FA_WRITE | FA_CREATE_ALWAYS);
+  }
   //
   // If there was some problem opening the file, then return an error.
   //
   if(iFResult != FR_OK)
   {
-      return((int)iFResult);
+      return nanoAbort(iFResult, nanoNothing, &ts, sg);
   }
 
-  // Allocate space for WAV header
-  do {
-    iFResult = f_write(&g_sFileObject, fmtHeader, 44,
+  // Marked until it is complete, for a recovery after a power loss
+  iFResult = recoverMark(g_pcTmpBuf, true);
+  if(iFResult != FR_OK)
+  {
+      return nanoAbort(iFResult, nanoWavOpen, &ts, sg);
+  }
+
+  // Timestamp index next to the WAV file
+  iFResult = tsOpen(&ts, g_pcTmpBuf, ADC_RATE / procDecimation,
+                    elementSize * (SYS_CLK / capRate + 1) /
+                    (SYS_CLK / 1000000));
+  if(iFResult != FR_OK)
+  {
+      return nanoAbort(iFResult, nanoMarked, &ts, sg);
+  }
+
+  // Allocate space for WAV header. The header shares the scratch buffer
+  // with the filter, which must not run in the meantime.
+  mmcIdle = 0;
+  wavHeaderFill(fmtHeader, 0);
+  do {
+    iFResult = f_write(&g_sFileObject, fmtHeader, WAV_HEADER_SIZE,
                        (UINT *)&bw);
 
     if(iFResult != FR_OK)
     {
         UARTprintf("not ok\n");
-        return((int)iFResult);
+        return nanoAbort(iFResult, nanoIndexOpen, &ts, sg);
     }
   }
-  while (bw < 44);
+  while (bw < WAV_HEADER_SIZE);
+
+  // Filter ahead while the card is busy
+  nanoStats = gated;
+  nanoAhead = 0;
+  mmcIdle = nanoIdle;
+
+  if (boot) {
+    // Complete the last block in the slots, or the blocks dropped after
+    // them, so the recording goes on at a block boundary
+    while ((nanoBuffered + nanoDropped) % vadElements) {
+      nanoBootIdle();
+    }
 
-  // Enable timer for data acquisition
-  TimerEnable(TIMER0_BASE, TIMER_A);
+    // Write the blocks captured before the file was open
+    for (block = 0; block < nanoBuffered / vadElements; block++) {
+      tsStamp(&ts, block, nanoBootStamp[block], nanoBootTick[block]);
+
+      iFResult = tsAdd(&ts, block, WAV_HEADER_SIZE + written*elementSize*2);
+      if (iFResult == FR_OK) {
+        iFResult = f_write(&g_sFileObject, vad.hist[block], elementSize*2,
+                           (UINT *)&bw);
+      }
+      if (iFResult != FR_OK) {
+        return nanoAbort(iFResult, nanoIndexOpen, &ts, sg);
+      }
+
+      written++;
+    }
+
+    // Dropped blocks show up in the index as a gap
+    count = written + nanoDropped / vadElements;
+  }
+  else {
+    // Enable timer for data acquisition
+    capTimerEnable();
+  }
 
   // Check the buffer and write data to the disk
   while (!stop) {
     t = 0;
-    while (t < 4) {
-      bufData = bufGet(gpBuf);
+    while (t < vadBlockSize) {
+      // The next element may have been filtered during the last write
+      ahead = procAheadReady();
+      bufData = ahead ? 0 : bufGet(gpBuf);
 
       // If data available at the buffer, process it
-      if (bufData) {
-        // WAVE file format compatibility
-        for (i = 0; i < 512; i++) {
-          bufData->data[i] -= 2048;
-
-        // Convert from int16 to f32 and copy to new array
-        inputf32[i] = ((float32_t) (bufData->data[i]) / INT16_MAX);
+      if (ahead || bufData) {
+        // The block is stamped with the capture time of its first element
+        if (t == 0) {
+          tsStamp(&ts, gated ? vad.block : count,
+                  ahead ? nanoStamp : bufData->stamp,
+                  ahead ? nanoTick : bufData->tick);
         }
 
-        // Update status of the element used
-        bufData->status = FREE;
-
-        //UARTprintf("Begin filter!\n");
+        start = perfNow();
+        if (ahead) {
+          procCollect(vadSlot(&vad) + t, gated ? &stat : 0);
+        }
+        else {
+          procBlock(bufData, vadSlot(&vad) + t, gated ? &stat : 0);
+        }
+        perfStatAdd(&procPerf, perfNow() - start);
 
-        // Filter it and save to the temporary buffer
-        for (i = 0; i < numOfBlocks; i++) {
-          arm_fir_f32(&s, input + (i * blocksize), output + (i * blocksize),
-                     (uint32_t) blocksize);
+        if (gated) {
+          vadAccumulate(&vad, &stat);
         }
 
-        // Convert and copy the filtered output to the buffer array
-        for (i = 0; i < 128; i++) {
-          outputi16[t*128 + i] = outputf32[i * 4] * INT16_MAX;
+        // The filter input is still in the scratch buffers, analyze it if
+        // there is time for it
+        if (specWanted() && (gpBuf->count <= specMaxBacklog)) {
+          specFeed(procScratch(0), procScratch(1));
         }
 
-        t++;
+        t += procOut();
       }
     }
 
-    // Write data to the disk
-    iFResult = f_write(&g_sFileObject, outputi16, elementSize*2, (UINT *)&bw);
+    if (gated) {
+      start = perfNow();
+      n = vadUpdate(&vad, sysTickCount, blocks);
+      perfStatAdd(&vadPerf, perfNow() - start);
+    }
+    else {
+      blocks[0] = vadSlot(&vad);
+      n = 1;
+    }
 
-    if (iFResult != FR_OK) {
-      return ((int) iFResult);
+    // Write data to the disk. Blocks to write are consecutive and end with
+    // the one just processed.
+    for (t = 0; t < n; t++) {
+      block = gated ? vad.block - n + t : count;
+
+      iFResult = tsAdd(&ts, block, WAV_HEADER_SIZE + written*elementSize*2);
+      if (iFResult != FR_OK) {
+        return nanoAbort(iFResult, nanoIndexOpen, &ts, sg);
+      }
+
+      iFResult = f_write(&g_sFileObject, blocks[t], elementSize*2,
+                         (UINT *)&bw);
+
+      if (iFResult != FR_OK) {
+        return nanoAbort(iFResult, nanoIndexOpen, &ts, sg);
+      }
+
+      written++;
+    }
+
+    // Keep the directory entries up to date, which is what a recovery
+    // finds after a power loss
+    if (written - synced >= recoverSyncBlocks) {
+      iFResult = f_sync(&g_sFileObject);
+      if (iFResult == FR_OK) {
+        iFResult = tsSync(&ts);
+      }
+      if (iFResult != FR_OK) {
+        return nanoAbort(iFResult, nanoIndexOpen, &ts, sg);
+      }
+      synced = written;
     }
 
     count++;
@@ -1116,49 +1876,730 @@ Cmd_nano(int argc, char *argv[])
     if (count >= 2000) { // Stop token
       stop = true;
     }
+
+    if (written >= limit) {
+      UARTprintf("Card full\n");
+      stop = true;
+    }
   }
 
+  mmcIdle = 0;
+
   // Disable timer
-  TimerDisable(TIMER0_BASE, TIMER_A);
+  capTimerDisable();
+  capBurst = false;
+  capRate = ADC_RATE;
+  if (sg) {
+    capStop();
+  }
 
   // Calulate chunksizes
-  numOfSamples = count; // TODO This is temporary
+  numOfSamples = written; // TODO This is temporary
   subChunk2Size = numOfSamples * 2 * 512;
-  chunkSize  = subChunk2Size + 36;
-
-  // Modify header Chunk Size
-  fmtHeader[4] = (uint8_t) chunkSize;
-  fmtHeader[5] = (uint8_t) (chunkSize >> 8);
-  fmtHeader[6] = (uint8_t) (chunkSize >> 16);
-  fmtHeader[7] = (uint8_t) (chunkSize >> 24);
-
-  // Modify header Sub Chunk 2 Size
-  fmtHeader[40] = (uint8_t) subChunk2Size;
-  fmtHeader[41] = (uint8_t) (subChunk2Size >> 8);
-  fmtHeader[42] = (uint8_t) (subChunk2Size >> 16);
-  fmtHeader[43] = (uint8_t) (subChunk2Size >> 24);
+  wavHeaderFill(fmtHeader, subChunk2Size);
 
   // Seek to the first location of the file and write the wav header
   iFResult = f_lseek(&g_sFileObject, 0);
   if(iFResult != FR_OK)
   {
-      return((int)iFResult);
+      return nanoAbort(iFResult, nanoIndexOpen, &ts, sg);
   }
 
-  iFResult = f_write(&g_sFileObject, fmtHeader, 44, (UINT *)&bw);
+  iFResult = f_write(&g_sFileObject, fmtHeader, WAV_HEADER_SIZE, (UINT *)&bw);
 
   if (iFResult != FR_OK) {
-    return ((int) iFResult);
+    return nanoAbort(iFResult, nanoIndexOpen, &ts, sg);
   }
 
   f_close(&g_sFileObject);
 
+  iFResult = tsClose(&ts);
+  if (iFResult != FR_OK) {
+    return ((int) iFResult);
+  }
+
+  // Newest recordings are listed out of the index of the directory
+  iFResult = dirIndexAdd(&g_sFileObject, g_pcTmpBuf,
+                         WAV_HEADER_SIZE + written * elementSize * 2);
+  if (iFResult == FR_OK) {
+    iFResult = recoverMark(g_pcTmpBuf, false);
+  }
+  if (iFResult != FR_OK) {
+    return ((int) iFResult);
+  }
+
+  // Report the processing cost per ADC element, and of the capture interrupts
+  perfStatPrint("proc", &procPerf);
+  perfStatPrint("isr", &capIsrPerf);
+  UARTprintf("ahead: %u of %u elements filtered during disk waits\n",
+             nanoAhead, count * vadElements);
+  diskStatPrint();
+  tsPrint(&ts);
+  if (spaceGet(&space) == FR_OK) {
+    UARTprintf("space: %uK bytes free, %u s of recording\n",
+               spaceFreeKB(&space), nanoSeconds(nanoBlocksFree(&space)));
+  }
+  if (gated) {
+    perfStatPrint("vad", &vadPerf);
+    vadPrint(&vad);
+  }
+  if (spec) {
+    specPrint(ADC_RATE);
+  }
+  if (boot) {
+    bootPrint(nanoBuffered / vadElements, nanoDropped);
+  }
+
   //
   // Return success.
   //
   return(0);
 }
 
+//*****************************************************************************
+//
+// This function implements the "spectrum" command.  It captures ADC blocks and
+// prints the strongest peaks and band powers of their averaged spectrum.  An
+// optional argument sets the number of blocks to average.
+//
+//*****************************************************************************
+int
+Cmd_spectrum(int argc, char *argv[])
+{
+  elementT * bufData;
+  float * in;
+  uint16_t blocks = SPEC_DEFAULT_BLOCKS;
+
+  if (argc > 1) {
+    blocks = (uint16_t) strtoul(argv[1], 0, 10);
+  }
+
+  specInit(blocks);
+
+  // Init the buffer
+  bufInit(gpBuf);
+  acqConfig();
+
+  // Enable timer for data acquisition
+  TimerEnable(TIMER0_BASE, TIMER_A);
+
+  while (specWanted()) {
+    bufData = bufGet(gpBuf);
+
+    if (bufData) {
+      in = procScratch(0);
+      convAdcToFloat(bufData->data, in, elementSize);
+
+      bufItemSetFree(gpBuf, bufData->index);
+
+      specFeed(in, procScratch(1));
+    }
+  }
+
+  // Disable timer
+  TimerDisable(TIMER0_BASE, TIMER_A);
+
+  specPrint(ADC_RATE);
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "monitor" command.  It plays the input through
+// the recording filter as it comes in, in blocks of "block N" output samples,
+// a power of two from 8 to 64, instead of whole elements.  The DAC starts
+// once "lead N" blocks are filtered; more of them ride out longer stalls of
+// the loop, at a block of delay each.  "rec FILE" records what is played at
+// the same time.  q stops and prints the latency from the ADC to the PWM as
+// JSON, see mon.c.
+//
+//*****************************************************************************
+int
+Cmd_monitor(int argc, char *argv[])
+{
+  uint16_t block = monBlockDefault;
+  uint8_t lead = monLeadDefault;
+  char * name = 0;
+  uint8_t * header;
+  FRESULT iFResult = FR_OK;
+  UINT bw;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "block") && (i + 1 < argc)) {
+      block = (uint16_t) strtoul(argv[++i], 0, 10);
+    }
+    else if (!strcmp(argv[i], "lead") && (i + 1 < argc)) {
+      lead = (uint8_t) strtoul(argv[++i], 0, 10);
+    }
+    else if (!strcmp(argv[i], "rec") && (i + 1 < argc)) {
+      name = argv[++i];
+    }
+    else {
+      UARTprintf("Unknown option %s\n", argv[i]);
+      return(0);
+    }
+  }
+
+  if ((block < monBlockMin) || (block > monBlockMax) ||
+      (block & (block - 1))) {
+    UARTprintf("Block is a power of two from %u to %u\n", monBlockMin,
+               monBlockMax);
+    return(0);
+  }
+
+  if ((lead < 1) || (lead > monLeadMax)) {
+    UARTprintf("Lead is 1 to %u blocks\n", monLeadMax);
+    return(0);
+  }
+
+  // The monitor filters in the first scratch buffer, the recording and its
+  // header take the second
+  header = (uint8_t *) procScratch(1);
+
+  if (name) {
+    if (!pathInCwd(name)) {
+      UARTprintf("Resulting path name is too long\n");
+      return(0);
+    }
+
+    iFResult = f_open(&g_sFileObject, g_pcTmpBuf, FA_WRITE | FA_CREATE_ALWAYS);
+    if (iFResult == FR_OK) {
+      iFResult = recoverMark(g_pcTmpBuf, true);
+    }
+    if (iFResult == FR_OK) {
+      wavHeaderFill(header, 0);
+      iFResult = f_write(&g_sFileObject, header, WAV_HEADER_SIZE, &bw);
+    }
+    if (iFResult != FR_OK) {
+      return((int)iFResult);
+    }
+  }
+
+  // Ping-pong transfers of a block each
+  memset(&mmcStat, 0, sizeof(mmcStat));
+  bufInit(gpBuf);
+  capSize = block * procDecimation;
+  acqConfig();
+  monInit(block, name ? &g_sFileObject : 0, (int16_t *) header);
+
+  // Filter while the recording waits for the card
+  if (name) {
+    mmcIdle = monStep;
+  }
+
+  capTimerEnable();
+  while (monQueued() < lead) {
+    monStep();
+  }
+  monStart();
+
+  while (UARTCharGetNonBlocking(UART0_BASE) != 'q') {
+    monStep();
+
+    if (name) {
+      iFResult = monRecWrite(false);
+      if (iFResult != FR_OK) {
+        break;
+      }
+    }
+  }
+
+  mmcIdle = 0;
+  capTimerDisable();
+  monStop();
+  capSize = elementSize;
+
+  if (name) {
+    if (iFResult == FR_OK) {
+      iFResult = monRecWrite(true);
+    }
+    if (iFResult == FR_DENIED) {
+      UARTprintf("Card full\n");
+      iFResult = FR_OK;
+    }
+
+    // The buffer is written out, the header goes in its place
+    wavHeaderFill(header, monStat.recSamples * sizeof(int16_t));
+    if (iFResult == FR_OK) {
+      iFResult = f_lseek(&g_sFileObject, 0);
+    }
+    if (iFResult == FR_OK) {
+      iFResult = f_write(&g_sFileObject, header, WAV_HEADER_SIZE, &bw);
+    }
+    f_close(&g_sFileObject);
+
+    if (iFResult == FR_OK) {
+      iFResult = dirIndexAdd(&g_sFileObject, g_pcTmpBuf, WAV_HEADER_SIZE +
+                             monStat.recSamples * sizeof(int16_t));
+    }
+    if (iFResult == FR_OK) {
+      iFResult = recoverMark(g_pcTmpBuf, false);
+    }
+  }
+
+  monPrint(lead);
+  if (name) {
+    diskStatPrint();
+  }
+
+  return((int)iFResult);
+}
+
+//*****************************************************************************
+//
+// This function implements the "bench" command.  It times the buffer and DSP
+// kernels and prints the results as JSON.  An optional argument selects the
+// benchmarks whose name starts with it, "crossover" compares the direct FIR
+// with overlap-save convolution over a range of filter lengths instead, and
+// "rate" times the stages of the oversampled chain against the time an element
+// lasts at each ADC rate, and "mix" times the mixer for each number of streams.
+//
+//*****************************************************************************
+int
+Cmd_bench(int argc, char *argv[])
+{
+  if ((argc > 1) && !strcmp(argv[1], "crossover")) {
+    benchCrossover(gpBuf);
+    return(0);
+  }
+
+  if ((argc > 1) && !strcmp(argv[1], "rate")) {
+    benchRate(gpBuf);
+    return(0);
+  }
+
+  if ((argc > 1) && !strcmp(argv[1], "mix")) {
+    benchMix(gpBuf);
+    return(0);
+  }
+
+  benchRun(gpBuf, (argc > 1) ? argv[1] : 0);
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "fireval" command.  It compares all decimating
+// filter kernels for accuracy and speed.  Takes a few seconds.
+//
+//*****************************************************************************
+int
+Cmd_fireval(int argc, char *argv[])
+{
+  evalRun();
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "sdbench" command.  It writes a test file of
+// the given size in KB and reads it back, with uDMA block transfers or with
+// "poll" byte by byte, and prints the throughput and the CPU time per MB.
+// CPU time is what the driver did not leave to mmcIdle.
+//
+//*****************************************************************************
+int
+Cmd_sdbench(int argc, char *argv[])
+{
+  uint8_t * data = (uint8_t *) procScratch(0); // elementSize floats, 2KB
+  uint32_t chunk = elementSize * sizeof(float);
+  uint32_t kb = 256;
+  uint32_t total[2];
+  uint32_t busy[2];
+  uint32_t start;
+  uint32_t n;
+  int i;
+  uint8_t pass;
+  FRESULT iFResult;
+  UINT bw;
+
+  mmcUseDma = true;
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "poll")) {
+      mmcUseDma = false;
+    }
+    else {
+      kb = strtoul(argv[i], 0, 10);
+    }
+  }
+
+  // The cycle counter wraps after 53s
+  if ((kb < chunk / 1024) || (kb > 4096)) {
+    UARTprintf("Size out of range\n");
+    mmcUseDma = true;
+    return(0);
+  }
+
+  strcpy(g_pcTmpBuf, g_pcCwdBuf);
+  if (strcmp("/", g_pcCwdBuf)) {
+    strcat(g_pcTmpBuf, "/");
+  }
+  strcat(g_pcTmpBuf, "SDBENCH.BIN");
+
+  memset(data, 0x5A, chunk);
+
+  for (pass = 0; pass < 2; pass++) {
+    iFResult = f_open(&g_sFileObject, g_pcTmpBuf,
+                      pass ? FA_READ : (FA_WRITE | FA_CREATE_ALWAYS));
+    if (iFResult != FR_OK) {
+      break;
+    }
+
+    mmcIdleCycles = 0;
+    start = perfNow();
+
+    for (n = 0; (n < kb * 1024 / chunk) && (iFResult == FR_OK); n++) {
+      if (pass) {
+        iFResult = f_read(&g_sFileObject, data, chunk, &bw);
+      }
+      else {
+        iFResult = f_write(&g_sFileObject, data, chunk, &bw);
+      }
+
+      // A short write means the card is full, a short read that the file
+      // is not what was written
+      if ((iFResult == FR_OK) && (bw != chunk)) {
+        iFResult = pass ? FR_INT_ERR : FR_DENIED;
+      }
+    }
+
+    if (iFResult == FR_OK) {
+      iFResult = f_close(&g_sFileObject);
+    }
+    else {
+      f_close(&g_sFileObject);
+    }
+
+    if (iFResult != FR_OK) {
+      break;
+    }
+
+    total[pass] = perfNow() - start;
+    busy[pass] = total[pass] - (uint32_t) mmcIdleCycles;
+  }
+
+  f_unlink(g_pcTmpBuf);
+
+  if (iFResult == FR_OK) {
+    UARTprintf("{\"mode\":\"%s\",\"kb\":%u", mmcUseDma ? "dma" : "poll",
+               kb);
+    for (pass = 0; pass < 2; pass++) {
+      UARTprintf(",\"%s\":{\"kbps\":%u,\"cpu_ms_per_mb\":%u}",
+                 pass ? "read" : "write",
+                 (uint32_t) ((uint64_t) kb * SYS_CLK / total[pass]),
+                 (uint32_t) ((uint64_t) busy[pass] * 1024 /
+                             (SYS_CLK / 1000) / kb));
+    }
+    UARTprintf("}\n");
+  }
+
+  mmcUseDma = true;
+
+  return((int)iFResult);
+}
+
+//*****************************************************************************
+//
+// This function implements the "df" command.  It prints the size and free
+// space of the card, and how long nano can still record.  The free cluster
+// count is kept by FatFs, so it is known without a scan of the FAT.
+//
+//*****************************************************************************
+int
+Cmd_df(int argc, char *argv[])
+{
+  spaceT space;
+  FRESULT iFResult;
+
+  iFResult = spaceGet(&space);
+  if (iFResult != FR_OK) {
+    return ((int) iFResult);
+  }
+
+  UARTprintf("{\"total_kb\":%u,\"free_kb\":%u,\"cluster\":%u,"
+             "\"record_s\":%u}\n", spaceTotalKB(&space),
+             spaceFreeKB(&space), space.clusterSize,
+             nanoSeconds(nanoBlocksFree(&space)));
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "date" command.  Without arguments it prints
+// the time of the RTC the files are stamped with; "date YYYYMMDD [HHMMSS]"
+// sets it.  Until it is set, files are dated RTC_FALLBACK_YEAR-01-01 and "ls"
+// dates and "ls sort date" do not mean anything.
+//
+//*****************************************************************************
+int
+Cmd_date(int argc, char *argv[])
+{
+  rtcTimeT t;
+
+  if (argc > 1) {
+    if ((argc > 3) || !rtcParse(argv[1], (argc > 2) ? argv[2] : 0, &t)) {
+      UARTprintf("Usage: date [YYYYMMDD [HHMMSS]], from %u to %u\n",
+                 rtcEpochYear, rtcMaxYear);
+      return(0);
+    }
+    rtcSet(&t);
+  }
+
+  if (!rtcGet(&t)) {
+    UARTprintf("{\"set\":false}\n");
+    return(0);
+  }
+
+  UARTprintf("{\"set\":true,\"date\":\"%04u%02u%02u\","
+             "\"time\":\"%02u%02u%02u\"}\n", t.year, t.month, t.day, t.hour,
+             t.minute, t.second);
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "fsck" command.  It recovers the recordings in
+// the current directory that a reset or a power loss cut off, found by the
+// mark nano leaves in their directory entries until they are complete.  With
+// "all" the header of every other WAV file is checked against its size too.
+//
+//*****************************************************************************
+int
+Cmd_fsck(int argc, char *argv[])
+{
+  recoverStatT st;
+  uint32_t start = perfNow();
+  FRESULT iFResult;
+
+  // The filter scratch holds the header sector
+  iFResult = recoverDir(&g_sDirObject, &g_sFileInfo, &g_sFileObject,
+                        g_pcCwdBuf, (argc > 1) && !strcmp(argv[1], "all"),
+                        (uint8_t *) procScratch(0), &st);
+  if (iFResult != FR_OK) {
+    return ((int) iFResult);
+  }
+
+  UARTprintf("{\"files\":%u,\"checked\":%u,\"fixed\":%u,\"cut\":%u,"
+             "\"ms\":%u}\n", st.files, st.checked, st.fixed, st.cut,
+             (perfNow() - start) / (SYS_CLK / 1000));
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "tsfind" command.  It looks through the
+// timestamp indexes in the current directory for the recording that covers a
+// time, given in SysTick milliseconds since reset, and prints the file and
+// the byte offset of the sample.
+//
+//*****************************************************************************
+int
+Cmd_tsfind(int argc, char *argv[])
+{
+  tsHeaderT head;
+  uint32_t ms;
+  uint32_t offset;
+  FRESULT iFResult;
+  char *ext;
+
+  if (argc < 2) {
+    UARTprintf("Usage: tsfind <ms>\n");
+    return(0);
+  }
+
+  ms = strtoul(argv[1], 0, 10);
+
+  iFResult = f_opendir(&g_sDirObject, g_pcCwdBuf);
+  if (iFResult != FR_OK) {
+    return((int)iFResult);
+  }
+
+  for (;;) {
+    iFResult = f_readdir(&g_sDirObject, &g_sFileInfo);
+    if (iFResult != FR_OK) {
+      return((int)iFResult);
+    }
+
+    // End of the directory
+    if (!g_sFileInfo.fname[0]) {
+      break;
+    }
+
+    ext = strrchr(g_sFileInfo.fname, '.');
+    if (!ext || strcmp(ext, TSIDX_EXT)) {
+      continue;
+    }
+
+    if (strlen(g_pcCwdBuf) + strlen(g_sFileInfo.fname) + 1 + 1 >
+        sizeof(g_pcTmpBuf)) {
+      continue;
+    }
+
+    strcpy(g_pcTmpBuf, g_pcCwdBuf);
+    if (strcmp("/", g_pcCwdBuf)) {
+      strcat(g_pcTmpBuf, "/");
+    }
+    strcat(g_pcTmpBuf, g_sFileInfo.fname);
+
+    iFResult = f_open(&g_sFileObject, g_pcTmpBuf, FA_READ);
+    if (iFResult != FR_OK) {
+      return((int)iFResult);
+    }
+
+    iFResult = tsLookup(&g_sFileObject, ms, &head, &offset);
+    f_close(&g_sFileObject);
+
+    if (iFResult == FR_OK) {
+      UARTprintf("%s offset %u\n", head.wav, offset);
+      return(0);
+    }
+    if ((iFResult != FR_NO_FILE) && (iFResult != FR_NO_FILESYSTEM)) {
+      return((int)iFResult);
+    }
+  }
+
+  UARTprintf("No recording at %u ms\n", ms);
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "adcrate" command.  It captures one second at
+// the given sample rate without processing and reports whether the uDMA kept
+// up with the ADC.  With "burst" each request moves capBurstSize samples out
+// of the SS0 FIFO instead of one out of SS3.
+//
+//*****************************************************************************
+int
+Cmd_adcrate(int argc, char *argv[])
+{
+  elementT * bufData;
+  uint32_t rate = ADC_RATE;
+  uint32_t elements;
+  uint32_t got = 0;
+  uint32_t ticks;
+  bool burst = (argc > 2) && !strcmp(argv[2], "burst");
+  bool overflow;
+
+  if (argc > 1) {
+    rate = strtoul(argv[1], 0, 10);
+  }
+
+  if ((rate < elementSize) || (rate > (burst ? capBurstMaxRate : 1000000))) {
+    UARTprintf("Rate out of range\n");
+    return(0);
+  }
+
+  elements = rate / elementSize;
+
+  bufInit(gpBuf);
+  capRate = rate;
+  capBurst = burst;
+  acqConfig();
+
+  ticks = sysTickCount;
+  capTimerEnable();
+
+  while (got < elements) {
+    bufData = bufGet(gpBuf);
+
+    if (bufData) {
+      bufItemSetFree(gpBuf, bufData->index);
+      got++;
+    }
+  }
+
+  ticks = sysTickCount - ticks;
+  capTimerDisable();
+  overflow = ADCSequenceOverflow(ADC0_BASE, burst ? 0 : 3) != 0;
+  capRate = ADC_RATE;
+  capBurst = false;
+
+  // Samples lost to a FIFO overflow make the second last longer
+  UARTprintf("{\"rate\":%u,\"burst\":%u,\"requests\":%u,\"samples\":%u,"
+             "\"ms\":%u,\"overflow\":%s}\n", rate, burst ? capBurstSize : 1,
+             rate / (burst ? capBurstSize : 1), got * elementSize, ticks * 10,
+             overflow ? "true" : "false");
+  perfStatPrint("isr", &capIsrPerf);
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// This function implements the "jitter" command.  "on" clears the histograms
+// and has the DAC and capture handlers stamp themselves from then on, so a
+// following cat or nano is measured under its SD load; "off" stops it.  With
+// no argument it prints the latency and jitter histograms as JSON.
+//
+//*****************************************************************************
+int
+Cmd_jitter(int argc, char *argv[])
+{
+  if ((argc > 1) && !strcmp(argv[1], "on")) {
+    irqMeasure = false;
+    irqClear();
+    irqMeasure = true;
+    return(0);
+  }
+
+  if ((argc > 1) && !strcmp(argv[1], "off")) {
+    irqMeasure = false;
+    return(0);
+  }
+
+  irqPrint("dac", &irqDac);
+  irqPrint("capture", &irqCapture);
+
+  return(0);
+}
+
+//*****************************************************************************
+//
+// The biggest statically allocated objects, listed by the "mem" command.  The
+// linker map has all of them.
+//
+//*****************************************************************************
+static const memObjT g_psMemObjects[] =
+{
+    { "adcBuf",         sizeof(adcBuf) },
+    { "controlTable",   sizeof(controlTable) },
+    { "filter scratch", 2 * LENGTH * sizeof(float32_t) },
+    { "nano vad",       sizeof(vadT) },
+    { "nano index",     sizeof(tsIdxT) },
+    { "g_sFatFs",       sizeof(g_sFatFs) },
+    { "g_sFileObject",  sizeof(g_sFileObject) },
+    { "mix files",      sizeof(g_psMixFiles) },
+    { "g_sDirObject",   sizeof(g_sDirObject) },
+    { "g_sFileInfo",    sizeof(g_sFileInfo) },
+    { "path buffers",   2 * PATH_BUF_SIZE + CMD_BUF_SIZE }
+};
+
+#define NUM_MEM_OBJECTS (sizeof(g_psMemObjects) / sizeof(memObjT))
+
+//*****************************************************************************
+//
+// This function implements the "mem" command.  It prints the RAM sections,
+// the deepest the stack has gone since reset, the biggest objects and how
+// many more ring elements would fit in the SRAM left, as JSON.
+//
+//*****************************************************************************
+int
+Cmd_mem(int argc, char *argv[])
+{
+  memPrint(g_psMemObjects, NUM_MEM_OBJECTS, sizeof(elementT));
+
+  return(0);
+}
+
 //*****************************************************************************
 //
 // This function implements the "help" command.  It prints a simple list of the
@@ -1215,15 +2656,43 @@ tCmdLineEntry g_psCmdTable[] =
     { "help",   Cmd_help,   "Display list of commands" },
     { "h",      Cmd_help,   "alias for help" },
     { "?",      Cmd_help,   "alias for help" },
-    { "ls",     Cmd_ls,     "Display list of files" },
+    { "ls",     Cmd_ls,     "Display list of files [match P] [date D[-D]] "
+                            "[sort name|date] [page N] [size N] [recent]" },
     { "chdir",  Cmd_cd,     "Change directory" },
     { "cd",     Cmd_cd,     "alias for chdir" },
     { "pwd",    Cmd_pwd,    "Show current working directory" },
     { "cat",    Cmd_cat,    "Show contents of a text file" },
-    { "nano",   Cmd_nano,   "Create a file and write dump to it."},
+    { "play",   Cmd_play,   "Play WAV files without gaps: playlist or pattern, "
+                            "q stops" },
+    { "mix",    Cmd_mix,    "Play WAV files mixed: file[:gain%] ..., keys 0-2 "
+                            "start a file again, q stops" },
+    { "nano",   Cmd_nano,   "Record to a file. Options: gate, spec, sg, burst, "
+                            "over R, order N" },
+    { "spectrum", Cmd_spectrum, "Show the spectrum of the input [blocks]" },
+    { "monitor", Cmd_monitor, "Play the input live through the filter "
+                            "[block N] [lead N] [rec FILE], q stops" },
+    { "bench",  Cmd_bench,  "Run the kernel benchmarks "
+                            "[name|crossover|rate|mix]" },
+    { "fireval", Cmd_fireval, "Compare accuracy and speed of filter kernels" },
+    { "adcrate", Cmd_adcrate, "Check a capture rate keeps up [rate] [burst]" },
+    { "tsfind", Cmd_tsfind, "Find the recording at a time in ms since reset" },
+    { "sdbench", Cmd_sdbench, "Time SD writes and reads [KB] [poll]" },
+    { "df",     Cmd_df,     "Show free space and recording time left" },
+    { "date",   Cmd_date,   "Show or set the file date [YYYYMMDD [HHMMSS]]" },
+    { "fsck",   Cmd_fsck,   "Recover recordings cut off by a reset [all]" },
+    { "jitter", Cmd_jitter, "Show DAC and capture ISR timing [on|off]" },
+    { "mem",    Cmd_mem,    "Show RAM use, stack high-watermark and objects" },
     { 0, 0, 0 }
 };
 
+//*****************************************************************************
+//
+// The commands main runs on boot.
+//
+//*****************************************************************************
+static char *g_ppcBootArgv[] = { "nano", BOOT_PREFIX, "boot" };
+static char *g_ppcFsckArgv[] = { "fsck" };
+
 //*****************************************************************************
 //
 // The error routine that is called if the driver library encounters an error.
@@ -1283,6 +2752,12 @@ main(void)
 {
     int nStatus;
     FRESULT iFResult;
+    bool boot;
+
+    //
+    // Paint the stack for the high-watermark of the "mem" command.
+    //
+    memPaint();
 
     //
     // Enable lazy stacking for interrupt handlers.  This allows floating-point
@@ -1292,10 +2767,23 @@ main(void)
     ROM_FPULazyStackingEnable();
 
     //
-    // Set the system clock to run at 80MHz from the PLL.
+    // Set the system clock to run at 80MHz from the PLL.  The cycle counter
+    // used for the performance reports runs since ResetISR, at 16MHz until
+    // here.
     //
     ROM_SysCtlClockSet(SYSCTL_SYSDIV_2_5 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
                        SYSCTL_XTAL_16MHZ);
+    bootClock();
+
+    //
+    // Interrupt priorities, before any interrupt is enabled.
+    //
+    irqInit();
+
+    //
+    // The RTC the files are dated with.  It keeps running through a reset.
+    //
+    rtcInit();
 
     //
     // Enable the peripherals used by this example.
@@ -1315,11 +2803,6 @@ main(void)
     //
     ROM_IntMasterEnable();
 
-    //
-    // Initialize the UART as a console for text I/O.
-    //
-    ConfigureUART();
-
     //
     // Buffer initialization
     //
@@ -1329,6 +2812,21 @@ main(void)
     // Setup data acquisition
     acqConfig();
 
+    //
+    // Record on boot: capture from here on, the ring holds the samples until
+    // the recorder takes over once the console is up.
+    //
+    boot = bootWanted();
+    if (boot) {
+        capTimerEnable();
+        bootFirstSample();
+    }
+
+    //
+    // Initialize the UART as a console for text I/O.
+    //
+    ConfigureUART();
+
     // Setup DAC
     dacSetup();
 
@@ -1355,6 +2853,38 @@ main(void)
         return(1);
     }
 
+    //
+    // The recording started at reset mounts the card and opens its file
+    // while the first blocks wait in memory.
+    //
+    if (boot)
+    {
+        UARTprintf("boot: first sample %u us after reset\n",
+                   bootUs(bootTime.sample));
+
+        nStatus = Cmd_nano(3, g_ppcBootArgv);
+        if(nStatus != 0)
+        {
+            UARTprintf("boot: recording failed: %s\n",
+                        StringFromFResult((FRESULT)nStatus));
+        }
+
+        // Stop the capture, also when the recording did not start
+        mmcIdle = 0;
+        capTimerDisable();
+        bootTime.sample = 0;
+    }
+
+    //
+    // Recover the recordings in the root directory that a reset or a power
+    // loss cut off.  Only the directory is read when there are none.
+    //
+    nStatus = Cmd_fsck(1, g_ppcFsckArgv);
+    if(nStatus != 0)
+    {
+        UARTprintf("fsck error: %s\n", StringFromFResult((FRESULT)nStatus));
+    }
+
 
     //
     // Enter an infinite loop for reading and processing commands from the
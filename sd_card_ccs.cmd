@@ -61,10 +61,24 @@ SECTIONS
     .init_array : > FLASH
 
     .vtable :   > RAM_BASE
-    .data   :   > SRAM
-    .bss    :   > SRAM
-    .sysmem :   > SRAM
-    .stack  :   > SRAM
+
+    /* Bounds of the RAM sections for the "mem" command, see mem.c */
+    .data   :   > SRAM, RUN_START(memDataStart), RUN_SIZE(memDataSize)
+    .bss    :   > SRAM, RUN_START(memBssStart), RUN_SIZE(memBssSize)
+    .sysmem :   > SRAM, RUN_START(memHeapStart), RUN_SIZE(memHeapSize)
+    .stack  :   > SRAM, RUN_START(memStackStart), RUN_SIZE(memStackSize)
+
+#ifdef RAM_CODE
+    /* Hot code, loaded in flash and copied to SRAM by the boot code through */
+    /* the BINIT table. The CMSIS kernels are picked by their subsections.    */
+    .ramfunc : {
+        *(.ramfunc)
+        *(.text:arm_fir_f32)
+        *(.text:arm_fir_decimate_f32)
+    } load = FLASH, run = SRAM, table(BINIT),
+      RUN_START(memCodeStart), RUN_SIZE(memCodeSize)
+    .binit  :   > FLASH
+#endif
 }
 
 __STACK_TOP = __stack + 1024;
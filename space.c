@@ -0,0 +1,53 @@
+/*
+ * space.c
+ *
+ * FatFs reads the free cluster count out of FSInfo when it mounts a FAT32
+ * volume, counts it down as files grow and writes it back to FSInfo when a
+ * file is closed. Only a volume without a valid count (FAT16, or FSInfo left
+ * invalid by another system) costs a scan of the whole FAT, once, on the
+ * first call. The count then goes to FSInfo with the next file closed.
+ *
+ *  Created on: 19-10-2026
+ */
+#include "space.h"
+
+FRESULT spaceGet(spaceT * sp) {
+  FATFS * fs;
+  DWORD n;
+  FRESULT res;
+
+  res = f_getfree("/", &n, &fs);
+  if (res != FR_OK) {
+    return res;
+  }
+
+  sp->clusters = fs->n_fatent - 2;
+  sp->freeClusters = n;
+  sp->clusterSize = (uint32_t) fs->csize * 512;
+
+  return FR_OK;
+}
+
+uint32_t spaceTotalKB(const spaceT * sp) {
+  return (uint32_t) ((uint64_t) sp->clusters * sp->clusterSize / 1024);
+}
+
+uint32_t spaceFreeKB(const spaceT * sp) {
+  return (uint32_t) ((uint64_t) sp->freeClusters * sp->clusterSize / 1024);
+}
+
+//
+// Blocks of blockBytes that fit in the free space after head bytes, spread
+// over files new files that may each leave up to a cluster unused
+//
+uint32_t spaceBlocks(const spaceT * sp, uint32_t head, uint32_t blockBytes,
+                     uint8_t files) {
+  uint64_t bytes = (uint64_t) sp->freeClusters * sp->clusterSize;
+  uint64_t reserve = head + (uint64_t) files * sp->clusterSize;
+
+  if (bytes <= reserve) {
+    return 0;
+  }
+
+  return (uint32_t) ((bytes - reserve) / blockBytes);
+}
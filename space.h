@@ -0,0 +1,27 @@
+/*
+ * space.h
+ * Free space on the card from the cluster count FatFs keeps
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef SPACE_H_
+#define SPACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/src/ff.h"
+
+typedef struct {
+  uint32_t clusters;     // Data clusters of the volume
+  uint32_t freeClusters;
+  uint32_t clusterSize;  // Bytes per cluster
+} spaceT;
+
+FRESULT spaceGet(spaceT * sp);
+uint32_t spaceTotalKB(const spaceT * sp);
+uint32_t spaceFreeKB(const spaceT * sp);
+uint32_t spaceBlocks(const spaceT * sp, uint32_t head, uint32_t blockBytes,
+                     uint8_t files);
+
+#endif /* SPACE_H_ */
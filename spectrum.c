@@ -0,0 +1,188 @@
+/*
+ * spectrum.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "spectrum.h"
+#include "utils/uartstdio.h"
+
+// CMSIS
+#include "arm_math.h"
+
+// Scale |X| of a Hann windowed block to the amplitude of a sine relative to
+// the 12-bit ADC full scale. Input samples are centered ADC counts / INT16_MAX.
+#define SPEC_SCALE    ((4.0f / specFftSize) * ((float32_t) INT16_MAX / 2048))
+
+// Equivalent noise bandwidth of the Hann window, in bins
+#define SPEC_HANN_ENBW 1.5f
+
+static arm_rfft_fast_instance_f32 fft;
+static float32_t power[specBins]; // Power sum for each bin
+static uint16_t blocksWanted;
+static uint16_t blocksDone;
+
+perfStatT specPerf;
+
+//
+// Start a new measurement averaged over the given number of blocks.
+//
+void specInit(uint16_t blocks) {
+  arm_rfft_fast_init_f32(&fft, specFftSize);
+  memset(power, 0, sizeof(power));
+
+  blocksWanted = blocks;
+  blocksDone = 0;
+  perfStatReset(&specPerf);
+}
+
+bool specWanted(void) {
+  return blocksDone < blocksWanted;
+}
+
+//
+// Complex bin k of the packed arm_rfft_fast_f32 output. Bins outside
+// 0..N/2 are mirrored (X[-k] = conj(X[k])).
+//
+static void specBin(const float32_t * X, int16_t k, float32_t * re,
+                    float32_t * im) {
+  float32_t sign = 1.0f;
+
+  if (k < 0) {
+    k = -k;
+    sign = -1.0f;
+  }
+  else if (k > specFftSize / 2) {
+    k = specFftSize - k;
+    sign = -1.0f;
+  }
+
+  if (k == 0) {
+    *re = X[0];
+    *im = 0;
+  }
+  else if (k == specFftSize / 2) {
+    *re = X[1];
+    *im = 0;
+  }
+  else {
+    *re = X[2 * k];
+    *im = sign * X[2 * k + 1];
+  }
+}
+
+//
+// Add one block of specFftSize samples to the average. The input block is
+// used as FFT work area and scratch receives the spectrum, so both may be
+// borrowed buffers. The Hann window is applied in the frequency domain
+// (0.5 X[k] - 0.25 (X[k-1] + X[k+1])), which needs no window table.
+//
+void specFeed(float * in, float * scratch) {
+  uint32_t start;
+  int16_t k;
+  float32_t re, im, reL, imL, reH, imH;
+
+  if (!specWanted()) {
+    return;
+  }
+
+  start = perfNow();
+
+  arm_rfft_fast_f32(&fft, in, scratch, 0);
+
+  for (k = 0; k < specBins; k++) {
+    specBin(scratch, k, &re, &im);
+    specBin(scratch, k - 1, &reL, &imL);
+    specBin(scratch, k + 1, &reH, &imH);
+
+    re = (0.5f * re - 0.25f * (reL + reH)) * SPEC_SCALE;
+    im = (0.5f * im - 0.25f * (imL + imH)) * SPEC_SCALE;
+
+    power[k] += re * re + im * im;
+  }
+
+  blocksDone++;
+  perfStatAdd(&specPerf, perfNow() - start);
+}
+
+// Print a dB value with one decimal
+static void specPrintDb(float32_t db) {
+  int32_t t;
+
+  t = (int32_t) (db * 10.0f + ((db < 0) ? -0.5f : 0.5f));
+  UARTprintf("%s%d.%d dBFS", (t < 0) ? "-" : "", abs(t) / 10, abs(t) % 10);
+}
+
+static float32_t specDb(float32_t p) {
+  return 10.0f * log10f(p + 1e-12f);
+}
+
+//
+// Print the strongest peaks and the power of specBands equal bands.
+//
+void specPrint(uint32_t sampleRate) {
+  uint16_t peak[specPeaks];
+  uint8_t numPeaks = 0;
+  uint8_t i, j;
+  int16_t k;
+  float32_t p, norm, band;
+  uint16_t binsPerBand = (specBins - 1) / specBands;
+
+  if (blocksDone == 0) {
+    UARTprintf("No blocks analyzed\n");
+    return;
+  }
+
+  norm = 1.0f / blocksDone;
+
+  // Collect the local maxima with the highest power, sorted
+  for (k = 1; k < specBins - 1; k++) {
+    p = power[k];
+
+    if ((p <= power[k - 1]) || (p < power[k + 1])) {
+      continue;
+    }
+
+    for (i = 0; i < numPeaks; i++) {
+      if (p > power[peak[i]]) {
+        break;
+      }
+    }
+
+    if (i < specPeaks) {
+      if (numPeaks < specPeaks) {
+        numPeaks++;
+      }
+      for (j = numPeaks - 1; j > i; j--) {
+        peak[j] = peak[j - 1];
+      }
+      peak[i] = k;
+    }
+  }
+
+  UARTprintf("\nSpectrum of %u blocks, %u Hz/bin\n", blocksDone,
+             sampleRate / specFftSize);
+
+  for (i = 0; i < numPeaks; i++) {
+    UARTprintf("peak %u: %6u Hz  ", i,
+               (uint32_t) peak[i] * sampleRate / specFftSize);
+    specPrintDb(specDb(power[peak[i]] * norm));
+    UARTprintf("\n");
+  }
+
+  for (i = 0; i < specBands; i++) {
+    band = 0;
+    for (k = i * binsPerBand; k < (i + 1) * binsPerBand; k++) {
+      band += power[k];
+    }
+
+    UARTprintf("band %5u-%5u Hz: ",
+               (uint32_t) i * binsPerBand * sampleRate / specFftSize,
+               (uint32_t) (i + 1) * binsPerBand * sampleRate / specFftSize);
+    specPrintDb(specDb(band * norm / SPEC_HANN_ENBW));
+    UARTprintf("\n");
+  }
+
+  perfStatPrint("spectrum", &specPerf);
+}
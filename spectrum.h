@@ -0,0 +1,35 @@
+/*
+ * spectrum.h
+ * Averaged power spectrum of live ADC blocks
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cirbuf.h"
+#include "perf.h"
+
+enum {
+  specFftSize = elementSize,
+  specBins = specFftSize / 2 + 1,
+  specPeaks = 5,  // Number of peaks reported
+  specBands = 8,  // Number of equal width bands reported
+  specMaxBacklog = 3 // Skip blocks when the ring holds more elements than this
+};
+
+// Blocks averaged by the spectrum command, and by nano with "spec"
+#define SPEC_DEFAULT_BLOCKS 16
+#define SPEC_NANO_BLOCKS    64
+
+extern perfStatT specPerf;
+
+void specInit(uint16_t blocks);
+bool specWanted(void);
+void specFeed(float * in, float * scratch);
+void specPrint(uint32_t sampleRate);
+
+#endif /* SPECTRUM_H_ */
@@ -0,0 +1,414 @@
+/*
+ * batch.c
+ * Host batch processor: runs 32 ksps captures through the recording filter
+ * and decimation chain of the device, in parallel over all cores.
+ *
+ * Usage: batch [-j threads] [-s elements] -o outdir file.wav...
+ *
+ * Inputs are 16-bit mono WAV files at ADC_RATE holding centered ADC counts.
+ * Each one gives an 8 ksps WAV of the same name in outdir, bit-identical to
+ * what procBlock() records for the same samples. A trailing partial element
+ * is dropped, as the device only handles whole elements.
+ *
+ * Files are split in segments of -s elements, queued on the workers round
+ * robin. A worker takes work from the back of its own queue and steals from
+ * the front of the others once it runs dry. A segment first runs the element
+ * before it through the filter and drops the output, which leaves the same
+ * filter state as on the device, so segments can be done in any order.
+ *
+ * Build (CMSIS-DSP 1.10 or later builds on the host):
+ *   gcc -O2 -std=gnu99 -ffp-contract=off -pthread -DARM_MATH_LOOPUNROLL
+ *       -I.. -I$CMSIS/DSP/Include -I$CMSIS/Core/Include -o batch batch.c
+ *       ../proc.c ../conv.c ../cic.c ../fir_filter.c ../format.c
+ *       $CMSIS/DSP/Source/FilteringFunctions/arm_fir_init_f32.c
+ *       $CMSIS/DSP/Source/FilteringFunctions/arm_fir_f32.c
+ *       $CMSIS/DSP/Source/FilteringFunctions/arm_fir_decimate_init_f32.c
+ *       $CMSIS/DSP/Source/FilteringFunctions/arm_fir_decimate_f32.c -lm
+ * -ffp-contract=off keeps the compiler from fusing the multiply-adds, which
+ * the device build does not do either. PROC_OLS must be set as in the device
+ * build, and ../ols.c plus the CMSIS FFT sources added if it is.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "proc.h"
+#include "conv.h"
+#include "format.h"
+#include "global.h"
+
+enum {
+  batchMaxThreads = 256,
+  batchSegElements = 256 // Default segment length (128k input samples)
+};
+
+typedef struct {
+  const char * inName;
+  char * outName;
+  uint32_t dataOffset; // Of the samples in the input file
+  uint32_t elements;   // Whole elements in the input
+  int failed;
+} batchFileT;
+
+typedef struct {
+  batchFileT * file;
+  uint32_t first;    // First element of the segment
+  uint32_t elements;
+} batchTaskT;
+
+// Queue of one worker. Tasks are only taken, never added once running.
+typedef struct {
+  pthread_mutex_t lock;
+  batchTaskT ** task;
+  uint32_t head;
+  uint32_t tail;
+} batchQueueT;
+
+typedef struct {
+  uint16_t id;
+  uint32_t done;
+  uint32_t stolen;
+} batchWorkerT;
+
+static batchQueueT batchQueue[batchMaxThreads];
+static uint16_t batchThreads;
+static uint32_t batchSegment = batchSegElements;
+
+static uint16_t batchLe16(const uint8_t * p) {
+  return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t batchLe32(const uint8_t * p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+         ((uint32_t) p[3] << 24);
+}
+
+//
+// Find the sample data of a WAV file and check it is a capture the chain can
+// take. Returns 0 on success.
+//
+static int batchParse(batchFileT * f) {
+  uint8_t hdr[512];
+  uint32_t pos = 12;
+  uint32_t size;
+  ssize_t n;
+  int fmtOk = 0;
+  int fd = open(f->inName, O_RDONLY);
+
+  if (fd < 0) {
+    fprintf(stderr, "%s: %s\n", f->inName, strerror(errno));
+    return -1;
+  }
+
+  n = read(fd, hdr, sizeof(hdr));
+  close(fd);
+
+  if ((n < 12) || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4)) {
+    fprintf(stderr, "%s: not a WAV file\n", f->inName);
+    return -1;
+  }
+
+  while (pos + 8 <= (uint32_t) n) {
+    size = batchLe32(hdr + pos + 4);
+
+    if (!memcmp(hdr + pos, "fmt ", 4) && (pos + 24 <= (uint32_t) n)) {
+      fmtOk = (batchLe16(hdr + pos + 8) == 1) &&  // PCM
+              (batchLe16(hdr + pos + 10) == 1) && // Mono
+              (batchLe32(hdr + pos + 12) == ADC_RATE) &&
+              (batchLe16(hdr + pos + 22) == 16);
+    }
+    else if (!memcmp(hdr + pos, "data", 4)) {
+      if (!fmtOk) {
+        fprintf(stderr, "%s: needs 16-bit mono PCM at %lu Hz\n", f->inName,
+                ADC_RATE);
+        return -1;
+      }
+
+      f->dataOffset = pos + 8;
+      f->elements = size / (elementSize * sizeof(int16_t));
+      return 0;
+    }
+
+    pos += 8 + size + (size & 1);
+  }
+
+  fprintf(stderr, "%s: no data chunk in the first %u bytes\n", f->inName,
+          (unsigned) sizeof(hdr));
+  return -1;
+}
+
+//
+// Create the output file with its final header and size, so segments can be
+// written to it by any worker in any order.
+//
+static int batchCreate(batchFileT * f) {
+  uint8_t hdr[WAV_HEADER_SIZE];
+  uint32_t dataSize = f->elements * procOutSize * sizeof(int16_t);
+  int fd = open(f->outName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0) {
+    fprintf(stderr, "%s: %s\n", f->outName, strerror(errno));
+    return -1;
+  }
+
+  wavHeaderFill(hdr, dataSize);
+
+  if ((write(fd, hdr, sizeof(hdr)) != sizeof(hdr)) ||
+      ftruncate(fd, WAV_HEADER_SIZE + dataSize)) {
+    fprintf(stderr, "%s: %s\n", f->outName, strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  close(fd);
+  return 0;
+}
+
+//
+// Run one segment through a fresh filter instance
+//
+static void batchRun(batchTaskT * t, procFilterT * filter, float32_t * in,
+                     float32_t * tmp, int16_t * out) {
+  batchFileT * f = t->file;
+  uint32_t e = (t->first > 0) ? t->first - 1 : 0;
+  uint32_t last = t->first + t->elements;
+  size_t mapSize = f->dataOffset +
+                   (size_t) last * elementSize * sizeof(int16_t);
+  const uint8_t * map;
+  const int16_t * x;
+  int16_t * o = out;
+  size_t outSize = (size_t) t->elements * procOutSize * sizeof(int16_t);
+  int fd;
+
+  fd = open(f->inName, O_RDONLY);
+  if (fd < 0) {
+    f->failed = 1;
+    return;
+  }
+
+  map = mmap(0, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    f->failed = 1;
+    return;
+  }
+  madvise((void *) map, mapSize, MADV_SEQUENTIAL);
+
+  // The data chunk is only 2-byte aligned in general
+  x = (const int16_t *) (map + f->dataOffset);
+  procFilterInit(filter, firCoeffsf32, TAPS);
+
+  for (; e < last; e++) {
+    memcpy(tmp, x + (size_t) e * elementSize, elementSize * sizeof(int16_t));
+    convIntToFloat((int16_t *) tmp, in, elementSize, CONV_SCALE);
+    procFilterRun(filter, in, tmp, o);
+
+    // Warm up element, only there to fill the filter state
+    if (e >= t->first) {
+      o += procOutSize;
+    }
+  }
+
+  munmap((void *) map, mapSize);
+
+  fd = open(f->outName, O_WRONLY);
+  if ((fd < 0) ||
+      (pwrite(fd, out, outSize, WAV_HEADER_SIZE +
+              (off_t) t->first * procOutSize * sizeof(int16_t)) !=
+       (ssize_t) outSize)) {
+    f->failed = 1;
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+// Take a task from the back of queue q, or steal one from its front
+static batchTaskT * batchTake(batchQueueT * q, int steal) {
+  batchTaskT * t = 0;
+
+  pthread_mutex_lock(&q->lock);
+  if (q->head < q->tail) {
+    t = steal ? q->task[q->head++] : q->task[--q->tail];
+  }
+  pthread_mutex_unlock(&q->lock);
+
+  return t;
+}
+
+static void * batchWorker(void * arg) {
+  batchWorkerT * w = arg;
+  procFilterT filter;
+  float32_t * in = malloc(elementSize * sizeof(float32_t));
+  float32_t * tmp = malloc(elementSize * sizeof(float32_t));
+  int16_t * out = malloc((size_t) batchSegment * procOutSize *
+                         sizeof(int16_t));
+  batchTaskT * t;
+  uint16_t i;
+
+  if (!in || !tmp || !out) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  for (;;) {
+    t = batchTake(&batchQueue[w->id], 0);
+
+    // Own queue empty: go round the others, starting with the next one
+    for (i = 1; !t && (i < batchThreads); i++) {
+      t = batchTake(&batchQueue[(w->id + i) % batchThreads], 1);
+      w->stolen += (t != 0);
+    }
+
+    if (!t) {
+      break;
+    }
+
+    batchRun(t, &filter, in, tmp, out);
+    w->done++;
+  }
+
+  free(in);
+  free(tmp);
+  free(out);
+  return 0;
+}
+
+static void batchUsage(void) {
+  fprintf(stderr, "Usage: batch [-j threads] [-s elements] -o outdir "
+          "file.wav...\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  const char * outDir = 0;
+  batchFileT * file;
+  batchTaskT * task;
+  batchWorkerT worker[batchMaxThreads];
+  pthread_t thread[batchMaxThreads];
+  struct timespec t0, t1;
+  uint32_t nFiles = 0, nTasks = 0, e, i;
+  uint64_t samples = 0;
+  double sec;
+  const char * base;
+  int opt, failed = 0;
+
+  batchThreads = (uint16_t) sysconf(_SC_NPROCESSORS_ONLN);
+
+  while ((opt = getopt(argc, argv, "j:s:o:")) != -1) {
+    switch (opt) {
+    case 'j':
+      batchThreads = (uint16_t) atoi(optarg);
+      break;
+    case 's':
+      batchSegment = (uint32_t) atoi(optarg);
+      break;
+    case 'o':
+      outDir = optarg;
+      break;
+    default:
+      batchUsage();
+    }
+  }
+
+  if (!outDir || (optind >= argc) || (batchSegment == 0) ||
+      (batchThreads == 0) || (batchThreads > batchMaxThreads)) {
+    batchUsage();
+  }
+
+  file = calloc(argc - optind, sizeof(batchFileT));
+  if (!file) {
+    return 1;
+  }
+
+  for (i = optind; i < (uint32_t) argc; i++) {
+    batchFileT * f = &file[nFiles];
+
+    f->inName = argv[i];
+    base = strrchr(argv[i], '/');
+    base = base ? base + 1 : argv[i];
+    f->outName = malloc(strlen(outDir) + strlen(base) + 2);
+    sprintf(f->outName, "%s/%s", outDir, base);
+
+    if (!strcmp(f->inName, f->outName)) {
+      fprintf(stderr, "%s: output would overwrite the input\n", f->inName);
+      failed = 1;
+      continue;
+    }
+
+    if (batchParse(f) || batchCreate(f)) {
+      failed = 1;
+      continue;
+    }
+
+    nTasks += (f->elements + batchSegment - 1) / batchSegment;
+    samples += (uint64_t) f->elements * elementSize;
+    nFiles++;
+  }
+
+  task = calloc(nTasks ? nTasks : 1, sizeof(batchTaskT));
+  for (i = 0; i < batchThreads; i++) {
+    pthread_mutex_init(&batchQueue[i].lock, 0);
+    batchQueue[i].task = calloc(nTasks ? nTasks : 1, sizeof(batchTaskT *));
+    if (!task || !batchQueue[i].task) {
+      return 1;
+    }
+  }
+
+  // Deal the segments out round robin
+  nTasks = 0;
+  for (i = 0; i < nFiles; i++) {
+    for (e = 0; e < file[i].elements; e += batchSegment) {
+      batchQueueT * q = &batchQueue[nTasks % batchThreads];
+
+      task[nTasks].file = &file[i];
+      task[nTasks].first = e;
+      task[nTasks].elements = (file[i].elements - e < batchSegment) ?
+                              file[i].elements - e : batchSegment;
+      q->task[q->tail++] = &task[nTasks];
+      nTasks++;
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  for (i = 0; i < batchThreads; i++) {
+    worker[i].id = (uint16_t) i;
+    worker[i].done = 0;
+    worker[i].stolen = 0;
+    pthread_create(&thread[i], 0, batchWorker, &worker[i]);
+  }
+
+  for (i = 0; i < batchThreads; i++) {
+    pthread_join(thread[i], 0);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  for (i = 0; i < nFiles; i++) {
+    if (file[i].failed) {
+      fprintf(stderr, "%s: failed\n", file[i].inName);
+      failed = 1;
+    }
+  }
+
+  for (i = 0; i < batchThreads; i++) {
+    fprintf(stderr, "thread %2u: %u segments, %u stolen\n", i, worker[i].done,
+            worker[i].stolen);
+  }
+
+  fprintf(stderr, "%u files, %u segments, %u threads: %.3f s, %.1f Msps, "
+          "%.0fx real time\n", nFiles, nTasks, batchThreads, sec,
+          samples / sec / 1e6, samples / sec / ADC_RATE);
+
+  return failed;
+}
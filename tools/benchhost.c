@@ -0,0 +1,208 @@
+/*
+ * benchhost.c
+ * Host build of the "bench" command, with regression limits from a recorded
+ * baseline
+ *
+ * Usage: benchhost [-f filter] [-b baseline] [-m percent]
+ *
+ *   -f filter    Only the benchmarks whose name starts with filter
+ *   -b baseline  Output of an earlier run to take the limits from
+ *   -m percent   Margin over the baseline (25)
+ *
+ * Runs benchRun() of bench.c, the table of the "bench" command, built from
+ * the same sources for the host, and prints the same JSON. Times count a
+ * SYS_CLK clock, from the monotonic clock of the host.
+ *
+ * The limits of the table are Cortex-M4 budgets and do not apply here.
+ * Without -b nothing is checked, and the output saved to a file is the
+ * baseline: record it on the machine that runs the check, idle, with the
+ * compiler and flags below. With -b each benchmark fails when its fastest
+ * call takes longer than its baseline plus the margin, and benchhost exits
+ * with 1; the limit is printed with each result. A benchmark not in the
+ * baseline has no limit. The fastest of benchRuns calls varies by a few
+ * percent from run to run on an idle host, which the margin covers; the
+ * limits get hostSlack on top for the kernels that take well under a us.
+ *
+ * Build (CMSIS-DSP 1.10 or later builds on the host):
+ *   gcc -O2 -std=gnu99 -ffp-contract=off -DPERF_HOST -DARM_MATH_LOOPUNROLL
+ *       -I.. -I$TIVAWARE -I$CMSIS/DSP/Include -I$CMSIS/Core/Include
+ *       -o benchhost benchhost.c ../bench.c ../proc.c ../conv.c ../cic.c
+ *       ../chain.c ../ols.c ../format.c ../cirbuf.c ../dac.c ../mix.c
+ *       ../fir_filter.c ../perf.c
+ *       $CMSIS/DSP/Source/FilteringFunctions/FilteringFunctions.c
+ *       $CMSIS/DSP/Source/BasicMathFunctions/BasicMathFunctions.c
+ *       $CMSIS/DSP/Source/StatisticsFunctions/StatisticsFunctions.c
+ *       $CMSIS/DSP/Source/TransformFunctions/TransformFunctions.c
+ *       $CMSIS/DSP/Source/CommonTables/CommonTables.c
+ *       $CMSIS/DSP/Source/ComplexMathFunctions/ComplexMathFunctions.c -lm
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bench.h"
+#include "cirbuf.h"
+#include "dac.h"
+#include "global.h"
+#include "irq.h"
+
+enum {
+  hostMaxBaseline = 64,
+  hostSlack = SYS_CLK / 2000000 // 0.5us on top, for the clock resolution
+};
+
+typedef struct {
+  char name[32];
+  uint32_t min;
+} hostBaseT;
+
+static hostBaseT hostBase[hostMaxBaseline];
+static uint16_t hostBaseCount;
+static uint32_t hostMargin = 25;
+
+static bufT hostBuf;
+
+// Globals of sd_card.c and irq.c the kernels use
+volatile uint16_t dacIndex;
+volatile elementT * dacBuf;
+volatile bufT * gpBuf;
+volatile bool stop;
+volatile bool irqMeasure = false;
+irqTimingT irqDac;
+
+// SYS_CLK cycles from the monotonic clock
+uint32_t perfHostNow(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t) (((uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec) *
+                     (SYS_CLK / 1000000) / 1000);
+}
+
+void irqStamp(irqTimingT * t, uint32_t at, uint32_t elapsed,
+              uint32_t period) {}
+bool IntMasterDisable(void) { return false; }
+bool IntMasterEnable(void) { return false; }
+void TimerIntClear(uint32_t b, uint32_t f) {}
+uint32_t TimerValueGet(uint32_t b, uint32_t t) { return 0; }
+void SysCtlPeripheralEnable(uint32_t p) {}
+void GPIOPinConfigure(uint32_t c) {}
+void GPIOPinTypePWM(uint32_t b, uint8_t p) {}
+void PWMGenConfigure(uint32_t b, uint32_t g, uint32_t c) {}
+void PWMGenPeriodSet(uint32_t b, uint32_t g, uint32_t p) {}
+void PWMGenEnable(uint32_t b, uint32_t g) {}
+void PWMGenDisable(uint32_t b, uint32_t g) {}
+void PWMOutputState(uint32_t b, uint32_t o, bool e) {}
+void PWMPulseWidthSet(uint32_t b, uint32_t o, uint32_t width) {}
+void TimerConfigure(uint32_t b, uint32_t c) {}
+void TimerLoadSet(uint32_t b, uint32_t t, uint32_t v) {}
+void TimerEnable(uint32_t b, uint32_t t) {}
+void TimerDisable(uint32_t b, uint32_t t) {}
+void TimerIntEnable(uint32_t b, uint32_t f) {}
+void IntEnable(uint32_t i) {}
+
+void UARTprintf(const char * fmt, ...) {
+  va_list ap;
+
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+}
+
+//
+// Read the name and fastest call of every result in a saved run, one result
+// per line as benchRun() prints them. Returns 0 on success.
+//
+static int hostBaseRead(const char * path) {
+  char line[512];
+  const char * p;
+  hostBaseT * b;
+  FILE * f = fopen(path, "r");
+
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), f) && (hostBaseCount < hostMaxBaseline)) {
+    b = &hostBase[hostBaseCount];
+    p = strstr(line, "\"min\":");
+
+    if (!p || (sscanf(line, "{\"name\":\"%31[^\"]\"", b->name) != 1) ||
+        (sscanf(p, "\"min\":%u", &b->min) != 1)) {
+      continue;
+    }
+
+    hostBaseCount++;
+  }
+
+  fclose(f);
+
+  if (!hostBaseCount) {
+    fprintf(stderr, "%s: no results\n", path);
+    return -1;
+  }
+
+  return 0;
+}
+
+// The baseline plus the margin and the slack, 0 for a benchmark not in the
+// baseline
+static uint32_t hostLimit(const char * name) {
+  uint16_t i;
+
+  for (i = 0; i < hostBaseCount; i++) {
+    if (!strcmp(hostBase[i].name, name)) {
+      return (uint32_t) ((uint64_t) hostBase[i].min * (100 + hostMargin) /
+                         100) + hostSlack;
+    }
+  }
+
+  return 0;
+}
+
+static void usage(void) {
+  fprintf(stderr, "Usage: benchhost [-f filter] [-b baseline] "
+                  "[-m percent]\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  const char * filter = 0;
+  const char * base = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:b:m:")) != -1) {
+    switch (opt) {
+    case 'f':
+      filter = optarg;
+      break;
+    case 'b':
+      base = optarg;
+      break;
+    case 'm':
+      hostMargin = strtoul(optarg, 0, 10);
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if (optind != argc) {
+    usage();
+  }
+
+  if (base && hostBaseRead(base)) {
+    return 2;
+  }
+
+  // Without a baseline, no limits at all instead of the ones of the device
+  benchLimit = hostLimit;
+
+  return benchRun(&hostBuf, filter) ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+/*
+ * capmodel.c
+ * Host model of the scatter-gather capture in capture.c
+ *
+ * Usage: capmodel [elements] [seed]
+ *
+ * Builds the task lists with capStart() on a model control table and runs
+ * them the way the uDMA does in peripheral scatter-gather mode: the primary
+ * structure copies one task at a time into the alternate structure, which
+ * then does the transfer. ADC tasks take one sample per request and write a
+ * running sample number. The Timer2 task raises the interrupt, which calls
+ * capRefill() after a random latency. A consumer polls the ring every 64
+ * samples on average and checks it gets every sample exactly once, in order.
+ * A consumer slower than that can fill the ring, which capture.c, like the
+ * ping-pong ISR, answers by stopping.
+ * Also checked: the channel never stops, the uDMA only writes elements it
+ * owns, the refill interrupt comes once per capBlocks elements, and stamps
+ * them after their last sample. Stamps count SYS_CLK cycles as perfNow()
+ * does, one sample period per sample, and wrap the same way.
+ *
+ * Burst mode is checked on the clock: with the timer loads and start offset
+ * capture.c uses, every Timer3 request finds capBurstSize finished samples
+ * in the SS0 FIFO and the FIFO never holds more than 8, for sample rates up
+ * to capBurstMaxRate and request latencies up to a few samples.
+ *
+ * Build (TivaWare headers only, no driverlib library):
+ *   gcc -O2 -std=gnu99 -I.. -I$TIVAWARE -o capmodel capmodel.c
+ *       ../capture.c ../cirbuf.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+#include "global.h"
+#include "irq.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_adc.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_udma.h"
+#include "driverlib/udma.h"
+
+volatile bool bufferOverflow = false;
+volatile uint32_t sysTickCount = 0;
+
+static bufT modelBuf;
+static tDMAControlTable modelTable[64];
+
+//
+// Driver calls made by capture.c. The scatter-gather setup does what
+// driverlib does, the rest has nothing to model.
+//
+void uDMAChannelScatterGatherSet(uint32_t ch, uint32_t count, void * list,
+                                 uint32_t isPeriph) {
+  tDMAControlTable * task = list;
+
+  ch &= 0x1f;
+  modelTable[ch].pvSrcEndAddr = &task[count - 1].ui32Spare;
+  modelTable[ch].pvDstEndAddr = &modelTable[ch | UDMA_ALT_SELECT].ui32Spare;
+  modelTable[ch].ui32Control = UDMA_CHCTL_DSTINC_32 | UDMA_CHCTL_DSTSIZE_32 |
+                               UDMA_CHCTL_SRCINC_32 | UDMA_CHCTL_SRCSIZE_32 |
+                               UDMA_CHCTL_ARBSIZE_4 |
+                               (((count * 4) - 1) << UDMA_CHCTL_XFERSIZE_S) |
+                               (isPeriph ? UDMA_CHCTL_XFERMODE_PER_SG :
+                                           UDMA_CHCTL_XFERMODE_MEM_SG);
+}
+
+void SysCtlPeripheralEnable(uint32_t p) {}
+void SysCtlDelay(uint32_t n) {}
+void ADCSequenceConfigure(uint32_t b, uint32_t s, uint32_t t, uint32_t p) {}
+void ADCSequenceStepConfigure(uint32_t b, uint32_t s, uint32_t i, uint32_t c) {}
+void ADCSequenceDisable(uint32_t b, uint32_t s) {}
+void ADCSequenceOverflowClear(uint32_t b, uint32_t s) {}
+void TimerEnable(uint32_t b, uint32_t t) {}
+void TimerDisable(uint32_t b, uint32_t t) {}
+bool IntMasterDisable(void) { return false; }
+bool IntMasterEnable(void) { return false; }
+void uDMAChannelAssign(uint32_t m) {}
+void uDMAChannelAttributeEnable(uint32_t ch, uint32_t a) {}
+void uDMAChannelAttributeDisable(uint32_t ch, uint32_t a) {}
+void uDMAChannelControlSet(uint32_t ch, uint32_t c) {}
+void TimerConfigure(uint32_t b, uint32_t c) {}
+void TimerLoadSet(uint32_t b, uint32_t t, uint32_t v) {}
+void TimerIntEnable(uint32_t b, uint32_t f) {}
+void TimerIntClear(uint32_t b, uint32_t f) {}
+void IntEnable(uint32_t i) {}
+void IntDisable(uint32_t i) {}
+void uDMAChannelDisable(uint32_t ch) {}
+void perfStatAdd(perfStatT * stat, uint32_t cycles) {}
+uint32_t TimerValueGet(uint32_t b, uint32_t t) { return 0; }
+
+// Nothing is stamped here
+volatile bool irqMeasure = false;
+irqTimingT irqCapture;
+void irqStamp(irqTimingT * t, uint32_t now, uint32_t elapsed,
+              uint32_t period) {}
+
+static uint32_t modelCount(const tDMAControlTable * t) {
+  return ((t->ui32Control & UDMA_CHCTL_XFERSIZE_M) >>
+          UDMA_CHCTL_XFERSIZE_S) + 1;
+}
+
+static uint32_t modelMode(const tDMAControlTable * t) {
+  return t->ui32Control & UDMA_CHCTL_XFERMODE_M;
+}
+
+// Start of a transfer from the end address kept in the control structure
+static void * modelStart(volatile void * end, uint32_t count, uint32_t inc) {
+  return (uint8_t *) end - ((count << inc) - 1);
+}
+
+static void modelFail(const char * what, uint32_t sample) {
+  printf("FAIL at sample %u: %s\n", sample, what);
+  exit(1);
+}
+
+//
+// Run Timer0 and Timer3 as capBurstConfig() and capTimerEnable() set them up
+// for a million samples. Conversions take a microsecond, requests are served
+// up to maxWait cycles late.
+//
+static void modelBurst(uint32_t rate, uint32_t maxWait) {
+  uint64_t period = SYS_CLK / rate + 1;
+  uint64_t burst;
+  uint64_t start = (SYS_CLK / rate / 6) * 3 + rand() % 16;
+  uint64_t convert = SYS_CLK / 1000000;
+  uint64_t read = 0;
+  uint64_t t, done, last;
+
+  capRate = rate;
+  burst = capBurstSize * (SYS_CLK / capRate + 1);
+
+  for (last = 0; read < 1000000; read += capBurstSize) {
+    t = start + (read / capBurstSize + 1) * burst + rand() % (maxWait + 1);
+    if (t < last) {
+      t = last;   // The channel serves one request at a time
+    }
+    last = t;
+
+    // Sample n is triggered at (n + 1) * period and done convert later
+    done = (t >= convert) ? (t - convert) / period : 0;
+    if (done < read + capBurstSize) {
+      printf("FAIL at %u sps: request finds %u of %u samples\n", rate,
+             (uint32_t) (done - read), capBurstSize);
+      exit(1);
+    }
+    if (done - read > 8) {
+      printf("FAIL at %u sps: FIFO overflow, %u samples\n", rate,
+             (uint32_t) (done - read));
+      exit(1);
+    }
+  }
+
+  capRate = ADC_RATE;
+}
+
+int main(int argc, char ** argv) {
+  uint32_t elements = (argc > 1) ? (uint32_t) atoi(argv[1]) : 10000;
+  tDMAControlTable * pri = &modelTable[UDMA_CHANNEL_ADC3];
+  tDMAControlTable * alt = &modelTable[UDMA_CHANNEL_ADC3 | UDMA_ALT_SELECT];
+  tDMAControlTable * task;
+  elementT * elem;
+  int16_t * dst;
+  uint32_t sample = 0;   // Next sample the ADC delivers
+  uint32_t expect = 0;   // Next sample the consumer should see
+  uint32_t consumed = 0;
+  uint32_t interrupts = 0;
+  uint32_t pending = 0;  // Samples until the pended interrupt runs
+  uint32_t period = SYS_CLK / capRate + 1;
+  uint32_t n, i, left;
+  uint8_t maxHeld = 0;
+
+  srand((argc > 2) ? (unsigned) atoi(argv[2]) : 1);
+
+  // Up to 8 - capBurstSize - 1 samples late, the last half sample of margin
+  // goes to the start offset
+  for (i = ADC_RATE; i <= capBurstMaxRate; i += 4000) {
+    modelBurst(i, (8 - capBurstSize - 1) * (SYS_CLK / i));
+  }
+  printf("burst: %u samples per request up to %u sps\n", capBurstSize,
+         capBurstMaxRate);
+
+  bufInit(&modelBuf);
+  capStart(&modelBuf, modelTable);
+
+  while (consumed < elements) {
+    if (modelMode(pri) == UDMA_CHCTL_XFERMODE_STOP) {
+      modelFail("channel stopped", sample);
+    }
+
+    // Primary: copy the next task to the alternate structure
+    left = modelCount(pri) / 4;
+    task = (tDMAControlTable *) ((uint8_t *) pri->pvSrcEndAddr -
+                                 offsetof(tDMAControlTable, ui32Spare)) -
+           (left - 1);
+    *alt = *task;
+    if (left == 1) {
+      pri->ui32Control &= ~(UDMA_CHCTL_XFERSIZE_M | UDMA_CHCTL_XFERMODE_M);
+    }
+    else {
+      pri->ui32Control -= 4 << UDMA_CHCTL_XFERSIZE_S;
+    }
+
+    // Alternate: run the task
+    n = modelCount(alt);
+
+    if (alt->pvSrcEndAddr == (void *) (ADC0_BASE + ADC_O_SSFIFO3)) {
+      if (modelMode(alt) != UDMA_CHCTL_XFERMODE_PER_SGA) {
+        modelFail("ADC task not peripheral scatter-gather", sample);
+      }
+
+      dst = modelStart(alt->pvDstEndAddr, n, 1);
+      for (i = 0; i < bufSize; i++) {
+        if (dst == modelBuf.item[i].data) {
+          break;
+        }
+      }
+      if ((i == bufSize) || (n != elementSize)) {
+        modelFail("ADC task is not one whole element", sample);
+      }
+      if (modelBuf.item[i].status != WRITE) {
+        modelFail("uDMA writes an element it does not own", sample);
+      }
+
+      // One request per sample, the interrupt and the consumer run between
+      for (i = 0; i < n; i++) {
+        dst[i] = (int16_t) sample++;
+
+        if (pending && !--pending) {
+          capRefill(sample * period);
+          interrupts++;
+        }
+
+        if ((rand() % 64) == 0) {
+          while ((elem = bufGet(&modelBuf)) != 0) {
+            for (left = 0; left < elementSize; left++) {
+              if (elem->data[left] != (int16_t) expect++) {
+                modelFail("consumer sees a gap or a repeat", sample);
+              }
+            }
+            if ((int32_t) (elem->stamp - expect * period) < 0) {
+              modelFail("element stamped before its last sample", sample);
+            }
+            bufItemSetFree(&modelBuf, elem->index);
+            consumed++;
+          }
+        }
+      }
+    }
+    else if (alt->pvDstEndAddr == (void *) (TIMER2_BASE + TIMER_O_CTL)) {
+      if (pending) {
+        modelFail("refill interrupt still pending from the last list", sample);
+      }
+
+      // Interrupt latency up to almost a whole list
+      pending = 1 + rand() % (capBlocks * elementSize - 1);
+    }
+    else if (modelStart(alt->pvDstEndAddr, n, 2) == (void *) pri) {
+      // Reload: four words onto the primary structure
+      *pri = *(tDMAControlTable *) modelStart(alt->pvSrcEndAddr, n, 2);
+    }
+    else {
+      modelFail("unknown task", sample);
+    }
+
+    if (modelBuf.count > maxHeld) {
+      maxHeld = modelBuf.count;
+    }
+  }
+
+  printf("%u samples, %u elements consumed in order, %u interrupts "
+         "(%u elements each), ring peak %u of %u\n", sample, consumed,
+         interrupts, capBlocks, maxHeld, bufSize);
+
+  if (interrupts < consumed / capBlocks - 1) {
+    modelFail("too few interrupts", sample);
+  }
+
+  printf("PASS\n");
+  return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * mapsize.c
+ * Build-time RAM and flash report from the map file of the TI linker
+ *
+ * Usage: mapsize [-n objects] [-f bytes] file.map
+ *
+ *   -n objects  Biggest input sections in SRAM to list (20)
+ *   -f bytes    Fail if less SRAM than this is left unused (0)
+ *
+ * Prints the use of each memory range of MEMORY CONFIGURATION, the size of
+ * each output section, and the biggest input sections placed in SRAM, which
+ * with --gen_data_subsections (the CCS default) are single objects such as
+ * ".bss:adcBuf". The last line says how many more ring elements fit in the
+ * SRAM left, which is what the headroom is for. With -f it exits with 1 when
+ * the SRAM left is under the margin, so a post-build step of the CCS project
+ * can stop a build that would not leave enough for it:
+ *
+ *   mapsize -f 512 ${BuildArtifactFileBaseName}.map
+ *
+ * The stack does not show in the map as used, see the "mem" command for how
+ * deep it goes at run time. The element size is elementT as the host lays it
+ * out, the same as the device with 32-bit enums.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -I.. -o mapsize mapsize.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cirbuf.h"
+#include "mem.h"
+
+enum {
+  mapMaxInputs = 4096,
+  mapLine = 512
+};
+
+typedef struct {
+  uint32_t origin;
+  uint32_t length;
+  char name[160]; // Object file and input section
+} mapInputT;
+
+static mapInputT inputs[mapMaxInputs];
+static uint32_t inputCount;
+
+static void mapUsage(void) {
+  printf("usage: mapsize [-n objects] [-f bytes] file.map\n");
+  exit(2);
+}
+
+static int mapBySize(const void * a, const void * b) {
+  const mapInputT * x = a;
+  const mapInputT * y = b;
+
+  return (x->length < y->length) - (x->length > y->length);
+}
+
+static bool mapInSram(uint32_t origin) {
+  return (origin >= MEM_SRAM_BASE) && (origin < MEM_SRAM_BASE + MEM_SRAM_SIZE);
+}
+
+int main(int argc, char ** argv) {
+  char line[mapLine];
+  char name[mapLine];
+  char rest[mapLine];
+  char pending[mapLine] = "";
+  uint32_t origin, length, used, unused, page;
+  uint32_t sramFree = 0;
+  uint32_t margin = 0;
+  uint32_t top = 20;
+  uint32_t i;
+  bool memory = false;
+  bool sections = false;
+  bool sram = false;
+  FILE * f;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:f:")) != -1) {
+    switch (opt) {
+    case 'n':
+      top = (uint32_t) atoi(optarg);
+      break;
+    case 'f':
+      margin = (uint32_t) atoi(optarg);
+      break;
+    default:
+      mapUsage();
+    }
+  }
+  if (optind + 1 != argc) {
+    mapUsage();
+  }
+
+  f = fopen(argv[optind], "r");
+  if (!f) {
+    perror(argv[optind]);
+    return 2;
+  }
+
+  printf("%-24s %10s %10s %10s\n", "memory", "length", "used", "unused");
+
+  while (fgets(line, sizeof(line), f)) {
+    if (strstr(line, "MEMORY CONFIGURATION")) {
+      memory = true;
+      continue;
+    }
+    if (strstr(line, "SECTION ALLOCATION MAP")) {
+      memory = false;
+      sections = true;
+      printf("\n%-24s %10s %10s\n", "section", "origin", "length");
+      continue;
+    }
+
+    // Next part of the map, e.g. MODULE SUMMARY or GLOBAL SYMBOLS
+    if (isupper((unsigned char) line[0])) {
+      if (sections) {
+        break;
+      }
+      if (memory && strncmp(line, "SEGMENT", 7) == 0) {
+        memory = false;
+      }
+      continue;
+    }
+
+    if (memory) {
+      if (sscanf(line, " %255s %x %x %x %x", name, &origin, &length, &used,
+                 &unused) == 5) {
+        printf("%-24s %10u %10u %10u\n", name, length, used, unused);
+        if (origin == MEM_SRAM_BASE) {
+          sram = true;
+          sramFree = unused;
+        }
+      }
+      continue;
+    }
+
+    if (!sections) {
+      continue;
+    }
+
+    // Output section, its numbers on the next line if the name is long
+    if (!isspace((unsigned char) line[0]) || pending[0]) {
+      if (pending[0]) {
+        strcpy(name, pending);
+        strcpy(rest, line);
+        pending[0] = 0;
+      }
+      else if (sscanf(line, "%255s %[^\n]", name, rest) != 2) {
+        if (sscanf(line, "%255s", pending) != 1) {
+          pending[0] = 0;
+        }
+        continue;
+      }
+
+      if (sscanf(rest, "%u %x %x", &page, &origin, &length) == 3) {
+        printf("%-24s   %08x %10u\n", name, origin, length);
+      }
+      continue;
+    }
+
+    // Input section: origin, length, then the object and section names
+    if ((sscanf(line, " %x %x %[^\n]", &origin, &length, rest) == 3) &&
+        mapInSram(origin) && length && (inputCount < mapMaxInputs)) {
+      inputs[inputCount].origin = origin;
+      inputs[inputCount].length = length;
+      snprintf(inputs[inputCount].name, sizeof(inputs[0].name), "%.*s",
+               (int) sizeof(inputs[0].name) - 1, rest);
+      inputCount++;
+    }
+  }
+
+  fclose(f);
+
+  if (!sram) {
+    printf("no SRAM range at %08x in %s\n", MEM_SRAM_BASE, argv[optind]);
+    return 2;
+  }
+
+  qsort(inputs, inputCount, sizeof(mapInputT), mapBySize);
+
+  printf("\n%-56s %10s\n", "biggest in SRAM", "length");
+  for (i = 0; (i < top) && (i < inputCount); i++) {
+    printf("%-56s %10u\n", inputs[i].name, inputs[i].length);
+  }
+
+  printf("\nSRAM unused: %u bytes, %u more ring elements of %u\n", sramFree,
+         (uint32_t) (sramFree / sizeof(elementT)), (uint32_t) sizeof(elementT));
+
+  if (sramFree < margin) {
+    printf("FAIL: under the margin of %u bytes\n", margin);
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * mixcheck.c
+ * Host check of the sums mix.c hands to the DAC
+ *
+ * Usage: mixcheck [-s seed] [-v]
+ *
+ *   -s seed   Random seed (1)
+ *   -v        Show each case
+ *
+ * dacIntHandler() writes (x + 2048) >> 2 to a PWM of period 1023, so every
+ * output of mixKernel() has to stay within mixOutMin to mixOutMax. The cases
+ * are two full scale streams in phase at unity gain and at the largest gain,
+ * the same in opposite phase, one full scale stream alone, and random
+ * streams and gains for 1 to mixKernelMax streams. Each output is checked
+ * against the sum done in 64 bits and clipped to the DAC range. Two full
+ * scale streams also go through mixRun(), in blocks split across the ends
+ * of the stream rings.
+ *
+ * This builds the plain C loop of mixKernel(); the Cortex-M4 one saturates
+ * to the same bounds and gives the same results.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -I.. -o mixcheck mixcheck.c ../mix.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mix.h"
+
+enum {
+  checkSamples = 512,
+  checkRandomRuns = 200
+};
+
+static int16_t in[mixKernelMax][checkSamples];
+static int16_t out[checkSamples];
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static bool verbose;
+static uint32_t cases;
+
+static uint32_t checkRand(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return (uint32_t) (rng >> 32);
+}
+
+static void checkFail(const char * what, uint16_t i, int32_t got,
+                      int32_t want) {
+  printf("FAIL %s at sample %u: %d, expected %d\n", what, i, got, want);
+  exit(1);
+}
+
+// The sum of the products, clipped to the DAC range
+static int32_t checkRef(const int16_t * gain, uint8_t streams, uint16_t i) {
+  int64_t acc = 0;
+  uint8_t s;
+
+  for (s = 0; s < streams; s++) {
+    acc += (int32_t) in[s][i] * gain[s];
+  }
+  acc >>= mixGainBits;
+
+  return (acc > mixOutMax) ? mixOutMax : (acc < mixOutMin) ? mixOutMin : acc;
+}
+
+static void checkKernel(const char * what, const int16_t * gain,
+                        uint8_t streams, uint16_t n) {
+  const int16_t * p[mixKernelMax];
+  int16_t lo = INT16_MAX;
+  int16_t hi = INT16_MIN;
+  uint16_t i;
+  uint8_t s;
+
+  for (s = 0; s < streams; s++) {
+    p[s] = in[s];
+  }
+
+  mixKernel(p, gain, streams, out, n);
+
+  for (i = 0; i < n; i++) {
+    // Also catches any output out of the DAC range
+    if (out[i] != checkRef(gain, streams, i)) {
+      checkFail(what, i, out[i], checkRef(gain, streams, i));
+    }
+    lo = (out[i] < lo) ? out[i] : lo;
+    hi = (out[i] > hi) ? out[i] : hi;
+  }
+
+  cases++;
+  if (verbose) {
+    printf("%-28s streams %u samples %3u out %5d..%d\n", what, streams, n,
+           lo, hi);
+  }
+}
+
+// Full scale square waves, the second one inverted with invert
+static void checkFullScale(bool invert) {
+  uint16_t i;
+
+  for (i = 0; i < checkSamples; i++) {
+    in[0][i] = (i & 8) ? mixOutMax : mixOutMin;
+    in[1][i] = ((i & 8) != invert) ? mixOutMax : mixOutMin;
+  }
+}
+
+//
+// Two full scale streams through the rings of mixRun(), the blocks filled in
+// turn as Cmd_mix does
+//
+static void checkRun(void) {
+  static int16_t arena[mixArenaSamples];
+  mixT m;
+  int16_t * block;
+  uint16_t i, done;
+  uint8_t s;
+
+  mixInit(&m, arena);
+
+  for (done = 0; done < 4 * mixBlock; done += mixBlock / 2) {
+    for (s = 0; s < 2; s++) {
+      while ((block = mixFree(&m, s)) != 0) {
+        for (i = 0; i < mixBlock; i++) {
+          block[i] = (i & 1) ? mixOutMin : mixOutMax;
+        }
+        mixPut(&m, s, mixBlock);
+      }
+      if (!m.stream[s].on) {
+        mixStart(&m, s, mixUnity);
+      }
+    }
+
+    if (mixRun(&m, out, mixBlock / 2) != 2) {
+      checkFail("mixRun streams", done, 0, 2);
+    }
+
+    for (i = 0; i < mixBlock / 2; i++) {
+      if (out[i] != ((i & 1) ? mixOutMin : mixOutMax)) {
+        checkFail("mixRun full scale", done + i, out[i],
+                  (i & 1) ? mixOutMin : mixOutMax);
+      }
+    }
+  }
+
+  cases++;
+  if (verbose) {
+    printf("%-28s streams 2 samples %3u\n", "mixRun full scale", done);
+  }
+}
+
+static void usage(void) {
+  fprintf(stderr, "Usage: mixcheck [-s seed] [-v]\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  int16_t gain[mixKernelMax];
+  uint16_t i, run, n;
+  uint8_t s, streams;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:v")) != -1) {
+    switch (opt) {
+    case 's':
+      rng ^= strtoull(optarg, 0, 0) * 0x2545F4914F6CDD1DULL;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      usage();
+    }
+  }
+
+  checkFullScale(false);
+  gain[0] = mixUnity;
+  gain[1] = mixUnity;
+  checkKernel("full scale in phase", gain, 2, checkSamples);
+  checkKernel("full scale in phase, odd n", gain, 2, checkSamples - 1);
+  gain[0] = INT16_MAX;
+  gain[1] = INT16_MAX;
+  checkKernel("full scale, largest gain", gain, 2, checkSamples);
+
+  checkFullScale(true);
+  gain[0] = mixUnity;
+  gain[1] = mixUnity;
+  checkKernel("full scale opposite phase", gain, 2, checkSamples);
+  checkKernel("full scale alone", gain, 1, checkSamples);
+
+  for (run = 0; run < checkRandomRuns; run++) {
+    streams = 1 + checkRand() % mixKernelMax;
+    n = checkRand() % (checkSamples + 1);
+
+    for (s = 0; s < streams; s++) {
+      gain[s] = checkRand() % (INT16_MAX + 1);
+      for (i = 0; i < checkSamples; i++) {
+        in[s][i] = mixOutMin + checkRand() % (mixOutMax - mixOutMin + 1);
+      }
+    }
+
+    checkKernel("random", gain, streams, n);
+  }
+
+  checkRun();
+
+  printf("%u cases\nPASS\n", cases);
+
+  return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * monmodel.c
+ * Host model of the live monitor of mon.c, its blocks from the capture
+ * through the DAC interrupt and its latency figure
+ *
+ * Usage: monmodel [-k block] [-l lead] [-t s] [-c cycles] [-w us] [-b ms]
+ *                 [-p p] [-g us] [-r] [-s seed] [-v]
+ *
+ *   -k block   Output samples per block (16)
+ *   -l lead    Blocks filtered before the DAC starts (2)
+ *   -t s       Time to run (10)
+ *   -c cycles  Filter cycles per output sample (300)
+ *   -w us      Time to write a sector of the recording (700)
+ *   -b ms      Card busy time a write may take on top (60)
+ *   -p p       Probability a write takes it (0.01)
+ *   -g us      Time a write keeps the CPU without calling mmcIdle (0)
+ *   -r         Record while monitoring
+ *   -s seed    Random seed (1)
+ *   -v         Show the latency of each block
+ *
+ * The ADC converts a sample every SYS_CLK / ADC_RATE + 1 cycles and the
+ * capture interrupt comes a conversion after the last one of a block, when
+ * the block is stamped and passed on in the ring of cirbuf.c. The loop of
+ * Cmd_monitor runs monStep() and monRecWrite() of mon.c, and the real
+ * dacIntHandler() of dac.c runs at each tick of the period monStart() sets.
+ * The filter is not modelled: it costs what -c says, and its output sample
+ * j is ADC sample procDecimation * j + procDecimation - 1 of the block, the
+ * newest one a decimator output holds. While the recording waits for the
+ * card the monitor runs as mmcIdle, as it does on the device; the time FatFs
+ * works on the CPU, which -g sets, delays it, and longer than the lead the
+ * DAC has no block at some ticks.
+ *
+ * Every ADC sample holds the low bits of its index. Checked: the PWM gets
+ * every procDecimation-th sample in order, none twice or skipped, one per
+ * tick but for the gaps monStat counts; each one as long after its
+ * conversion as monStat measured for its block plus the conversion time the
+ * figure leaves out; the recording holds the samples filtered in order, but
+ * for the ones it counts as dropped. Reported: the JSON of monPrint() and the
+ * latency the model saw.
+ *
+ * Build (TivaWare and CMSIS-DSP for the headers, FatFs is modelled):
+ *   gcc -O2 -std=gnu99 -DPERF_HOST -I.. -I$TIVAWARE -I$TIVAWARE/third_party
+ *       -I$CMSIS/DSP/Include -I$CMSIS/Core/Include -o monmodel monmodel.c
+ *       ../mon.c ../dac.c ../cirbuf.c ../perf.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mon.h"
+#include "dac.h"
+#include "proc.h"
+#include "capture.h"
+#include "mmc_dma.h"
+#include "global.h"
+#include "irq.h"
+#include "fatfs/src/ff.h"
+
+enum {
+  modelAdcPeriod = SYS_CLK / ADC_RATE + 1, // What Timer0 counts
+  modelConvCycles = 80,       // A conversion, before the capture interrupt
+  modelStepCycles = 200,      // A turn of the loop besides the monitor
+  modelIdleCycles = 800       // Between two mmcIdle calls of a card wait
+};
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static uint64_t now;          // Cycles
+static uint32_t procCycles, sectorCycles, busyCycles, cpuCycles;
+static double busyChance;
+static bool verbose;
+
+// Globals of sd_card.c and capture.c
+volatile uint16_t dacIndex;
+volatile elementT * dacBuf;
+volatile bufT * gpBuf;
+volatile bool stop;
+uint32_t capRate = ADC_RATE;
+uint16_t capSize = elementSize;
+void (* volatile mmcIdle)(void);
+volatile bool irqMeasure = false;
+irqTimingT irqDac;
+static bufT modelBuf;
+
+// The capture
+static bool capOn;
+static uint64_t capStartAt;     // Trigger of sample 0
+static uint64_t capDone;      // Blocks passed on
+static elementT * capElem[2];   // Ping and pong
+
+// The DAC
+static bool dacOn;
+static uint32_t dacLoad;
+static uint64_t nextTick;
+static uint64_t ticks;
+static bool played;             // Sample output in this tick
+static uint64_t outCount;
+static uint64_t lastK;          // ADC sample of the last one played
+static uint64_t firstTick, lastTick;
+static uint64_t missed;         // Ticks without a sample after the first
+static uint32_t measured;       // Latency monStat took for the block playing
+static uint64_t measuredTotal;
+static uint32_t latMin = UINT32_MAX, latMax;
+
+// The recording
+static int16_t * rec;
+static uint32_t recCount, recMax;
+
+static uint64_t modelRand(void) {
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return rng * 0x2545F4914F6CDD1DULL;
+}
+
+static bool modelChance(double p) {
+  return (p > 0) && ((modelRand() >> 11) * (1.0 / 9007199254740992.0) < p);
+}
+
+static void modelFail(const char * what) {
+  printf("FAIL at tick %llu, %llu samples played: %s\n",
+         (unsigned long long) ticks, (unsigned long long) outCount, what);
+  exit(1);
+}
+
+// Index of the ADC sample whose low bits are x, among the ones converted
+static uint64_t modelIndex(int16_t x) {
+  uint64_t k = (now - capStartAt) / modelAdcPeriod;
+
+  return k - (uint16_t) ((uint16_t) k - (uint16_t) x);
+}
+
+//*****************************************************************************
+//
+// Time, the capture and the DAC
+//
+//*****************************************************************************
+
+uint32_t perfHostNow(void) {
+  return (uint32_t) now;
+}
+
+void UARTprintf(const char * fmt, ...) {
+  va_list ap;
+
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+}
+
+void irqStamp(irqTimingT * t, uint32_t at, uint32_t elapsed,
+              uint32_t period) {}
+bool IntMasterDisable(void) { return false; }
+bool IntMasterEnable(void) { return false; }
+void TimerIntClear(uint32_t b, uint32_t f) {}
+uint32_t TimerValueGet(uint32_t b, uint32_t t) { return 0; }
+void SysCtlPeripheralEnable(uint32_t p) {}
+void GPIOPinConfigure(uint32_t c) {}
+void GPIOPinTypePWM(uint32_t b, uint8_t p) {}
+void PWMGenConfigure(uint32_t b, uint32_t g, uint32_t c) {}
+void PWMGenPeriodSet(uint32_t b, uint32_t g, uint32_t p) {}
+void TimerConfigure(uint32_t b, uint32_t c) {}
+void IntEnable(uint32_t i) {}
+void TimerIntEnable(uint32_t b, uint32_t f) {}
+void PWMGenEnable(uint32_t b, uint32_t g) {}
+void PWMGenDisable(uint32_t b, uint32_t g) {}
+void PWMOutputState(uint32_t b, uint32_t o, bool e) {}
+
+void TimerLoadSet(uint32_t b, uint32_t t, uint32_t v) {
+  dacLoad = v;
+}
+
+void TimerEnable(uint32_t b, uint32_t t) {
+  dacOn = true;
+  nextTick = now + dacLoad + 1;
+}
+
+void TimerDisable(uint32_t b, uint32_t t) {
+  dacOn = false;
+}
+
+//
+// The DAC interrupt outputs dacBuf->data[dacIndex], the ADC sample it comes
+// from is checked for its place and its latency
+//
+void PWMPulseWidthSet(uint32_t b, uint32_t o, uint32_t width) {
+  uint64_t k = modelIndex(dacBuf->data[dacIndex]);
+  uint32_t lat;
+  char text[80];
+
+  played = true;
+
+  // monNext() took the block at the tick before
+  if (!dacIndex) {
+    measured = (uint32_t) (monStat.latency.total - measuredTotal);
+    measuredTotal = monStat.latency.total;
+    if (verbose) {
+      printf("block at tick %llu: %u us\n", (unsigned long long) ticks,
+             (unsigned) (measured / (SYS_CLK / 1000000)));
+    }
+  }
+
+  if (outCount && (k != lastK + procDecimation)) {
+    snprintf(text, sizeof(text), "ADC sample %llu after %llu",
+             (unsigned long long) k, (unsigned long long) lastK);
+    modelFail(text);
+  }
+  if (!outCount && (k != procDecimation - 1)) {
+    modelFail("first sample");
+  }
+
+  lat = (uint32_t) (now - capStartAt - k * modelAdcPeriod);
+  if (lat != measured + modelConvCycles) {
+    snprintf(text, sizeof(text), "latency %u cycles, measured %u", lat,
+             measured);
+    modelFail(text);
+  }
+  latMin = (lat < latMin) ? lat : latMin;
+  latMax = (lat > latMax) ? lat : latMax;
+
+  if (outCount) {
+    missed += ticks - lastTick - 1;
+  }
+  else {
+    firstTick = ticks;
+  }
+
+  lastK = k;
+  lastTick = ticks;
+  outCount++;
+}
+
+//
+// The capture interrupt of a block: stamp it, pass it on and claim the next
+// element for the transfer that just ended, as adcInterruptHandler() does
+//
+static void modelCapture(void) {
+  uint8_t p = capDone % 2;
+  uint64_t first = capDone * capSize;
+  uint16_t i;
+
+  for (i = 0; i < capSize; i++) {
+    capElem[p]->data[i] = (int16_t) (first + i);
+  }
+  capElem[p]->stamp = perfHostNow();
+  bufItemSetFree(gpBuf, capElem[p]->index);
+  capDone++;
+
+  capElem[p] = bufGetFree(gpBuf);
+  if (!capElem[p]) {
+    modelFail("the ring overflowed");
+  }
+}
+
+static uint64_t modelCaptureAt(void) {
+  return capStartAt + ((capDone + 1) * capSize - 1) * modelAdcPeriod +
+         modelConvCycles;
+}
+
+// Let cycles go by, with the interrupts at their times
+static void modelSpend(uint32_t cycles) {
+  uint64_t end = now + cycles;
+  uint64_t cap;
+
+  for (;;) {
+    cap = capOn ? modelCaptureAt() : UINT64_MAX;
+
+    if (dacOn && (nextTick <= end) && (nextTick <= cap)) {
+      now = nextTick;
+      nextTick += dacLoad + 1;
+      ticks++;
+      played = false;
+      dacIntHandler();
+      continue;
+    }
+    if (cap <= end) {
+      now = cap;
+      modelCapture();
+      continue;
+    }
+    break;
+  }
+
+  now = end;
+}
+
+static void modelCapStart(void) {
+  capElem[0] = bufGetFree(gpBuf);
+  capElem[1] = bufGetFree(gpBuf);
+  capDone = 0;
+  capStartAt = now;
+  capOn = true;
+}
+
+//*****************************************************************************
+//
+// The filter and the card
+//
+//*****************************************************************************
+
+void procInitSmall(void) {}
+
+void procSmall(elementT * elem, uint16_t n) {
+  uint16_t j;
+
+  for (j = 0; j < n / procDecimation; j++) {
+    elem->data[j] = elem->data[procDecimation * j + procDecimation - 1];
+  }
+
+  modelSpend(procCycles * (n / procDecimation));
+}
+
+FRESULT f_write(FIL * fp, const void * buff, UINT btw, UINT * bw) {
+  uint32_t wait = (btw + 511) / 512 * sectorCycles;
+
+  if (modelChance(busyChance)) {
+    wait += busyCycles;
+  }
+
+  if (recCount + btw / 2 > recMax) {
+    modelFail("recording too long for the model");
+  }
+  memcpy(rec + recCount, buff, btw);
+  recCount += btw / 2;
+  *bw = btw;
+
+  modelSpend(cpuCycles);
+
+  // The data is in the card's buffer, the monitor goes on meanwhile
+  while (wait) {
+    modelSpend((wait < modelIdleCycles) ? wait : modelIdleCycles);
+    wait -= (wait < modelIdleCycles) ? wait : modelIdleCycles;
+    if (mmcIdle) {
+      mmcIdle();
+    }
+  }
+
+  return FR_OK;
+}
+
+// The recording holds the samples filtered in order, but for the drops
+static void modelCheckRec(void) {
+  uint64_t k, prev = 0;
+  uint64_t skipped = 0;
+  uint32_t i;
+
+  if (recCount != monStat.recSamples) {
+    modelFail("samples written");
+  }
+
+  // Each sample is less than 65536 ADC samples after the one before
+  for (i = 0; i < recCount; i++) {
+    k = prev + (uint16_t) ((uint16_t) rec[i] - (uint16_t) prev);
+    if (i && ((k <= prev) || ((k - prev) % procDecimation))) {
+      modelFail("recording out of order");
+    }
+    skipped += i ? (k - prev) / procDecimation - 1 : k / procDecimation;
+    prev = k;
+  }
+
+  if (skipped != monStat.recDropped) {
+    modelFail("recording drops");
+  }
+  if ((uint64_t) recCount + monStat.recDropped !=
+      (uint64_t) monStat.blocks * (capSize / procDecimation)) {
+    modelFail("samples filtered and recorded");
+  }
+}
+
+static void modelUsage(void) {
+  printf("usage: monmodel [-k block] [-l lead] [-t s] [-c cycles] [-w us] "
+         "[-b ms] [-p p] [-g us] [-r] [-s seed] [-v]\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  static int16_t recBuf[2 * monRecBlock];
+  FIL file;
+  uint32_t block = monBlockDefault;
+  uint32_t lead = monLeadDefault;
+  uint32_t seconds = 10;
+  uint32_t sectorUs = 700, busyMs = 60, cpuUs = 0;
+  bool record = false;
+  uint64_t end;
+  FRESULT res = FR_OK;
+  int opt;
+
+  procCycles = 300;
+  busyChance = 0.01;
+
+  while ((opt = getopt(argc, argv, "k:l:t:c:w:b:p:g:rs:v")) != -1) {
+    switch (opt) {
+    case 'k':
+      block = (uint32_t) atoi(optarg);
+      break;
+    case 'l':
+      lead = (uint32_t) atoi(optarg);
+      break;
+    case 't':
+      seconds = (uint32_t) atoi(optarg);
+      break;
+    case 'c':
+      procCycles = (uint32_t) atoi(optarg);
+      break;
+    case 'w':
+      sectorUs = (uint32_t) atoi(optarg);
+      break;
+    case 'b':
+      busyMs = (uint32_t) atoi(optarg);
+      break;
+    case 'p':
+      busyChance = atof(optarg);
+      break;
+    case 'g':
+      cpuUs = (uint32_t) atoi(optarg);
+      break;
+    case 'r':
+      record = true;
+      break;
+    case 's':
+      rng += (uint64_t) atoll(optarg) * 0x9E3779B97F4A7C15ULL;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      modelUsage();
+    }
+  }
+  if ((block < monBlockMin) || (block > monBlockMax) ||
+      (block & (block - 1)) || (lead < 1) || (lead > monLeadMax)) {
+    modelUsage();
+  }
+
+  sectorCycles = sectorUs * (SYS_CLK / 1000000);
+  busyCycles = busyMs * (SYS_CLK / 1000);
+  cpuCycles = cpuUs * (SYS_CLK / 1000000);
+  recMax = (seconds + 1) * DAC_RATE;
+  rec = malloc(recMax * sizeof(int16_t));
+
+  // Cmd_monitor
+  gpBuf = &modelBuf;
+  bufInit(gpBuf);
+  stop = false;
+  dacSetup();
+  capSize = block * procDecimation;
+  monInit(block, record ? &file : 0, recBuf);
+  if (record) {
+    mmcIdle = monStep;
+  }
+
+  modelCapStart();
+  while (monQueued() < lead) {
+    monStep();
+    modelSpend(modelStepCycles);
+  }
+  monStart();
+
+  end = now + (uint64_t) seconds * SYS_CLK;
+  while (now < end) {
+    monStep();
+
+    if (record) {
+      res = monRecWrite(false);
+      if (res != FR_OK) {
+        break;
+      }
+    }
+
+    modelSpend(modelStepCycles);
+  }
+
+  mmcIdle = 0;
+  capOn = false;
+  monStop();
+  if (record && (res == FR_OK)) {
+    res = monRecWrite(true);
+  }
+  if (res != FR_OK) {
+    modelFail("recording error");
+  }
+
+  monPrint(lead);
+
+  if (!outCount) {
+    modelFail("nothing played");
+  }
+  if (missed != monStat.gaps) {
+    modelFail("gaps");
+  }
+  if (record) {
+    modelCheckRec();
+  }
+
+  printf("%llu samples in %llu ticks, latency %u to %u us with the "
+         "conversion\n", (unsigned long long) outCount,
+         (unsigned long long) (lastTick - firstTick + 1),
+         (unsigned) (latMin / (SYS_CLK / 1000000)),
+         (unsigned) (latMax / (SYS_CLK / 1000000)));
+  printf("PASS\n");
+
+  return 0;
+}
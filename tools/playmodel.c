@@ -0,0 +1,580 @@
+/*
+ * playmodel.c
+ * Host model of the gapless playback of play.c through the DAC interrupt
+ *
+ * Usage: playmodel [-n files] [-o ms] [-r us] [-b ms] [-p p] [-s seed] [-l]
+ *                  [-v]
+ *
+ *   -n files  WAV files to play (40)
+ *   -o ms     Time to open a file (5)
+ *   -r us     Time to read a sector (700)
+ *   -b ms     Card busy time a read may take on top (60)
+ *   -p p      Probability a read takes it (0.01)
+ *   -s seed   Random seed (1)
+ *   -l        Play a playlist file instead of "*.WAV"
+ *   -v        Show each file switch
+ *
+ * Cmd_play runs the steps of play.c in a loop, and dacIntHandler() of dac.c
+ * runs DAC_RATE times a second on the ring between them. Here the time goes
+ * by in the file system calls, which cost what the options say, and the DAC
+ * interrupt runs at each of its ticks in that time. The files are short and
+ * long, some shorter than an element or than the prefetch, with the plain 44
+ * byte header or the sector one of format.c; the directory also has a file
+ * that is not WAV, and the playlist comments and blank lines.
+ *
+ * Every sample of a file is unique to it and its place. Checked: the DAC
+ * plays all samples of all files, in order, with nothing between them, one
+ * per tick from the first to the last, so each switch from a file to the
+ * next is one tick apart; the DAC stops after the end. Reported: the ticks
+ * at each switch, the elements the ring held then, and the files opened
+ * while the ring waited for them (late). Those are the runs of files shorter
+ * than an element, which are opened in the middle of one. With a card slow
+ * enough for the opens and reads to outlast the ring, the DAC runs dry and
+ * the model fails at the tick where it does.
+ *
+ * Build (TivaWare for the headers, FatFs is modelled):
+ *   gcc -O2 -std=gnu99 -DPERF_HOST -I.. -I$TIVAWARE -I$TIVAWARE/third_party
+ *       -o playmodel playmodel.c ../play.c ../dac.c ../cirbuf.c
+ *       ../format.c ../dirlist.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "play.h"
+#include "dac.h"
+#include "format.h"
+#include "global.h"
+#include "irq.h"
+#include "fatfs/src/ff.h"
+
+enum {
+  modelMaxFiles = 256,
+  modelDirSector = 16,         // Directory entries per sector
+  modelTick = SYS_CLK / DAC_RATE,
+  modelStepCycles = 3000       // A turn of the loop besides the card
+};
+
+typedef struct {
+  char name[13];
+  uint8_t * data;
+  uint32_t size;
+  uint32_t first;   // Index of its first sample in the whole list
+  uint32_t samples; // 0 if not a WAV file
+} modelFileT;
+
+static modelFileT files[modelMaxFiles];
+static uint32_t fileCount;
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static uint64_t now;        // Cycles
+static uint64_t nextTick;
+static uint32_t openCycles, sectorCycles, busyCycles;
+static double busyChance;
+static bool verbose;
+
+// The DAC
+volatile uint16_t dacIndex;
+volatile elementT * dacBuf;
+volatile bufT * gpBuf;
+volatile bool stop;
+static bufT modelBuf;
+static bool dacOn;
+static bool played;         // Sample output in this tick
+static uint64_t ticks;
+static uint32_t outCount;   // Samples of the list played
+static uint32_t expected;
+static uint64_t firstTick, lastTick;
+
+// Where the switches from a file to the next one are
+static uint32_t * switchAt; // Sample index of the first sample of each file
+static uint32_t switchCount, switchNext;
+static uint64_t lastSampleTick;
+static int8_t ringMin = bufSize;
+
+volatile bool irqMeasure = false;
+irqTimingT irqDac;
+
+static uint64_t modelRand(void) {
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return rng * 0x2545F4914F6CDD1DULL;
+}
+
+static bool modelChance(double p) {
+  return (p > 0) && ((modelRand() >> 11) * (1.0 / 9007199254740992.0) < p);
+}
+
+static void modelFail(const char * what, uint32_t sample) {
+  printf("FAIL at sample %u, tick %llu: %s\n", sample,
+         (unsigned long long) ticks, what);
+  exit(1);
+}
+
+// The sample i of the list, unique to its file and place
+static int16_t modelSample(uint32_t i) {
+  return (int16_t) ((i * 2654435761u) >> 16);
+}
+
+//*****************************************************************************
+//
+// Time and the DAC
+//
+//*****************************************************************************
+
+uint32_t perfHostNow(void) {
+  return (uint32_t) now;
+}
+
+void irqStamp(irqTimingT * t, uint32_t at, uint32_t elapsed,
+              uint32_t period) {}
+bool IntMasterDisable(void) { return false; }
+bool IntMasterEnable(void) { return false; }
+void TimerIntClear(uint32_t b, uint32_t f) {}
+uint32_t TimerValueGet(uint32_t b, uint32_t t) { return 0; }
+void SysCtlPeripheralEnable(uint32_t p) {}
+void GPIOPinConfigure(uint32_t c) {}
+void GPIOPinTypePWM(uint32_t b, uint8_t p) {}
+void PWMGenConfigure(uint32_t b, uint32_t g, uint32_t c) {}
+void PWMGenPeriodSet(uint32_t b, uint32_t g, uint32_t p) {}
+void TimerConfigure(uint32_t b, uint32_t c) {}
+void TimerLoadSet(uint32_t b, uint32_t t, uint32_t v) {}
+void IntEnable(uint32_t i) {}
+void TimerIntEnable(uint32_t b, uint32_t f) {}
+void PWMGenEnable(uint32_t b, uint32_t g) {}
+void PWMOutputState(uint32_t b, uint32_t o, bool e) {}
+
+void TimerEnable(uint32_t b, uint32_t t) {
+  dacOn = true;
+}
+
+void TimerDisable(uint32_t b, uint32_t t) {
+  dacOn = false;
+}
+
+void PWMGenDisable(uint32_t b, uint32_t g) {}
+
+//
+// The DAC interrupt outputs dacBuf->data[dacIndex], which is checked against
+// the list
+//
+void PWMPulseWidthSet(uint32_t b, uint32_t o, uint32_t width) {
+  int16_t x = dacBuf->data[dacIndex];
+
+  played = true;
+
+  if (outCount >= expected) {
+    if (x) {
+      modelFail("sound after the end of the list", outCount);
+    }
+    return;
+  }
+
+  if (x != modelSample(outCount)) {
+    modelFail("wrong sample", outCount);
+  }
+
+  if (!outCount) {
+    firstTick = ticks;
+  }
+
+  // The first sample of the next file, one tick after the last of the one
+  // before
+  if ((switchNext < switchCount) && (outCount == switchAt[switchNext])) {
+    if (switchNext && (ticks != lastSampleTick + 1)) {
+      modelFail("gap at a file switch", outCount);
+    }
+    if (verbose) {
+      printf("switch %u at tick %llu, %u elements in the ring\n", switchNext,
+             (unsigned long long) ticks, gpBuf->count);
+    }
+    if (switchNext && (gpBuf->count < ringMin)) {
+      ringMin = gpBuf->count;
+    }
+    switchNext++;
+  }
+
+  lastSampleTick = ticks;
+  lastTick = ticks;
+  outCount++;
+}
+
+// Let cycles go by, with the DAC interrupt at each of its ticks
+static void modelSpend(uint32_t cycles) {
+  now += cycles;
+
+  while (nextTick <= now) {
+    nextTick += modelTick;
+    if (!dacOn) {
+      continue;
+    }
+
+    ticks++;
+    played = false;
+    dacIntHandler();
+
+    if (!played && outCount && (outCount < expected)) {
+      modelFail("tick without a sample", outCount);
+    }
+  }
+}
+
+//*****************************************************************************
+//
+// The file system
+//
+//*****************************************************************************
+
+void UARTprintf(const char * fmt, ...) {
+  va_list ap;
+
+  if (!verbose) {
+    return;
+  }
+
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+}
+
+DWORD get_fattime(void) {
+  return ((DWORD) (2026 - 1980) << 25) | (10 << 21) | (19 << 16);
+}
+
+static modelFileT * modelFile(FIL * fp) {
+  return fp->sclust ? &files[fp->sclust - 1] : 0;
+}
+
+FRESULT f_open(FIL * fp, const TCHAR * path, BYTE mode) {
+  const char * name = strrchr(path, '/');
+  uint32_t i;
+
+  memset(fp, 0, sizeof(*fp));
+  name = name ? name + 1 : path;
+
+  if (mode != FA_READ) {
+    return FR_DENIED;
+  }
+
+  modelSpend(openCycles);
+
+  for (i = 0; i < fileCount; i++) {
+    if (!strcasecmp(files[i].name, name)) {
+      fp->sclust = i + 1;
+      fp->fsize = files[i].size;
+      return FR_OK;
+    }
+  }
+
+  return FR_NO_FILE;
+}
+
+FRESULT f_read(FIL * fp, void * buff, UINT btr, UINT * br) {
+  modelFileT * f = modelFile(fp);
+  uint32_t n, first, last;
+
+  *br = 0;
+  if (!f) {
+    return FR_INVALID_OBJECT;
+  }
+
+  n = (fp->fptr < fp->fsize) ? fp->fsize - fp->fptr : 0;
+  if (n > btr) {
+    n = btr;
+  }
+
+  // Sectors read, the one the file keeps in its buffer counts once
+  if (n) {
+    first = fp->fptr / 512;
+    last = (fp->fptr + n - 1) / 512;
+    modelSpend((last - first + 1 - (fp->dsect == first + 1)) * sectorCycles);
+    fp->dsect = last + 1;
+
+    if (modelChance(busyChance)) {
+      modelSpend(busyCycles);
+    }
+
+    memcpy(buff, f->data + fp->fptr, n);
+  }
+
+  fp->fptr += n;
+  *br = n;
+
+  return FR_OK;
+}
+
+FRESULT f_write(FIL * fp, const void * buff, UINT btw, UINT * bw) {
+  *bw = 0;
+  return FR_DENIED;
+}
+
+FRESULT f_lseek(FIL * fp, DWORD ofs) {
+  if (!modelFile(fp)) {
+    return FR_INVALID_OBJECT;
+  }
+
+  fp->fptr = (ofs > fp->fsize) ? fp->fsize : ofs;
+
+  return FR_OK;
+}
+
+FRESULT f_close(FIL * fp) {
+  if (!modelFile(fp)) {
+    return FR_INVALID_OBJECT;
+  }
+
+  fp->sclust = 0;
+
+  return FR_OK;
+}
+
+FRESULT f_opendir(DIR * dj, const TCHAR * path) {
+  if (strcmp(path, "/")) {
+    return FR_NO_PATH;
+  }
+
+  memset(dj, 0, sizeof(*dj));
+
+  return FR_OK;
+}
+
+FRESULT f_readdir(DIR * dj, FILINFO * fno) {
+  modelFileT * f;
+
+  if (!(dj->index % modelDirSector)) {
+    modelSpend(sectorCycles);
+  }
+  if (dj->index >= fileCount) {
+    fno->fname[0] = 0;
+    return FR_OK;
+  }
+
+  f = &files[dj->index++];
+  memset(fno, 0, sizeof(*fno));
+  fno->fsize = f->size;
+  fno->fattrib = AM_ARC;
+  strcpy(fno->fname, f->name);
+
+  return FR_OK;
+}
+
+//*****************************************************************************
+//
+// The files
+//
+//*****************************************************************************
+
+static void modelPut32(uint8_t * p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static modelFileT * modelAdd(const char * name, uint32_t size) {
+  modelFileT * f = &files[fileCount++];
+
+  memset(f, 0, sizeof(*f));
+  strncpy(f->name, name, sizeof(f->name) - 1);
+  f->size = size;
+  f->data = calloc(size ? size : 1, 1);
+  if (!f->data) {
+    modelFail("out of memory", 0);
+  }
+
+  return f;
+}
+
+// A WAV file of samples from the list index first on
+static void modelWav(uint32_t n, uint32_t samples, uint32_t first) {
+  char name[13];
+  uint32_t header = (n % 3) ? WAV_HEADER_SIZE : 44;
+  modelFileT * f;
+  int16_t x;
+  uint32_t i;
+
+  snprintf(name, sizeof(name), "S%04u.WAV", n);
+  f = modelAdd(name, header + samples * 2);
+
+  if (header == WAV_HEADER_SIZE) {
+    wavHeaderFill(f->data, samples * 2);
+  }
+  else {
+    memcpy(f->data, wavHeader, WAV_FMT_SIZE);
+    modelPut32(f->data + 4, 36 + samples * 2);
+    memcpy(f->data + WAV_FMT_SIZE, "data", 4);
+    modelPut32(f->data + WAV_FMT_SIZE + 4, samples * 2);
+  }
+
+  for (i = 0; i < samples; i++) {
+    x = modelSample(first + i);
+    memcpy(f->data + header + i * 2, &x, 2);
+  }
+
+  f->first = first;
+  f->samples = samples;
+}
+
+// Lengths: a few samples, under an element or the prefetch, up to 3s
+static uint32_t modelLength(uint32_t n) {
+  switch (modelRand() % 6) {
+  case 0:
+    return 1 + modelRand() % 40;
+  case 1:
+    return 1 + modelRand() % elementSize;
+  case 2:
+    return 1 + modelRand() % (playAheadBytes / 2 + elementSize);
+  default:
+    return DAC_RATE / 5 + modelRand() % (3 * DAC_RATE);
+  }
+}
+
+static void modelUsage(void) {
+  printf("usage: playmodel [-n files] [-o ms] [-r us] [-b ms] [-p p] "
+         "[-s seed] [-l] [-v]\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  FIL fp0, fp1, list;
+  FIL * fps[2] = { &fp0, &fp1 };
+  DIR dir;
+  FILINFO info;
+  static uint32_t ahead[playAheadBytes / 4];
+  char text[64];
+  uint32_t count = 40;
+  uint32_t openMs = 5, sectorUs = 700, busyMs = 60;
+  uint32_t i, len;
+  uint32_t first = 0;
+  bool playlist = false;
+  modelFileT * lst = 0;
+  playT play;
+  FRESULT res;
+  int opt;
+
+  busyChance = 0.01;
+
+  while ((opt = getopt(argc, argv, "n:o:r:b:p:s:lv")) != -1) {
+    switch (opt) {
+    case 'n':
+      count = (uint32_t) atoi(optarg);
+      break;
+    case 'o':
+      openMs = (uint32_t) atoi(optarg);
+      break;
+    case 'r':
+      sectorUs = (uint32_t) atoi(optarg);
+      break;
+    case 'b':
+      busyMs = (uint32_t) atoi(optarg);
+      break;
+    case 'p':
+      busyChance = atof(optarg);
+      break;
+    case 's':
+      rng += (uint64_t) atoll(optarg) * 0x9E3779B97F4A7C15ULL;
+      break;
+    case 'l':
+      playlist = true;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      modelUsage();
+    }
+  }
+  if ((count < 1) || (count > modelMaxFiles - 3)) {
+    modelUsage();
+  }
+
+  openCycles = openMs * (SYS_CLK / 1000);
+  sectorCycles = sectorUs * (SYS_CLK / 1000000);
+  busyCycles = busyMs * (SYS_CLK / 1000);
+
+  // The files, with one that is not WAV among them
+  switchAt = calloc(count, sizeof(uint32_t));
+  for (i = 0; i < count; i++) {
+    if (i == count / 2) {
+      lst = modelAdd("NOTES.WAV", 100);
+      memset(lst->data, 'x', 100);
+    }
+    len = modelLength(i);
+    switchAt[i] = first;
+    modelWav(i, len, first);
+    first += len;
+  }
+  expected = first;
+  switchCount = count;
+
+  if (playlist) {
+    lst = modelAdd("PLAY.LST", 0);
+    free(lst->data);
+    lst->data = malloc(count * 32 + 64);
+    len = sprintf((char *) lst->data, "# model playlist\r\n\r\n");
+    for (i = 0; i < fileCount - 1; i++) {
+      len += sprintf((char *) lst->data + len, (i % 4) ? "%s\n" : "  /%s \r\n",
+                     files[i].name);
+    }
+    lst->size = len;
+  }
+
+  // Cmd_play
+  gpBuf = &modelBuf;
+  bufInit(gpBuf);
+  stop = false;
+  dacSetup();
+
+  res = playInit(&play, playlist ? "PLAY.LST" : "*.WAV", "/", fps, &list, &dir,
+                 &info, (uint8_t *) ahead);
+  if (res == FR_OK) {
+    dacIndex = 0;
+    dacBuf = 0;
+    dacEnable();
+  }
+
+  while ((res == FR_OK) && !play.done) {
+    res = playStep(&play, gpBuf);
+    modelSpend(modelStepCycles);
+  }
+  stop = true;
+  playClose(&play);
+
+  if (res != FR_OK) {
+    modelFail("play error", outCount);
+  }
+
+  // The DAC plays the ring out
+  for (i = 0; dacOn && (i < 10 * DAC_RATE); i++) {
+    modelSpend(modelTick);
+  }
+
+  if (dacOn) {
+    modelFail("the DAC did not stop", outCount);
+  }
+  if (outCount != expected) {
+    snprintf(text, sizeof(text), "%u of %u samples played", outCount,
+             expected);
+    modelFail(text, outCount);
+  }
+  if (play.files != count) {
+    modelFail("files played", outCount);
+  }
+  if (lastTick - firstTick + 1 != expected) {
+    modelFail("samples not one per tick", outCount);
+  }
+
+  printf("%u files, %u samples in %llu ticks, %u switches, %u skipped\n",
+         play.files, expected, (unsigned long long) (lastTick - firstTick + 1),
+         switchNext - 1, play.skipped);
+  printf("ring at a switch: %d elements at least, %u files late\n", ringMin,
+         play.late);
+  printf("PASS\n");
+
+  return 0;
+}
@@ -0,0 +1,703 @@
+/*
+ * recmodel.c
+ * Host model of recordings cut off by a reset, and of their recovery
+ *
+ * Usage: recmodel [-n files] [-p p] [-r p] [-s seed] [-u] [-v]
+ *
+ *   -n files  Recordings to make (400)
+ *   -p p      Probability a recording is cut off by a reset (0.5)
+ *   -r p      Probability a recovery is cut off by a reset too (0.2)
+ *   -s seed   Random seed (1)
+ *   -u        Sync the index first, and sometimes in the middle of a block
+ *   -v        Show what the recovery prints
+ *
+ * A recorder does what Cmd_nano does to the files, with recover.c, tsidx.c
+ * and dirlist.c: REC*.WAV is marked, gets a header and 1 KB blocks with
+ * their index entries, is synced every recoverSyncBlocks blocks and finished
+ * with its header, index and mark. The power goes at a random file system
+ * operation. The next boot runs recoverDir() on the directory like main
+ * does, and may lose its power too, in which case the one after it goes on.
+ * Cmd_nano syncs whole blocks and the WAV file before its index. With -u the
+ * recovery also has partial blocks and index entries past the samples to
+ * cut, as from a writer that does not.
+ *
+ * The file system is a model of what FatFs leaves on the card. The size in
+ * a directory entry changes when the file is synced or closed, attributes
+ * when they are set. Data goes to the card as it is written. A file keeps
+ * the last sector it read, as the FIL buffer does. Sectors are counted
+ * apart for the directory and for the contents of files.
+ *
+ * Checked after each boot: no recording is left marked, and the one cut off
+ * has a header with its size, whole blocks of the samples written, at most
+ * recoverSyncBlocks + 1 of them lost, index entries only for blocks in the
+ * file, and an entry in DIRIDX_NAME. The contents read to recover a file
+ * stay under a few sectors whatever its length. At the end a check of every
+ * header finds nothing to fix.
+ *
+ * Build (TivaWare and CMSIS-DSP for the headers, FatFs is modelled):
+ *   gcc -O2 -std=gnu99 -I.. -I$TIVAWARE -I$TIVAWARE/third_party
+ *       -I$CMSIS/DSP/Include -I$CMSIS/Core/Include -o recmodel recmodel.c
+ *       ../recover.c ../tsidx.c ../dirlist.c ../format.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "format.h"
+#include "recover.h"
+#include "tsidx.h"
+#include "dirlist.h"
+#include "fatfs/src/ff.h"
+
+enum {
+  modelMaxFiles = 2048,
+  modelDirSector = 16,  // Directory entries per sector
+  modelMinBlocks = 4,
+  modelMaxBlocks = 120, // A recording is up to ~8s
+  modelMaxContent = 8   // Content sectors read to recover one file
+};
+
+typedef struct {
+  char name[13];
+  uint8_t attrib;
+  uint32_t size;     // In the directory entry
+  uint8_t * data;    // On the card, also past size
+  uint32_t cap;
+} modelFileT;
+
+static modelFileT files[modelMaxFiles];
+static uint32_t fileCount;
+
+static uint32_t opsLeft; // File system operations until the power goes
+static bool powerLost;
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static bool verbose;
+static bool unordered;
+
+static struct {
+  uint32_t dirSectors;
+  uint32_t readSectors;
+  uint32_t writeSectors;
+} io;
+
+static uint64_t modelRand(void) {
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return rng * 0x2545F4914F6CDD1DULL;
+}
+
+static bool modelChance(double p) {
+  return (p > 0) && ((modelRand() >> 11) * (1.0 / 9007199254740992.0) < p);
+}
+
+static void modelFail(const char * what, const char * name) {
+  printf("FAIL: %s: %s\n", name, what);
+  exit(1);
+}
+
+//*****************************************************************************
+//
+// The file system
+//
+//*****************************************************************************
+
+void UARTprintf(const char * fmt, ...) {
+  va_list ap;
+
+  if (!verbose) {
+    return;
+  }
+
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+}
+
+DWORD get_fattime(void) {
+  return ((DWORD) (2026 - 1980) << 25) | (10 << 21) | (19 << 16);
+}
+
+//
+// The next operation that changes the card, false once the power is gone
+//
+static bool modelOp(void) {
+  if (powerLost) {
+    return false;
+  }
+  if (opsLeft && !--opsLeft) {
+    powerLost = true;
+    return false;
+  }
+
+  return true;
+}
+
+// Look a name up, reading the directory up to it
+static int32_t modelFind(const TCHAR * path) {
+  const char * name = strrchr(path, '/');
+  uint32_t i;
+
+  name = name ? name + 1 : path;
+
+  for (i = 0; i < fileCount; i++) {
+    if (!(i % modelDirSector)) {
+      io.dirSectors++;
+    }
+    if (!strcasecmp(files[i].name, name)) {
+      return (int32_t) i;
+    }
+  }
+
+  return -1;
+}
+
+static modelFileT * modelFile(FIL * fp) {
+  return fp->sclust ? &files[fp->sclust - 1] : 0;
+}
+
+static void modelGrow(modelFileT * f, uint32_t size) {
+  if (size > f->cap) {
+    f->cap = size + 64 * 1024;
+    f->data = realloc(f->data, f->cap);
+    if (!f->data) {
+      modelFail("out of memory", f->name);
+    }
+  }
+}
+
+// Sectors of a transfer, the one the file keeps counts once
+static uint32_t modelSectors(FIL * fp, uint32_t pos, uint32_t n) {
+  uint32_t first = pos / 512;
+  uint32_t last = (pos + n - 1) / 512;
+  uint32_t count = last - first + 1;
+
+  if (fp->dsect == first + 1) {
+    count--;
+  }
+  fp->dsect = last + 1;
+
+  return count;
+}
+
+FRESULT f_open(FIL * fp, const TCHAR * path, BYTE mode) {
+  const char * name = strrchr(path, '/');
+  int32_t i = modelFind(path);
+  modelFileT * f;
+
+  memset(fp, 0, sizeof(*fp));
+  name = name ? name + 1 : path;
+
+  if (i < 0) {
+    if (!(mode & (FA_CREATE_NEW | FA_CREATE_ALWAYS | FA_OPEN_ALWAYS))) {
+      return FR_NO_FILE;
+    }
+    if (fileCount == modelMaxFiles) {
+      return FR_DENIED;
+    }
+    if (!modelOp()) {
+      return FR_DISK_ERR;
+    }
+
+    i = (int32_t) fileCount++;
+    f = &files[i];
+    memset(f, 0, sizeof(*f));
+    strncpy(f->name, name, sizeof(f->name) - 1);
+    f->attrib = AM_ARC;
+    io.writeSectors++;
+  }
+  else if (mode & FA_CREATE_NEW) {
+    return FR_EXIST;
+  }
+  else if (mode & FA_CREATE_ALWAYS) {
+    if (!modelOp()) {
+      return FR_DISK_ERR;
+    }
+    files[i].size = 0;
+    io.writeSectors++;
+  }
+
+  fp->sclust = (DWORD) i + 1;
+  fp->flag = mode;
+  fp->fsize = files[i].size;
+  fp->fptr = 0;
+
+  return FR_OK;
+}
+
+FRESULT f_read(FIL * fp, void * buff, UINT btr, UINT * br) {
+  modelFileT * f = modelFile(fp);
+  uint32_t n;
+
+  *br = 0;
+  if (!f) {
+    return FR_INVALID_OBJECT;
+  }
+
+  n = (fp->fptr < fp->fsize) ? fp->fsize - fp->fptr : 0;
+  if (n > btr) {
+    n = btr;
+  }
+  if (n) {
+    io.readSectors += modelSectors(fp, fp->fptr, n);
+    memcpy(buff, f->data + fp->fptr, n);
+  }
+
+  fp->fptr += n;
+  *br = n;
+
+  return FR_OK;
+}
+
+FRESULT f_write(FIL * fp, const void * buff, UINT btw, UINT * bw) {
+  modelFileT * f = modelFile(fp);
+
+  *bw = 0;
+  if (!f || !(fp->flag & FA_WRITE)) {
+    return FR_DENIED;
+  }
+  if (!modelOp()) {
+    return FR_DISK_ERR;
+  }
+
+  modelGrow(f, fp->fptr + btw);
+  memcpy(f->data + fp->fptr, buff, btw);
+  io.writeSectors += modelSectors(fp, fp->fptr, btw);
+
+  fp->fptr += btw;
+  if (fp->fptr > fp->fsize) {
+    fp->fsize = fp->fptr;
+  }
+  *bw = btw;
+
+  return FR_OK;
+}
+
+FRESULT f_lseek(FIL * fp, DWORD ofs) {
+  modelFileT * f = modelFile(fp);
+
+  if (!f) {
+    return FR_INVALID_OBJECT;
+  }
+
+  // Writing past the end allocates, reading stops at it
+  if (ofs > fp->fsize) {
+    if (!(fp->flag & FA_WRITE)) {
+      ofs = fp->fsize;
+    }
+    else {
+      modelGrow(f, ofs);
+      fp->fsize = ofs;
+    }
+  }
+  fp->fptr = ofs;
+
+  return FR_OK;
+}
+
+FRESULT f_truncate(FIL * fp) {
+  if (!modelFile(fp) || !(fp->flag & FA_WRITE)) {
+    return FR_DENIED;
+  }
+  if (!modelOp()) {
+    return FR_DISK_ERR;
+  }
+
+  fp->fsize = fp->fptr;
+
+  return FR_OK;
+}
+
+FRESULT f_sync(FIL * fp) {
+  modelFileT * f = modelFile(fp);
+
+  if (!f) {
+    return FR_INVALID_OBJECT;
+  }
+  if (!(fp->flag & FA_WRITE)) {
+    return FR_OK;
+  }
+  if (!modelOp()) {
+    return FR_DISK_ERR;
+  }
+
+  // The directory entry and the FAT
+  f->size = fp->fsize;
+  f->attrib |= AM_ARC;
+  io.writeSectors += 2;
+
+  return FR_OK;
+}
+
+FRESULT f_close(FIL * fp) {
+  FRESULT res = f_sync(fp);
+
+  fp->sclust = 0;
+
+  return res;
+}
+
+FRESULT f_opendir(DIR * dj, const TCHAR * path) {
+  if (strcmp(path, "/")) {
+    return FR_NO_PATH;
+  }
+
+  memset(dj, 0, sizeof(*dj));
+
+  return FR_OK;
+}
+
+FRESULT f_readdir(DIR * dj, FILINFO * fno) {
+  modelFileT * f;
+
+  if (!(dj->index % modelDirSector)) {
+    io.dirSectors++;
+  }
+  if (dj->index >= fileCount) {
+    fno->fname[0] = 0;
+    return FR_OK;
+  }
+
+  f = &files[dj->index++];
+  memset(fno, 0, sizeof(*fno));
+  fno->fsize = f->size;
+  fno->fattrib = f->attrib;
+  strcpy(fno->fname, f->name);
+
+  return FR_OK;
+}
+
+FRESULT f_chmod(const TCHAR * path, BYTE value, BYTE mask) {
+  int32_t i = modelFind(path);
+
+  if (i < 0) {
+    return FR_NO_FILE;
+  }
+  if (!modelOp()) {
+    return FR_DISK_ERR;
+  }
+
+  files[i].attrib = (files[i].attrib & ~mask) | (value & mask);
+  io.writeSectors++;
+
+  return FR_OK;
+}
+
+//*****************************************************************************
+//
+// Recorder and checks
+//
+//*****************************************************************************
+
+static void modelFillBlock(uint8_t * data, uint32_t file, uint32_t block) {
+  uint32_t i;
+
+  for (i = 0; i < recoverBlockBytes; i += 4) {
+    data[i] = file;
+    data[i + 1] = file >> 8;
+    data[i + 2] = block;
+    data[i + 3] = i >> 2;
+  }
+}
+
+//
+// Cmd_nano on a file, up to blocks blocks or the loss of power. Returns the
+// blocks it wrote.
+//
+static uint32_t modelRecord(const char * path, uint32_t file,
+                            uint32_t blocks) {
+  static FIL wav, idxFil;
+  static tsIdxT ts;
+  static uint8_t head[WAV_HEADER_SIZE];
+  static uint8_t data[recoverBlockBytes];
+  uint32_t written = 0, synced = 0;
+  bool half;
+  UINT bw;
+
+  if ((f_open(&wav, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) ||
+      (recoverMark(path, true) != FR_OK) ||
+      (tsOpen(&ts, path, 8000, 16000) != FR_OK)) {
+    return 0;
+  }
+
+  wavHeaderFill(head, 0);
+  if (f_write(&wav, head, WAV_HEADER_SIZE, &bw) != FR_OK) {
+    return 0;
+  }
+
+  while (written < blocks) {
+    tsStamp(&ts, written, written * 5120000, written * 64 / 10);
+    if (tsAdd(&ts, written, WAV_HEADER_SIZE + written * recoverBlockBytes) !=
+        FR_OK) {
+      return written;
+    }
+
+    // Unordered, both files are sometimes synced in the middle of a block
+    modelFillBlock(data, file, written);
+    half = unordered && modelChance(0.1);
+    if ((f_write(&wav, data, half ? recoverBlockBytes / 2 : recoverBlockBytes,
+                 &bw) != FR_OK) ||
+        (half && ((tsSync(&ts) != FR_OK) || (f_sync(&wav) != FR_OK) ||
+                  (f_write(&wav, data + recoverBlockBytes / 2,
+                           recoverBlockBytes / 2, &bw) != FR_OK)))) {
+      return written;
+    }
+    written++;
+
+    if (written - synced >= recoverSyncBlocks) {
+      if (unordered ? (tsSync(&ts) != FR_OK) || (f_sync(&wav) != FR_OK) :
+                      (f_sync(&wav) != FR_OK) || (tsSync(&ts) != FR_OK)) {
+        return written;
+      }
+      synced = written;
+    }
+  }
+
+  wavHeaderFill(head, written * recoverBlockBytes);
+  if ((f_lseek(&wav, 0) != FR_OK) ||
+      (f_write(&wav, head, WAV_HEADER_SIZE, &bw) != FR_OK) ||
+      (f_close(&wav) != FR_OK) || (tsClose(&ts) != FR_OK) ||
+      (dirIndexAdd(&idxFil, path, WAV_HEADER_SIZE + written *
+                   recoverBlockBytes) != FR_OK)) {
+    return written;
+  }
+  recoverMark(path, false);
+
+  return written;
+}
+
+static void modelCheckIndex(const char * path, uint32_t wavSize,
+                            uint32_t blocks) {
+  static FIL idx;
+  char name[80];
+  tsHeaderT head;
+  tsEntryT e;
+  uint32_t n, i;
+  UINT br;
+
+  tsIndexName(name, path);
+  if (f_open(&idx, name, FA_READ) != FR_OK) {
+    return;
+  }
+
+  n = (f_size(&idx) > sizeof(head)) ?
+      (f_size(&idx) - sizeof(head)) / sizeof(e) : 0;
+  if ((f_size(&idx) > sizeof(head)) &&
+      (f_size(&idx) != sizeof(head) + n * sizeof(e))) {
+    modelFail("part of an index entry left", name);
+  }
+  if (n + recoverSyncBlocks < blocks) {
+    modelFail("index lost more than a sync", name);
+  }
+
+  f_read(&idx, &head, sizeof(head), &br);
+  if (n && (head.magic != TSIDX_MAGIC)) {
+    modelFail("index header not synced", name);
+  }
+
+  for (i = 0; i < n; i++) {
+    f_read(&idx, &e, sizeof(e), &br);
+    if ((e.block != i) || (e.offset + recoverBlockBytes > wavSize)) {
+      modelFail("index entry past the samples", name);
+    }
+  }
+
+  f_close(&idx);
+}
+
+static bool modelInIndex(const char * path, uint32_t size) {
+  static FIL idx;
+  dirEntryT e;
+  uint32_t n;
+  UINT br;
+
+  if (f_open(&idx, "/" DIRIDX_NAME, FA_READ) != FR_OK) {
+    return false;
+  }
+
+  // The newest entries are at the end
+  n = f_size(&idx) / sizeof(e);
+  while (n--) {
+    f_lseek(&idx, n * sizeof(e));
+    f_read(&idx, &e, sizeof(e), &br);
+    if (!strcasecmp(e.name, path + 1)) {
+      f_close(&idx);
+      return e.size == size;
+    }
+  }
+
+  f_close(&idx);
+
+  return false;
+}
+
+//
+// A recording cut off after written blocks, recovered
+//
+static void modelCheck(const char * path, uint32_t file, uint32_t written) {
+  static FIL wav;
+  static uint8_t head[WAV_HEADER_SIZE];
+  static uint8_t data[recoverBlockBytes], expect[recoverBlockBytes];
+  uint32_t offset, dataSize, blocks, b;
+  int32_t i = modelFind(path);
+  UINT br;
+
+  // Cut off before it was marked, nothing was recorded
+  if ((i < 0) || (!files[i].size && !(files[i].attrib & RECOVER_MARK))) {
+    return;
+  }
+  if (files[i].attrib & RECOVER_MARK) {
+    modelFail("still marked", path);
+  }
+
+  f_open(&wav, path, FA_READ);
+  f_read(&wav, head, WAV_HEADER_SIZE, &br);
+  offset = wavDataOffset(head, br, &dataSize);
+  if ((offset != WAV_HEADER_SIZE) ||
+      (dataSize != f_size(&wav) - WAV_HEADER_SIZE) ||
+      (dataSize % recoverBlockBytes) ||
+      (head[4] + (head[5] << 8) + (head[6] << 16) + (head[7] << 24) !=
+       f_size(&wav) - 8)) {
+    modelFail("header does not match the size", path);
+  }
+
+  blocks = dataSize / recoverBlockBytes;
+  if ((blocks > written) || (blocks + recoverSyncBlocks + 1 < written)) {
+    modelFail("lost more than a sync of samples", path);
+  }
+
+  for (b = 0; b < blocks; b++) {
+    f_read(&wav, data, sizeof(data), &br);
+    modelFillBlock(expect, file, b);
+    if (memcmp(data, expect, sizeof(data))) {
+      modelFail("samples read back wrong", path);
+    }
+  }
+  f_close(&wav);
+
+  modelCheckIndex(path, WAV_HEADER_SIZE + dataSize, blocks);
+
+  if (!modelInIndex(path, WAV_HEADER_SIZE + dataSize)) {
+    modelFail("not in " DIRIDX_NAME, path);
+  }
+}
+
+static void modelUsage(void) {
+  printf("usage: recmodel [-n files] [-p p] [-r p] [-s seed] [-u] [-v]\n");
+  exit(2);
+}
+
+int main(int argc, char ** argv) {
+  static DIR dir;
+  static FILINFO info;
+  static FIL fil;
+  static uint8_t sector[WAV_HEADER_SIZE];
+  recoverStatT st;
+  uint32_t n = 400;
+  double cutRecord = 0.5, cutRecover = 0.2;
+  uint32_t i, blocks, written, content;
+  uint32_t cuts = 0, boots = 0, fixed = 0, cutBoots = 0;
+  uint32_t maxContent = 0, maxDir = 0;
+  char path[20];
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:p:r:s:uv")) != -1) {
+    switch (opt) {
+    case 'n':
+      n = (uint32_t) atoi(optarg);
+      break;
+    case 'p':
+      cutRecord = atof(optarg);
+      break;
+    case 'r':
+      cutRecover = atof(optarg);
+      break;
+    case 's':
+      rng ^= strtoull(optarg, 0, 0) * 0xBF58476D1CE4E5B9ULL;
+      break;
+    case 'u':
+      unordered = true;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      modelUsage();
+    }
+  }
+  // A WAV and an index file per recording, and DIRIDX_NAME
+  if ((optind != argc) || (2 * n + 1 > modelMaxFiles)) {
+    modelUsage();
+  }
+
+  for (i = 0; i < n; i++) {
+    snprintf(path, sizeof(path), "/REC%05u.WAV", i);
+    blocks = modelMinBlocks + modelRand() % (modelMaxBlocks - modelMinBlocks);
+
+    // About 2 operations per block, and a few to open and close
+    opsLeft = modelChance(cutRecord) ?
+              1 + modelRand() % (2 * blocks + 2 * blocks / recoverSyncBlocks +
+                                 12) : 0;
+    written = modelRecord(path, i, blocks);
+
+    if (!powerLost) {
+      opsLeft = 0;
+      if (written != blocks) {
+        modelFail("recording failed", path);
+      }
+      continue;
+    }
+
+    // Boot, until a recovery gets through
+    cuts++;
+    do {
+      powerLost = false;
+      opsLeft = modelChance(cutRecover) ? 1 + modelRand() % 12 : 0;
+      memset(&io, 0, sizeof(io));
+
+      recoverDir(&dir, &info, &fil, "/", false, sector, &st);
+      boots++;
+      cutBoots += powerLost;
+
+      if (io.dirSectors > maxDir) {
+        maxDir = io.dirSectors;
+      }
+    } while (powerLost);
+    opsLeft = 0;
+
+    content = io.readSectors;
+    if (content > maxContent) {
+      maxContent = content;
+    }
+    if (content > modelMaxContent) {
+      modelFail("too much of the file read", path);
+    }
+
+    fixed += st.fixed;
+    modelCheck(path, i, written);
+  }
+
+  // Nothing left to fix anywhere
+  memset(&io, 0, sizeof(io));
+  recoverDir(&dir, &info, &fil, "/", true, sector, &st);
+  if (st.fixed || (st.files != st.checked)) {
+    printf("FAIL: %u headers fixed by the full check\n", st.fixed);
+    return 1;
+  }
+
+  printf("record: %u files, %u cut off\n", n, cuts);
+  printf("recover: %u boots, %u of them cut off, %u files fixed\n", boots,
+         cutBoots, fixed);
+  printf("recover: at most %u content sectors per file, %u directory "
+         "sectors per boot\n", maxContent, maxDir);
+  printf("check: %u headers, %u content sectors\n", st.checked,
+         io.readSectors);
+  printf("PASS\n");
+
+  return 0;
+}
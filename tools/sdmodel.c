@@ -0,0 +1,1003 @@
+/*
+ * sdmodel.c
+ * Host model of an SD card in SPI mode under the disk layer of the device
+ *
+ * Usage: sdmodel [-s seed] [-t seconds] [-c cycles] [-p] [-v]
+ *                [-l what=min,max] [-e what=p] card.img
+ *
+ *   -s seed        Random seed, a run is repeatable for the same options (1)
+ *   -t seconds     Length of the recording (60)
+ *   -c cycles      Filter cycles per ADC element (90000)
+ *   -p             Polled block transfers instead of the uDMA
+ *   -v             SDSC card with byte addresses instead of SDHC
+ *   -l what=min,max
+ *                  Latency in us, uniform between min and max. what is cmd
+ *                  (to the R1 response), read (to the data token), write
+ *                  (busy after each block) or stop (busy after the stop
+ *                  token of a multiple block write). CMD12 takes cmd.
+ *   -l stall=p,ms  A write busy takes ms instead with probability p, like a
+ *                  card that erases or moves blocks in the middle of a file
+ *   -e what=p      Error injected with probability p: cmd (no response),
+ *                  read (error token instead of a block) or write (CRC error
+ *                  in the data response)
+ *
+ * The image is a FAT volume of a multiple of 512 KB, made with, e.g.,
+ * "mkfs.vfat -C card.img 65536". The card answers CMD0, CMD8, CMD9, CMD10,
+ * CMD12, CMD16, CMD17, CMD18, CMD24, CMD25, CMD55, CMD58, ACMD23 and ACMD41
+ * byte by byte, with busy signalling and data tokens, out of the image.
+ *
+ * mmc_dma.c runs on top of it unchanged, under FatFs. A writer does what
+ * Cmd_nano does: REC.WAV gets a header and a 1 KB block per four ADC
+ * elements, REC.IDX a 20 byte entry per block, and both headers are written
+ * again at the end. With the uDMA the filter runs in mmcIdle while the card
+ * is busy, one element ahead, as nanoIdle() does. REC.WAV is then read back
+ * and checked.
+ *
+ * Time is virtual. An SPI byte takes 8 bit times at the rate the driver set
+ * with SSIConfigSetExpClk(), a uDMA block as many bytes, the filter a fixed
+ * number of cycles. The disk timers tick every 10ms of it, so the driver
+ * timeouts work as on the device. ADC elements come every 512 samples at
+ * ADC_RATE into bufSize elements, two of them held by the ping-pong uDMA.
+ * An element that finds the ring full is lost, where the device stops.
+ *
+ * Build (TivaWare for the driverlib headers and FatFs, no driverlib library):
+ *   gcc -O2 -std=gnu99 -DPERF_HOST -I.. -I$TIVAWARE -I$TIVAWARE/third_party
+ *       -o sdmodel sdmodel.c ../mmc_dma.c ../format.c
+ *       $TIVAWARE/third_party/fatfs/src/ff.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "global.h"
+#include "cirbuf.h"
+#include "format.h"
+#include "mmc_dma.h"
+#include "perf.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/ssi.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
+#include "fatfs/src/ff.h"
+#include "fatfs/src/diskio.h"
+
+#define MODEL_CS       GPIO_PIN_3 // SDC_CS of mmc_dma.c
+#define MODEL_US       (SYS_CLK / 1000000)
+
+enum {
+  modelElements = 4,     // ADC elements per WAV block, vadElements
+  modelBlockSize = 1024, // WAV bytes per block
+  modelIdxHead = 32,     // sizeof(tsHeaderT)
+  modelIdxEntry = 20,    // sizeof(tsEntryT)
+  modelHeld = 2          // Ring elements owned by the ping-pong uDMA
+};
+
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+} modelLatT;
+
+typedef enum {
+  wrNone,
+  wrToken, // Waiting for a start or stop token
+  wrData   // Receiving a block and its CRC
+} modelWrT;
+
+//
+// Options
+//
+static modelLatT latCmd = { 1, 5 };
+static modelLatT latRead = { 100, 400 };
+static modelLatT latWrite = { 250, 1000 };
+static modelLatT latStop = { 50, 500 };
+static double stallP = 0;
+static uint32_t stallMs = 250;
+static double errCmd = 0, errRead = 0, errWrite = 0;
+static uint32_t procCycles = 90000;
+static uint32_t initMs = 40; // ACMD41 keeps the card idle this long
+
+//
+// Virtual time
+//
+static uint64_t now;
+static uint64_t nextTick;
+static uint32_t byteCycles = 8 * (SYS_CLK / 400000);
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+//
+// The card
+//
+static struct {
+  FILE * img;
+  uint32_t sectors;
+  bool sdhc;
+  bool selected;
+  bool idle;          // Idle state until ACMD41 is through
+  bool app;           // The last command was CMD55
+  uint64_t initDone;  // ACMD41 gets the card out of idle state from then on
+  uint8_t cmd[6];
+  uint8_t cmdLen;
+  uint8_t out[520];   // Response and data bytes to send
+  uint16_t outPos;
+  uint16_t outLen;
+  uint64_t outAt;     // 0xFF goes out before
+  uint64_t busyAfter; // Busy time once the queue is out
+  uint64_t busyUntil; // DO held low before
+  uint32_t readLeft;  // Blocks still to send
+  uint32_t readAddr;
+  modelWrT wr;
+  bool wrMulti;
+  uint32_t wrAddr;
+  uint8_t blk[514];
+  uint16_t blkLen;
+} card;
+
+static struct {
+  uint32_t commands;
+  uint32_t blocksRead;
+  uint32_t blocksWritten;
+  uint32_t stalls;
+  uint32_t errors;      // Injected
+  uint64_t busy;        // Program and stop busy
+  uint64_t maxBusy;
+} cardStat;
+
+//
+// uDMA channels of the SSI, only what mmcXfer() uses
+//
+static struct {
+  bool enabled;
+  bool srcInc;
+  bool dstInc;
+  uint8_t * src;
+  uint8_t * dst;
+  uint32_t n;
+} dmaChan[32];
+
+//
+// ADC ring and writer
+//
+static uint64_t elemCycles;
+static uint64_t nextElem;
+static bool running;
+static uint32_t ready, readyMax, lost;
+static bool ahead;
+static uint32_t aheadCount;
+
+static uint64_t modelRand(void) {
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return rng * 0x2545F4914F6CDD1DULL;
+}
+
+static bool modelChance(double p) {
+  return (p > 0) && ((modelRand() >> 11) * (1.0 / 9007199254740992.0) < p);
+}
+
+static uint64_t modelLat(const modelLatT * lat) {
+  uint32_t us = lat->min;
+
+  if (lat->max > lat->min) {
+    us += modelRand() % (lat->max - lat->min + 1);
+  }
+
+  return (uint64_t) us * MODEL_US;
+}
+
+uint32_t perfHostNow(void) {
+  return (uint32_t) now;
+}
+
+//
+// Let cycles of virtual time pass: disk timer ticks and ADC elements
+//
+static void modelRun(uint64_t cycles) {
+  now += cycles;
+
+  while (now >= nextTick) {
+    disk_timerproc();
+    nextTick += SYS_CLK / 100;
+  }
+
+  while (running && (now >= nextElem)) {
+    if (ready < bufSize - modelHeld) {
+      ready++;
+      if (ready > readyMax) {
+        readyMax = ready;
+      }
+    }
+    else {
+      lost++;
+    }
+    nextElem += elemCycles;
+  }
+}
+
+static void cardQueue(const uint8_t * data, uint16_t n, uint64_t delay) {
+  memcpy(card.out, data, n);
+  card.outPos = 0;
+  card.outLen = n;
+  card.outAt = now + delay;
+}
+
+//
+// Next block of a CMD17 or CMD18 read, at least a few bytes after the last
+// one so the driver finds the card ready for CMD12 in between
+//
+static void cardReadBlock(void) {
+  uint64_t delay = modelLat(&latRead);
+  uint8_t token;
+
+  if (delay < 3 * byteCycles) {
+    delay = 3 * byteCycles;
+  }
+
+  if (card.readAddr >= card.sectors) {
+    token = 0x08; // Out of range
+  }
+  else if (modelChance(errRead)) {
+    token = 0x04; // ECC failed
+    cardStat.errors++;
+  }
+  else {
+    card.out[0] = 0xFE;
+    fseek(card.img, (long) card.readAddr * 512, SEEK_SET);
+    if (fread(card.out + 1, 512, 1, card.img) != 1) {
+      memset(card.out + 1, 0, 512);
+    }
+    card.out[513] = 0xFF;
+    card.out[514] = 0xFF;
+    card.outPos = 0;
+    card.outLen = 515;
+    card.outAt = now + delay;
+
+    card.readAddr++;
+    card.readLeft--;
+    cardStat.blocksRead++;
+    return;
+  }
+
+  cardQueue(&token, 1, delay);
+  card.readLeft = 0;
+}
+
+//
+// Card registers, read like a block right after R1
+//
+static void cardRegister(uint8_t r1, bool csd) {
+  uint8_t reg[21];
+  uint32_t size;
+
+  memset(reg, 0, sizeof(reg));
+  reg[0] = r1;
+  reg[1] = 0xFF;
+  reg[2] = 0xFE;
+
+  if (csd && card.sdhc) {
+    // CSD version 2: C_SIZE in 512 KB units
+    size = card.sectors / 1024 - 1;
+    reg[3 + 0] = 0x40;
+    reg[3 + 5] = 0x09;
+    reg[3 + 7] = (size >> 16) & 0x3F;
+    reg[3 + 8] = size >> 8;
+    reg[3 + 9] = size;
+  }
+  else if (csd) {
+    // CSD version 1: READ_BL_LEN 9, C_SIZE_MULT 7, C_SIZE in 256 KB units
+    size = card.sectors / 512 - 1;
+    reg[3 + 5] = 0x09;
+    reg[3 + 6] = (size >> 10) & 3;
+    reg[3 + 7] = size >> 2;
+    reg[3 + 8] = (size & 3) << 6;
+    reg[3 + 9] = 0x03;
+    reg[3 + 10] = 0x80;
+  }
+  else {
+    // CID: a manufacturer and a product name
+    memcpy(reg + 3 + 1, "MDMODEL", 7);
+  }
+
+  reg[19] = 0xFF;
+  reg[20] = 0xFF;
+
+  cardQueue(reg, sizeof(reg), modelLat(&latCmd));
+}
+
+static void cardCommand(void) {
+  uint8_t idx = card.cmd[0] & 0x3F;
+  uint32_t arg = ((uint32_t) card.cmd[1] << 24) | ((uint32_t) card.cmd[2] << 16) |
+                 ((uint32_t) card.cmd[3] << 8) | card.cmd[4];
+  bool app = card.app;
+  uint8_t r[6];
+  uint8_t r1;
+
+  cardStat.commands++;
+  card.app = false;
+
+  // Reads stop at CMD12, anything else in between is not expected
+  card.readLeft = 0;
+  card.outLen = 0;
+
+  if (!card.idle && (idx != 12) && modelChance(errCmd)) {
+    cardStat.errors++;
+    return;
+  }
+
+  r1 = card.idle ? 0x01 : 0x00;
+
+  switch (idx) {
+  case 0:
+    if (card.cmd[5] != 0x95) {
+      r1 |= 0x08; // CRC error
+      break;
+    }
+    card.idle = true;
+    card.initDone = 0;
+    card.wr = wrNone;
+    r1 = 0x01;
+    break;
+
+  case 8:
+    if (card.cmd[5] != 0x87) {
+      r1 |= 0x08;
+      break;
+    }
+    r[0] = r1;
+    r[1] = 0;
+    r[2] = 0;
+    r[3] = (arg >> 8) & 0x0F;
+    r[4] = arg;
+    cardQueue(r, 5, modelLat(&latCmd));
+    return;
+
+  case 9:
+  case 10:
+    if (card.idle) {
+      r1 |= 0x04;
+      break;
+    }
+    cardRegister(r1, idx == 9);
+    return;
+
+  case 12:
+    // The byte after CMD12 is still stuff, then R1b
+    r[0] = 0xFF;
+    r[1] = r1;
+    cardQueue(r, 2, 0);
+    card.busyAfter = modelLat(&latCmd);
+    return;
+
+  case 16:
+    if (arg != 512) {
+      r1 |= 0x40; // Parameter error
+    }
+    break;
+
+  case 17:
+  case 18:
+    card.readAddr = card.sdhc ? arg : arg / 512;
+    if (card.idle) {
+      r1 |= 0x04;
+    }
+    else if (card.readAddr >= card.sectors) {
+      r1 |= 0x20; // Address error
+    }
+    else {
+      card.readLeft = (idx == 17) ? 1 : UINT32_MAX;
+    }
+    break;
+
+  case 23:
+    if (!app) {
+      r1 |= 0x04;
+    }
+    break;
+
+  case 24:
+  case 25:
+    card.wrAddr = card.sdhc ? arg : arg / 512;
+    if (card.idle) {
+      r1 |= 0x04;
+    }
+    else if (card.wrAddr >= card.sectors) {
+      r1 |= 0x20;
+    }
+    else {
+      card.wr = wrToken;
+      card.wrMulti = (idx == 25);
+    }
+    break;
+
+  case 41:
+    if (!app) {
+      r1 |= 0x04;
+      break;
+    }
+    if (!card.initDone) {
+      card.initDone = now + (uint64_t) initMs * 1000 * MODEL_US;
+    }
+    if (now >= card.initDone) {
+      card.idle = false;
+    }
+    r1 = card.idle ? 0x01 : 0x00;
+    break;
+
+  case 55:
+    card.app = true;
+    break;
+
+  case 58:
+    r[0] = r1;
+    r[1] = (card.idle ? 0x00 : 0x80) | (card.sdhc ? 0x40 : 0x00);
+    r[2] = 0xFF;
+    r[3] = 0x80;
+    r[4] = 0x00;
+    cardQueue(r, 5, modelLat(&latCmd));
+    return;
+
+  default:
+    r1 |= 0x04; // Illegal command
+  }
+
+  cardQueue(&r1, 1, modelLat(&latCmd));
+}
+
+//
+// A whole block with its CRC is in, program it
+//
+static void cardWriteBlock(void) {
+  uint64_t busy;
+  uint8_t resp;
+
+  if (card.wrAddr >= card.sectors) {
+    resp = 0xED; // Write error
+    busy = 0;
+  }
+  else if (modelChance(errWrite)) {
+    resp = 0xEB; // CRC error
+    busy = 0;
+    cardStat.errors++;
+  }
+  else {
+    fseek(card.img, (long) card.wrAddr * 512, SEEK_SET);
+    fwrite(card.blk, 512, 1, card.img);
+    resp = 0xE5;
+    cardStat.blocksWritten++;
+
+    if (modelChance(stallP)) {
+      busy = (uint64_t) stallMs * 1000 * MODEL_US;
+      cardStat.stalls++;
+    }
+    else {
+      busy = modelLat(&latWrite);
+    }
+  }
+
+  card.wrAddr++;
+  card.wr = card.wrMulti ? wrToken : wrNone;
+
+  cardQueue(&resp, 1, 0);
+  card.busyAfter = busy;
+}
+
+//
+// One byte each way on the bus, while CS is low
+//
+static uint8_t cardXchg(uint8_t in) {
+  uint8_t out = 0xFF;
+
+  modelRun(byteCycles);
+
+  if (!card.selected) {
+    return 0xFF;
+  }
+
+  // Card to host
+  if (now < card.busyUntil) {
+    out = 0x00;
+  }
+  else if (card.outPos < card.outLen) {
+    if (now >= card.outAt) {
+      out = card.out[card.outPos++];
+
+      if ((card.outPos == card.outLen) && card.busyAfter) {
+        cardStat.busy += card.busyAfter;
+        if (card.busyAfter > cardStat.maxBusy) {
+          cardStat.maxBusy = card.busyAfter;
+        }
+        card.busyUntil = now + card.busyAfter;
+        card.busyAfter = 0;
+      }
+    }
+  }
+  else if (card.readLeft) {
+    cardReadBlock();
+  }
+
+  // Host to card
+  if (card.wr == wrData) {
+    card.blk[card.blkLen++] = in;
+    if (card.blkLen == sizeof(card.blk)) {
+      cardWriteBlock();
+    }
+  }
+  else if ((card.wr == wrToken) && (in != 0xFF)) {
+    if (in == (card.wrMulti ? 0xFC : 0xFE)) {
+      card.wr = wrData;
+      card.blkLen = 0;
+    }
+    else if (card.wrMulti && (in == 0xFD)) {
+      card.wr = wrNone;
+      card.busyAfter = modelLat(&latStop);
+      cardStat.busy += card.busyAfter;
+      card.busyUntil = now + byteCycles + card.busyAfter;
+      card.busyAfter = 0;
+    }
+  }
+  else if (card.cmdLen || ((in & 0xC0) == 0x40)) {
+    card.cmd[card.cmdLen++] = in;
+    if (card.cmdLen == sizeof(card.cmd)) {
+      card.cmdLen = 0;
+      cardCommand();
+    }
+  }
+
+  return out;
+}
+
+//*****************************************************************************
+//
+// Driver library calls of mmc_dma.c, on the model
+//
+//*****************************************************************************
+static uint8_t ssiRx;
+
+void SSIDataPut(uint32_t ui32Base, uint32_t ui32Data) {
+  ssiRx = cardXchg((uint8_t) ui32Data);
+}
+
+void SSIDataGet(uint32_t ui32Base, uint32_t * pui32Data) {
+  *pui32Data = ssiRx;
+}
+
+int32_t SSIDataGetNonBlocking(uint32_t ui32Base, uint32_t * pui32Data) {
+  return 0;
+}
+
+void SSIConfigSetExpClk(uint32_t ui32Base, uint32_t ui32SSIClk,
+                        uint32_t ui32Protocol, uint32_t ui32Mode,
+                        uint32_t ui32BitRate, uint32_t ui32DataWidth) {
+  byteCycles = 8 * (ui32SSIClk / ui32BitRate);
+}
+
+void SSIEnable(uint32_t ui32Base) {
+}
+
+void SSIDisable(uint32_t ui32Base) {
+}
+
+//
+// The uDMA moves the whole block at once: the RX and TX requests of each
+// byte come together and the channels finish on the last one
+//
+void SSIDMAEnable(uint32_t ui32Base, uint32_t ui32DMAFlags) {
+  uint32_t rxCh = UDMA_CHANNEL_SSI0RX, txCh = UDMA_CHANNEL_SSI0TX;
+  uint32_t i;
+  uint8_t in;
+
+  if (!dmaChan[rxCh].enabled || !dmaChan[txCh].enabled) {
+    return;
+  }
+
+  for (i = 0; i < dmaChan[txCh].n; i++) {
+    in = cardXchg(dmaChan[txCh].src[dmaChan[txCh].srcInc ? i : 0]);
+    dmaChan[rxCh].dst[dmaChan[rxCh].dstInc ? i : 0] = in;
+  }
+
+  dmaChan[txCh].enabled = false;
+  mmcIntHandler();
+  dmaChan[rxCh].enabled = false;
+  mmcIntHandler();
+}
+
+void SSIDMADisable(uint32_t ui32Base, uint32_t ui32DMAFlags) {
+}
+
+void uDMAChannelAssign(uint32_t ui32Mapping) {
+}
+
+void uDMAChannelAttributeDisable(uint32_t ui32ChannelNum, uint32_t ui32Attr) {
+}
+
+void uDMAChannelControlSet(uint32_t ui32ChannelStructIndex,
+                           uint32_t ui32Control) {
+  uint32_t ch = ui32ChannelStructIndex & 0x1F;
+
+  dmaChan[ch].srcInc = (ui32Control & UDMA_SRC_INC_NONE) != UDMA_SRC_INC_NONE;
+  dmaChan[ch].dstInc = (ui32Control & UDMA_DST_INC_NONE) != UDMA_DST_INC_NONE;
+}
+
+void uDMAChannelTransferSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Mode,
+                            void * pvSrcAddr, void * pvDstAddr,
+                            uint32_t ui32TransferSize) {
+  uint32_t ch = ui32ChannelStructIndex & 0x1F;
+
+  dmaChan[ch].src = pvSrcAddr;
+  dmaChan[ch].dst = pvDstAddr;
+  dmaChan[ch].n = ui32TransferSize;
+}
+
+void uDMAChannelEnable(uint32_t ui32ChannelNum) {
+  dmaChan[ui32ChannelNum & 0x1F].enabled = true;
+}
+
+void uDMAChannelDisable(uint32_t ui32ChannelNum) {
+  dmaChan[ui32ChannelNum & 0x1F].enabled = false;
+}
+
+bool uDMAChannelIsEnabled(uint32_t ui32ChannelNum) {
+  return dmaChan[ui32ChannelNum & 0x1F].enabled;
+}
+
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val) {
+  if ((ui32Port == GPIO_PORTA_BASE) && (ui8Pins & MODEL_CS)) {
+    card.selected = !(ui8Val & MODEL_CS);
+    card.cmdLen = 0;
+  }
+}
+
+void GPIOPinTypeGPIOOutput(uint32_t ui32Port, uint8_t ui8Pins) {
+}
+
+void GPIOPinTypeSSI(uint32_t ui32Port, uint8_t ui8Pins) {
+}
+
+void GPIOPinConfigure(uint32_t ui32PinConfig) {
+}
+
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins,
+                      uint32_t ui32Strength, uint32_t ui32PadType) {
+}
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral) {
+}
+
+uint32_t SysCtlClockGet(void) {
+  return SYS_CLK;
+}
+
+void IntEnable(uint32_t ui32Interrupt) {
+}
+
+void IntDisable(uint32_t ui32Interrupt) {
+}
+
+//*****************************************************************************
+//
+// Writer
+//
+//*****************************************************************************
+
+//
+// Filter the next element, waiting for the ADC if it is not in yet
+//
+static void modelFilter(void) {
+  while (!ready) {
+    modelRun(nextElem - now);
+  }
+
+  ready--;
+  modelRun(procCycles);
+}
+
+//
+// nanoIdle(): one element ahead while the card is busy
+//
+static void modelIdle(void) {
+  if (!ahead && ready) {
+    ready--;
+    modelRun(procCycles);
+    ahead = true;
+    aheadCount++;
+  }
+}
+
+static void modelFillBlock(uint8_t * data, uint32_t block) {
+  uint32_t i;
+
+  for (i = 0; i < modelBlockSize; i += 4) {
+    data[i] = block;
+    data[i + 1] = block >> 8;
+    data[i + 2] = block >> 16;
+    data[i + 3] = i >> 2;
+  }
+}
+
+static FRESULT modelRecord(uint32_t blocks, uint64_t * maxWrite) {
+  static FIL wav, idx;
+  static uint8_t data[modelBlockSize];
+  uint8_t head[WAV_HEADER_SIZE];
+  uint8_t idxHead[modelIdxHead];
+  uint8_t entry[modelIdxEntry];
+  uint64_t start;
+  uint32_t b, t;
+  FRESULT res;
+  UINT bw;
+
+  memset(idxHead, 0, sizeof(idxHead));
+  memset(entry, 0, sizeof(entry));
+  wavHeaderFill(head, 0);
+
+  res = f_open(&wav, "REC.WAV", FA_WRITE | FA_CREATE_ALWAYS);
+  if (res == FR_OK) {
+    res = f_open(&idx, "REC.IDX", FA_WRITE | FA_CREATE_ALWAYS);
+  }
+  if (res == FR_OK) {
+    res = f_write(&idx, idxHead, sizeof(idxHead), &bw);
+  }
+  if (res == FR_OK) {
+    res = f_write(&wav, head, sizeof(head), &bw);
+  }
+  if (res != FR_OK) {
+    return res;
+  }
+
+  mmcIdle = mmcUseDma ? modelIdle : 0;
+  running = true;
+  nextElem = now + elemCycles;
+  *maxWrite = 0;
+
+  for (b = 0; b < blocks; b++) {
+    for (t = 0; t < modelElements; t++) {
+      if (ahead) {
+        ahead = false;
+      }
+      else {
+        modelFilter();
+      }
+    }
+
+    modelFillBlock(data, b);
+    memcpy(entry, &b, sizeof(b));
+
+    start = now;
+    res = f_write(&idx, entry, sizeof(entry), &bw);
+    if (res == FR_OK) {
+      res = f_write(&wav, data, sizeof(data), &bw);
+    }
+    if (now - start > *maxWrite) {
+      *maxWrite = now - start;
+    }
+    if (res != FR_OK) {
+      break;
+    }
+  }
+
+  mmcIdle = 0;
+  running = false;
+
+  if (res == FR_OK) {
+    wavHeaderFill(head, blocks * modelBlockSize);
+    res = f_lseek(&wav, 0);
+  }
+  if (res == FR_OK) {
+    res = f_write(&wav, head, sizeof(head), &bw);
+  }
+  if (res == FR_OK) {
+    res = f_lseek(&idx, 0);
+  }
+  if (res == FR_OK) {
+    res = f_write(&idx, idxHead, sizeof(idxHead), &bw);
+  }
+
+  f_close(&wav);
+  f_close(&idx);
+
+  return res;
+}
+
+//
+// Read REC.WAV back through the driver and check every block
+//
+static FRESULT modelVerify(uint32_t blocks) {
+  static FIL wav;
+  static uint8_t data[modelBlockSize], expect[modelBlockSize];
+  uint32_t b;
+  FRESULT res;
+  UINT br;
+
+  res = f_open(&wav, "REC.WAV", FA_READ);
+  if (res == FR_OK) {
+    res = f_lseek(&wav, WAV_HEADER_SIZE);
+  }
+
+  for (b = 0; (res == FR_OK) && (b < blocks); b++) {
+    res = f_read(&wav, data, sizeof(data), &br);
+    if (res != FR_OK) {
+      break;
+    }
+
+    modelFillBlock(expect, b);
+    if ((br != sizeof(data)) || memcmp(data, expect, sizeof(data))) {
+      printf("FAIL: block %u reads back wrong\n", b);
+      exit(1);
+    }
+  }
+
+  f_close(&wav);
+
+  return res;
+}
+
+static void modelUsage(void) {
+  printf("usage: sdmodel [-s seed] [-t seconds] [-c cycles] [-p] [-v]\n"
+         "               [-l what=min,max] [-e what=p] card.img\n");
+  exit(2);
+}
+
+static void modelOption(char * opt, bool error) {
+  char * val = strchr(opt, '=');
+  modelLatT * lat = 0;
+  double p;
+
+  if (!val) {
+    modelUsage();
+  }
+  *val++ = 0;
+
+  if (error) {
+    p = atof(val);
+    if (!strcmp(opt, "cmd")) {
+      errCmd = p;
+    }
+    else if (!strcmp(opt, "read")) {
+      errRead = p;
+    }
+    else if (!strcmp(opt, "write")) {
+      errWrite = p;
+    }
+    else {
+      modelUsage();
+    }
+    return;
+  }
+
+  if (!strcmp(opt, "stall")) {
+    if (sscanf(val, "%lf,%u", &stallP, &stallMs) != 2) {
+      modelUsage();
+    }
+    return;
+  }
+
+  if (!strcmp(opt, "cmd")) {
+    lat = &latCmd;
+  }
+  else if (!strcmp(opt, "read")) {
+    lat = &latRead;
+  }
+  else if (!strcmp(opt, "write")) {
+    lat = &latWrite;
+  }
+  else if (!strcmp(opt, "stop")) {
+    lat = &latStop;
+  }
+  if (!lat || (sscanf(val, "%u,%u", &lat->min, &lat->max) != 2) ||
+      (lat->max < lat->min)) {
+    modelUsage();
+  }
+}
+
+int main(int argc, char ** argv) {
+  static FATFS fs;
+  uint32_t seconds = 60;
+  uint32_t blocks;
+  uint64_t start, maxWrite = 0;
+  FRESULT res;
+  long size;
+  int opt;
+
+  card.sdhc = true;
+
+  while ((opt = getopt(argc, argv, "s:t:c:pvl:e:")) != -1) {
+    switch (opt) {
+    case 's':
+      rng ^= strtoull(optarg, 0, 0) * 0xBF58476D1CE4E5B9ULL;
+      break;
+    case 't':
+      seconds = (uint32_t) atoi(optarg);
+      break;
+    case 'c':
+      procCycles = (uint32_t) atoi(optarg);
+      break;
+    case 'p':
+      mmcUseDma = false;
+      break;
+    case 'v':
+      card.sdhc = false;
+      break;
+    case 'l':
+    case 'e':
+      modelOption(optarg, opt == 'e');
+      break;
+    default:
+      modelUsage();
+    }
+  }
+  if (optind != argc - 1) {
+    modelUsage();
+  }
+
+  card.img = fopen(argv[optind], "r+b");
+  if (!card.img) {
+    perror(argv[optind]);
+    return 2;
+  }
+  fseek(card.img, 0, SEEK_END);
+  size = ftell(card.img);
+  card.sectors = (uint32_t) (size / (512 * 1024)) * 1024;
+  if (!card.sectors || (!card.sdhc && (card.sectors > 4096 * 512))) {
+    printf("image must be 512 KB to %s\n", card.sdhc ? "32 GB" : "1 GB");
+    return 2;
+  }
+
+  nextTick = SYS_CLK / 100;
+  elemCycles = (uint64_t) elementSize * (SYS_CLK / ADC_RATE + 1);
+  blocks = (uint32_t) ((uint64_t) seconds * ADC_RATE / elementSize /
+                       modelElements);
+
+  printf("card: %s, %u sectors, %s transfers\n", card.sdhc ? "SDHC" : "SDSC",
+         card.sectors, mmcUseDma ? "uDMA" : "polled");
+
+  if (disk_initialize(0) & STA_NOINIT) {
+    printf("FAIL: card not initialized\n");
+    return 1;
+  }
+  printf("init: %u ms\n", (uint32_t) (now / (1000 * MODEL_US)));
+
+  res = f_mount(0, &fs);
+  if (res != FR_OK) {
+    printf("FAIL: mount %d\n", res);
+    return 1;
+  }
+
+  memset(&mmcStat, 0, sizeof(mmcStat));
+  start = now;
+  res = modelRecord(blocks, &maxWrite);
+  printf("record: %d, %u blocks in %u ms, slowest block write %u us\n", res,
+         blocks, (uint32_t) ((now - start) / (1000 * MODEL_US)),
+         (uint32_t) (maxWrite / MODEL_US));
+  printf("ring: peak %u of %u elements, %u lost, %u filtered ahead\n",
+         readyMax, bufSize - modelHeld, lost, aheadCount);
+  printf("card: %u commands, %u blocks written, %u stalls, busy %u ms "
+         "(longest %u us), %u errors injected\n", cardStat.commands,
+         cardStat.blocksWritten, cardStat.stalls,
+         (uint32_t) (cardStat.busy / (1000 * MODEL_US)),
+         (uint32_t) (cardStat.maxBusy / MODEL_US), cardStat.errors);
+  printf("driver: %u ms waiting in mmcIdle, %u reads of %u sectors, "
+         "%u writes of %u sectors\n",
+         (uint32_t) (mmcIdleCycles / (1000 * MODEL_US)), mmcStat.reads,
+         mmcStat.readSectors, mmcStat.writes, mmcStat.writeSectors);
+
+  if (res == FR_OK) {
+    start = now;
+    res = modelVerify(blocks);
+    printf("verify: %d, %u KB/s\n", res, (uint32_t) ((uint64_t) blocks *
+           modelBlockSize * MODEL_US * 1000 / ((now - start) | 1)));
+  }
+
+  fclose(card.img);
+
+  if ((res != FR_OK) || lost) {
+    printf("FAIL\n");
+    return 1;
+  }
+
+  printf("PASS\n");
+  return 0;
+}
@@ -0,0 +1,317 @@
+/*
+ * tsidx.c
+ *
+ * Each recording REC.WAV gets an index REC.IDX with a header and one entry
+ * per block written. Entries are in time order, so a time is found with a
+ * binary search over the file instead of a scan of the samples.
+ *
+ *  Created on: 19-10-2026
+ */
+#include <string.h>
+#include "tsidx.h"
+#include "global.h"
+#include "utils/uartstdio.h"
+
+//
+// Name of the index of a WAV file: the same path with the extension replaced
+// by TSIDX_EXT. dst has room for the path plus a few characters.
+//
+void tsIndexName(char * dst, const char * wavPath) {
+  char * dot;
+
+  strcpy(dst, wavPath);
+
+  dot = strrchr(dst, '.');
+  if (!dot || strchr(dot, '/')) {
+    dot = dst + strlen(dst);
+  }
+
+  strcpy(dot, TSIDX_EXT);
+}
+
+//
+// Create the index of the WAV file at wavPath, which holds rate samples per
+// second in blocks of vadBlockSize. lead is the time in us from the first
+// sample of an element to the capture ISR that stamps it.
+//
+FRESULT tsOpen(tsIdxT * ts, const char * wavPath, uint32_t rate,
+               uint32_t lead) {
+  char path[80];
+  const char * name = strrchr(wavPath, '/');
+  FRESULT res;
+  UINT bw;
+
+  memset(&ts->head, 0, sizeof(ts->head));
+  ts->head.magic = TSIDX_MAGIC;
+  ts->head.rate = rate;
+  ts->head.blockSamples = vadBlockSize;
+  strncpy(ts->head.wav, name ? name + 1 : wavPath, sizeof(ts->head.wav) - 1);
+
+  ts->lead = lead;
+  ts->next = 0;
+  ts->entries = 0;
+  ts->cycles = 0;
+  ts->headSynced = false;
+
+  if (strlen(wavPath) + sizeof(TSIDX_EXT) > sizeof(path)) {
+    return FR_INVALID_NAME;
+  }
+  tsIndexName(path, wavPath);
+
+  res = f_open(&ts->file, path, FA_WRITE | FA_CREATE_ALWAYS);
+  if (res != FR_OK) {
+    return res;
+  }
+
+  // The start tick is not known yet, tsClose() writes the header again
+  res = f_write(&ts->file, &ts->head, sizeof(ts->head), &bw);
+  if (res != FR_OK) {
+    f_close(&ts->file);
+  }
+
+  return res;
+}
+
+//
+// Take the capture ISR stamps of the first element of a block: the cycle
+// counter and the SysTick count. Blocks are stamped in order from 0, at most
+// tsHistory blocks before they are written.
+//
+// The ISR runs once the last sample of the element is in, lead us after its
+// first one. That is the same for every block, so only the time base moves:
+// startTick is that of the first sample of block 0, and the times of the
+// entries, relative to it, are those of the first samples of their blocks.
+//
+void tsStamp(tsIdxT * ts, uint32_t block, uint32_t stamp, uint32_t tick) {
+  uint8_t i = block % tsHistory;
+  uint32_t lead = (ts->lead + 500) / 1000;
+
+  if (block == 0) {
+    ts->head.startTick = (tick * 10 > lead) ? tick * 10 - lead : 0;
+    ts->lastStamp = stamp;
+  }
+
+  // Blocks are far less than a counter wrap apart
+  ts->cycles += stamp - ts->lastStamp;
+  ts->lastStamp = stamp;
+
+  ts->time[i] = (uint32_t) (ts->cycles / (SYS_CLK / 1000000));
+  ts->tick[i] = tick * 10 - ts->head.startTick;
+}
+
+//
+// Add an entry for a stamped block that is written to the WAV file at offset
+//
+FRESULT tsAdd(tsIdxT * ts, uint32_t block, uint32_t offset) {
+  tsEntryT * e = &ts->last;
+  UINT bw;
+
+  e->block = block;
+  e->time = ts->time[block % tsHistory];
+  e->tick = ts->tick[block % tsHistory];
+  e->offset = offset;
+  e->dropped = (block - ts->next) * ts->head.blockSamples;
+
+  ts->next = block + 1;
+  ts->entries++;
+
+  return f_write(&ts->file, e, sizeof(*e), &bw);
+}
+
+//
+// Put the entries so far on the card, and the header with the start tick the
+// first time, so a recording cut off by a power loss keeps its index
+//
+FRESULT tsSync(tsIdxT * ts) {
+  FRESULT res = FR_OK;
+  UINT bw;
+
+  if (!ts->headSynced && ts->entries) {
+    res = f_lseek(&ts->file, 0);
+    if (res == FR_OK) {
+      res = f_write(&ts->file, &ts->head, sizeof(ts->head), &bw);
+    }
+    if (res == FR_OK) {
+      res = f_lseek(&ts->file, f_size(&ts->file));
+    }
+    ts->headSynced = true;
+  }
+
+  if (res == FR_OK) {
+    res = f_sync(&ts->file);
+  }
+
+  return res;
+}
+
+FRESULT tsClose(tsIdxT * ts) {
+  FRESULT res;
+  UINT bw;
+
+  res = f_lseek(&ts->file, 0);
+  if (res == FR_OK) {
+    res = f_write(&ts->file, &ts->head, sizeof(ts->head), &bw);
+  }
+
+  f_close(&ts->file);
+
+  return res;
+}
+
+//
+// Time of the last block on the three clocks. With the ADC timer running at
+// exactly ADC_RATE the three agree to within the interrupt latency.
+//
+void tsPrint(tsIdxT * ts) {
+  tsEntryT * e = &ts->last;
+
+  if (!ts->entries) {
+    UARTprintf("ts: no blocks\n");
+    return;
+  }
+
+  UARTprintf("ts: %u entries, block %u at adc %u ms, timer %u ms, "
+             "systick %u ms\n", ts->entries, e->block,
+             (uint32_t) ((uint64_t) e->block * ts->head.blockSamples * 1000 /
+                         ts->head.rate),
+             e->time / 1000, e->tick);
+}
+
+static FRESULT tsRead(FIL * idx, uint32_t i, tsEntryT * e) {
+  FRESULT res;
+  UINT br;
+
+  res = f_lseek(idx, sizeof(tsHeaderT) + i * sizeof(tsEntryT));
+  if (res == FR_OK) {
+    res = f_read(idx, e, sizeof(*e), &br);
+  }
+  if ((res == FR_OK) && (br != sizeof(*e))) {
+    res = FR_INT_ERR;
+  }
+
+  return res;
+}
+
+//
+// Cut the index of the recording at wavPath after the last entry of a block
+// that ends by dataEnd in the WAV file, once the WAV file is recovered. The
+// entries past it are written after the last sync of the WAV file, so only a
+// few are read, from the end.
+//
+FRESULT tsRecover(FIL * idx, const char * wavPath, uint32_t dataEnd) {
+  char path[80];
+  tsEntryT e;
+  uint32_t n;
+  FRESULT res;
+
+  if (strlen(wavPath) + sizeof(TSIDX_EXT) > sizeof(path)) {
+    return FR_INVALID_NAME;
+  }
+  tsIndexName(path, wavPath);
+
+  res = f_open(idx, path, FA_READ | FA_WRITE);
+  if (res == FR_NO_FILE) {
+    return FR_OK;
+  }
+  if (res != FR_OK) {
+    return res;
+  }
+
+  n = (f_size(idx) < sizeof(tsHeaderT)) ? 0 :
+      (f_size(idx) - sizeof(tsHeaderT)) / sizeof(e);
+
+  while ((res == FR_OK) && n) {
+    res = tsRead(idx, n - 1, &e);
+    if ((res != FR_OK) || (e.offset + vadBlockSize * 2 <= dataEnd)) {
+      break;
+    }
+    n--;
+  }
+
+  if ((res == FR_OK) && (f_size(idx) > sizeof(tsHeaderT) + n * sizeof(e))) {
+    res = f_lseek(idx, sizeof(tsHeaderT) + n * sizeof(e));
+    if (res == FR_OK) {
+      res = f_truncate(idx);
+    }
+  }
+
+  f_close(idx);
+
+  return res;
+}
+
+//
+// Find the sample at ms SysTick milliseconds since reset in the recording of
+// an open index file. Fills in the header and the byte offset in the WAV
+// file. A time in a gap of a gated recording gives the first sample after it.
+// Returns FR_NO_FILE if the recording does not cover the time.
+//
+FRESULT tsLookup(FIL * idx, uint32_t ms, tsHeaderT * head, uint32_t * offset) {
+  tsEntryT e;
+  uint32_t lo, hi, mid, n;
+  uint32_t target;
+  uint32_t sample;
+  FRESULT res;
+  UINT br;
+
+  res = f_lseek(idx, 0);
+  if (res == FR_OK) {
+    res = f_read(idx, head, sizeof(*head), &br);
+  }
+  if (res != FR_OK) {
+    return res;
+  }
+  if ((br != sizeof(*head)) || (head->magic != TSIDX_MAGIC)) {
+    return FR_NO_FILESYSTEM;
+  }
+
+  n = (f_size(idx) - sizeof(*head)) / sizeof(e);
+  if (!n || (ms < head->startTick)) {
+    return FR_NO_FILE;
+  }
+  target = (ms - head->startTick) * 1000;
+
+  // Last entry at or before the time
+  lo = 0;
+  hi = n;
+  while (hi - lo > 1) {
+    mid = lo + (hi - lo) / 2;
+
+    res = tsRead(idx, mid, &e);
+    if (res != FR_OK) {
+      return res;
+    }
+
+    if (e.time <= target) {
+      lo = mid;
+    }
+    else {
+      hi = mid;
+    }
+  }
+
+  res = tsRead(idx, lo, &e);
+  if (res != FR_OK) {
+    return res;
+  }
+  if (e.time > target) {
+    return FR_NO_FILE;
+  }
+
+  sample = (uint32_t) ((uint64_t) (target - e.time) * head->rate / 1000000);
+
+  if (sample < head->blockSamples) {
+    *offset = e.offset + sample * 2;
+    return FR_OK;
+  }
+
+  // Past the block, the next entry starts after the gap
+  if (lo + 1 == n) {
+    return FR_NO_FILE;
+  }
+
+  res = tsRead(idx, lo + 1, &e);
+  *offset = e.offset;
+
+  return res;
+}
@@ -0,0 +1,71 @@
+/*
+ * tsidx.h
+ * Per block timestamp index written next to each recording
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef TSIDX_H_
+#define TSIDX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fatfs/src/ff.h"
+#include "vad.h"
+
+#define TSIDX_MAGIC 0x58444954 // "TIDX"
+#define TSIDX_EXT   ".IDX"
+
+enum {
+  tsHistory = vadPreBlocks + 1 // Blocks stamped but maybe not written yet
+};
+
+// Start of the index file, followed by one tsEntryT per block in the WAV file
+typedef struct {
+  uint32_t magic;
+  uint32_t rate;         // Sample rate of the WAV file
+  uint32_t blockSamples; // Samples per block
+  uint32_t startTick;    // SysTick ms since reset at the first sample of
+                         // block 0, the time base
+  char wav[16];          // Name of the WAV file
+} tsHeaderT;
+
+//
+// The three clocks of a block: the ADC timer (block * blockSamples / rate),
+// the cycle counter and SysTick. They drift apart when the ADC timer period
+// is not what ADC_RATE asks for.
+//
+typedef struct {
+  uint32_t block;   // Block number since the start
+  uint32_t time;    // us since block 0 from the cycle counter, capture ISR
+  uint32_t tick;    // SysTick ms since block 0, capture ISR
+  uint32_t offset;  // Byte offset of the block in the WAV file
+  uint32_t dropped; // Samples since the previous entry not in the file
+} tsEntryT;
+
+typedef struct {
+  FIL file;
+  tsHeaderT head;
+  uint32_t lead;            // us from the first sample of a block to its stamp
+  uint32_t time[tsHistory]; // Stamps of the last blocks, by block number
+  uint32_t tick[tsHistory];
+  uint32_t lastStamp;
+  uint64_t cycles;          // Cycle counter since block 0 without wrapping
+  uint32_t next;            // Block after the last one written
+  uint32_t entries;
+  bool headSynced;          // Header with the start tick on the card
+  tsEntryT last;
+} tsIdxT;
+
+void tsIndexName(char * dst, const char * wavPath);
+FRESULT tsOpen(tsIdxT * ts, const char * wavPath, uint32_t rate,
+               uint32_t lead);
+void tsStamp(tsIdxT * ts, uint32_t block, uint32_t stamp, uint32_t tick);
+FRESULT tsAdd(tsIdxT * ts, uint32_t block, uint32_t offset);
+FRESULT tsSync(tsIdxT * ts);
+FRESULT tsClose(tsIdxT * ts);
+void tsPrint(tsIdxT * ts);
+FRESULT tsLookup(FIL * idx, uint32_t ms, tsHeaderT * head, uint32_t * offset);
+FRESULT tsRecover(FIL * idx, const char * wavPath, uint32_t dataEnd);
+
+#endif /* TSIDX_H_ */
@@ -0,0 +1,146 @@
+/*
+ * vad.c
+ *
+ *  Created on: 19-10-2026
+ */
+#include "vad.h"
+#include "utils/uartstdio.h"
+
+void vadInit(vadT * vad) {
+  vad->slot = 0;
+  vad->histCount = 0;
+  vad->energy = 0;
+  vad->zeroCross = 0;
+  vad->noise = 0;
+  vad->hang = 0;
+  vad->active = false;
+  vad->block = 0;
+  vad->written = 0;
+  vad->segCount = 0;
+}
+
+// Buffer receiving the output samples of the current block
+int16_t * vadSlot(vadT * vad) {
+  return vad->hist[vad->slot];
+}
+
+//
+// Add the statistics of one ADC element to the current block. The energy is the
+// variance of the element so a DC offset on the input does not count.
+//
+void vadAccumulate(vadT * vad, procStatT * stat) {
+  int32_t mean;
+  uint32_t meanSq;
+
+  mean = stat->sum / elementSize;
+  meanSq = (uint32_t) (mean * mean);
+
+  if (stat->sumSq / elementSize > meanSq) {
+    vad->energy += stat->sumSq / elementSize - meanSq;
+  }
+  vad->zeroCross += stat->zeroCross;
+}
+
+// Slot index i blocks before the current one
+static uint8_t vadSlotBefore(vadT * vad, uint8_t i) {
+  return (vad->slot + (vadPreBlocks + 1) - i) % (vadPreBlocks + 1);
+}
+
+//
+// Decide on the current block and advance to the next one. The blocks to write
+// are returned through blocks (oldest first, at most vadPreBlocks + 1) and stay
+// valid until the next call. Returns the number of blocks to write.
+//
+uint8_t vadUpdate(vadT * vad, uint32_t tick, int16_t ** blocks) {
+  uint32_t e = vad->energy;
+  bool detect;
+  uint8_t n = 0;
+  uint8_t i;
+
+  // The first block only seeds the noise floor
+  if (vad->block == 0) {
+    vad->noise = e;
+  }
+
+  detect = (e > VAD_MIN_ENERGY) &&
+           ((e > vad->noise * VAD_ENERGY_RATIO) ||
+            ((e > vad->noise * VAD_ENERGY_RATIO_ZC) &&
+             (vad->zeroCross > VAD_ZC_MIN)));
+
+  // Noise floor follows decreases at once and increases slowly
+  if (e < vad->noise) {
+    vad->noise = e;
+  }
+  else {
+    vad->noise += (e - vad->noise) >> 6;
+  }
+
+  if (detect) {
+    if (!vad->active) {
+      // Start of a segment. Flush the pre-trigger history first.
+      if (vad->segCount < vadMaxSegs) {
+        vad->seg[vad->segCount].startBlock = vad->block - vad->histCount;
+        vad->seg[vad->segCount].blocks = 0;
+        vad->seg[vad->segCount].offset = vad->written * vadBlockSize * 2;
+        vad->seg[vad->segCount].tick = tick;
+      }
+      vad->segCount++;
+
+      for (i = vad->histCount; i > 0; i--) {
+        blocks[n++] = vad->hist[vadSlotBefore(vad, i)];
+      }
+      vad->histCount = 0;
+      vad->active = true;
+    }
+
+    vad->hang = vadHangBlocks;
+    blocks[n++] = vad->hist[vad->slot];
+  }
+  else if (vad->active) {
+    // Hangover, keep writing for a while
+    blocks[n++] = vad->hist[vad->slot];
+
+    if (--vad->hang == 0) {
+      vad->active = false;
+    }
+  }
+  else if (vad->histCount < vadPreBlocks) {
+    vad->histCount++;
+  }
+
+  if (n && vad->segCount <= vadMaxSegs) {
+    vad->seg[vad->segCount - 1].blocks += n;
+  }
+
+  vad->written += n;
+  vad->block++;
+  vad->slot = (vad->slot + 1) % (vadPreBlocks + 1);
+  vad->energy = 0;
+  vad->zeroCross = 0;
+
+  return n;
+}
+
+//
+// Print the detected segments and the duty cycle. Each segment starts "at" its
+// place in the recording and triggered at "uptime", from the 10ms SysTick.
+//
+void vadPrint(vadT * vad) {
+  uint8_t i;
+  vadSegT * seg;
+  uint32_t blockMs = vadBlockSize / 8; // 8ksps output
+
+  for (i = 0; (i < vad->segCount) && (i < vadMaxSegs); i++) {
+    seg = &vad->seg[i];
+    UARTprintf("seg %2u: at %8u ms, uptime %9u ms, %6u ms long, "
+               "data offset %u\n", i, seg->startBlock * blockMs,
+               seg->tick * 10, seg->blocks * blockMs, seg->offset);
+  }
+
+  if (vad->segCount > vadMaxSegs) {
+    UARTprintf("(%u more segments not listed)\n", vad->segCount - vadMaxSegs);
+  }
+
+  UARTprintf("Gated: %u of %u blocks written (%u%%)\n", vad->written,
+             vad->block, vad->block ? (vad->written * 100 / vad->block) : 0);
+}
@@ -0,0 +1,62 @@
+/*
+ * vad.h
+ * Block based voice activity detector for gated recording
+ *
+ *  Created on: 19-10-2026
+ */
+
+#ifndef VAD_H_
+#define VAD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "proc.h"
+
+enum {
+  vadBlockSize = elementSize,  // Output samples per block (64ms @ 8ksps)
+  vadElements = procDecimation, // ADC elements per output block
+  vadPreBlocks = 3,            // Pre-trigger history kept, in blocks
+  vadHangBlocks = 8,           // Hangover after the last active block
+  vadMaxSegs = 32              // Segments remembered for the report
+};
+
+// Activity when the block energy exceeds the noise floor by this ratio...
+#define VAD_ENERGY_RATIO    4
+// ...or exceeds it by this smaller ratio with a high zero crossing count
+#define VAD_ENERGY_RATIO_ZC 2
+#define VAD_ZC_MIN          320
+// Blocks below this energy are never active
+#define VAD_MIN_ENERGY      64
+
+typedef struct {
+  uint32_t startBlock; // First block of the segment, counted from start
+  uint32_t blocks;     // Length in blocks
+  uint32_t offset;     // Byte offset of the segment in the data chunk
+  uint32_t tick;       // SysTick count when the segment triggered
+} vadSegT;
+
+typedef struct {
+  // Output blocks: the current one and the pre-trigger history before it
+  int16_t hist[vadPreBlocks + 1][vadBlockSize];
+  uint8_t slot;      // Slot receiving the current block
+  uint8_t histCount; // Valid history blocks before slot
+
+  uint32_t energy;    // Energy of the current block
+  uint32_t zeroCross; // Zero crossings of the current block
+  uint32_t noise;     // Noise floor estimate
+  uint8_t hang;       // Remaining hangover blocks
+  bool active;
+
+  uint32_t block;   // Blocks processed
+  uint32_t written; // Blocks written
+  vadSegT seg[vadMaxSegs];
+  uint16_t segCount;
+} vadT;
+
+void vadInit(vadT * vad);
+int16_t * vadSlot(vadT * vad);
+void vadAccumulate(vadT * vad, procStatT * stat);
+uint8_t vadUpdate(vadT * vad, uint32_t tick, int16_t ** blocks);
+void vadPrint(vadT * vad);
+
+#endif /* VAD_H_ */